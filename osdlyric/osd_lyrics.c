@@ -21,7 +21,7 @@ static void signal_handler(int sig) {
 }
 
 int main(int argc, char *argv[]) {
-    gchar *sse_url = NULL;
+    GPtrArray *sse_urls = g_ptr_array_new();
 
     // 设置信号处理器
     signal(SIGINT, signal_handler);   // Ctrl+C
@@ -30,19 +30,64 @@ int main(int argc, char *argv[]) {
 
     printf("🚀 [启动] OSD歌词程序启动\n");
 
+    guint reconnect_initial_ms = 500;
+    guint reconnect_max_ms = 30000;
+    gboolean main_loop_transport = FALSE;
+    gboolean compact_encoding = FALSE;
+    gboolean wipe_render = TRUE;
+    gboolean outline_text = FALSE;
+    gboolean all_monitors = FALSE;
+
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--sse-url") == 0 && i + 1 < argc) {
-            sse_url = argv[i + 1];
+            // 可以重复指定多个端点，按顺序优先
+            g_ptr_array_add(sse_urls, argv[i + 1]);
             i++; // 跳过下一个参数
+        } else if (strcmp(argv[i], "--reconnect-initial") == 0 && i + 1 < argc) {
+            reconnect_initial_ms = (guint)atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "--reconnect-max") == 0 && i + 1 < argc) {
+            reconnect_max_ms = (guint)atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            // thread（默认）或 mainloop
+            main_loop_transport = strcmp(argv[i + 1], "mainloop") == 0;
+            i++;
+        } else if (strcmp(argv[i], "--encoding") == 0 && i + 1 < argc) {
+            // text（默认）或 compact
+            compact_encoding = strcmp(argv[i + 1], "compact") == 0;
+            i++;
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            // wipe（默认）或 markup
+            wipe_render = strcmp(argv[i + 1], "markup") != 0;
+            i++;
+        } else if (strcmp(argv[i], "--text-style") == 0 && i + 1 < argc) {
+            // shadow（默认）或 outline
+            outline_text = strcmp(argv[i + 1], "outline") == 0;
+            i++;
+        } else if (strcmp(argv[i], "--all-monitors") == 0) {
+            // 每个显示器一个歌词窗口，共享同一个连接
+            all_monitors = TRUE;
         }
     }
 
+    // 重连退避策略：第一次失败立即重试，之后指数退避并加入20%抖动
+    osd_lyrics_set_reconnect_policy(reconnect_initial_ms, reconnect_max_ms, 0.2);
+    osd_lyrics_set_sse_main_loop(main_loop_transport);
+    osd_lyrics_set_compact_encoding(compact_encoding);
+    osd_lyrics_set_wipe_render(wipe_render);
+    osd_lyrics_set_outline_text(outline_text);
+
     // 初始化GTK
     gtk_init(&argc, &argv);
 
     // 初始化OSD歌词
-    if (!osd_lyrics_init_with_sse(sse_url)) {
+    g_ptr_array_add(sse_urls, NULL);
+    gboolean initialized = osd_lyrics_init_with_sse_urls(
+        sse_urls->len > 1 ? (const gchar * const *)sse_urls->pdata : NULL);
+    g_ptr_array_free(sse_urls, TRUE);
+    if (!initialized) {
         fprintf(stderr, "❌ [启动] 初始化OSD歌词系统失败\n");
         return 1;
     }
@@ -52,6 +97,16 @@ int main(int argc, char *argv[]) {
     // 显示窗口
     osd_lyrics_set_visible(TRUE);
 
+    // 其他显示器上的附加窗口（主窗口保持配置文件中的位置）
+    if (all_monitors) {
+        gint n_monitors = gdk_display_get_n_monitors(gdk_display_get_default());
+        for (gint i = 1; i < n_monitors; i++) {
+            OSDLyrics *window = osd_lyrics_window_new();
+            osd_lyrics_window_move_to_monitor(window, i);
+            osd_lyrics_window_set_visible(window, TRUE);
+        }
+    }
+
     printf("🎵 [启动] 进入主循环，等待歌词数据...\n");
 
     // 进入主循环
@@ -3,6 +3,11 @@
 
 #include <gtk/gtk.h>
 
+// 歌词窗口句柄
+// 同一进程中的所有窗口共享一个SSE连接和一份解析好的歌词时间轴，每个窗口只增加绘制开销；
+// 字体、颜色、透明度、位置和锁定状态各自独立。初始化时创建的主窗口保存配置，附加窗口的设置只在内存中
+typedef struct _OSDLyrics OSDLyrics;
+
 // 公共API函数声明
 
 /**
@@ -18,6 +23,54 @@ gboolean osd_lyrics_init(void);
  */
 gboolean osd_lyrics_init_with_sse(const gchar *sse_url);
 
+/**
+ * 使用多个SSE端点初始化OSD歌词系统
+ * 当前端点断开时立即切换到健康得分最高的其他端点
+ * @param sse_urls 以NULL结尾的URL列表，靠前的优先，可以为NULL
+ * @return 成功返回TRUE，失败返回FALSE
+ */
+gboolean osd_lyrics_init_with_sse_urls(const gchar * const *sse_urls);
+
+/**
+ * 设置SSE重连退避策略，需在初始化之前调用
+ * 第一次失败立即重试，之后从 initial_ms 开始指数增长到 max_ms
+ * @param initial_ms 起始重连间隔（毫秒）
+ * @param max_ms 最大重连间隔（毫秒）
+ * @param jitter 随机抖动比例 (0.0 - 1.0)
+ */
+void osd_lyrics_set_reconnect_policy(guint initial_ms, guint max_ms, gdouble jitter);
+
+/**
+ * 设置SSE传输方式，需在初始化之前调用
+ * 默认在独立线程中阻塞接收；启用后由GTK主循环通过curl_multi驱动，
+ * 解析和显示在同一线程中完成
+ * @param enabled 是否在主循环中运行
+ */
+void osd_lyrics_set_sse_main_loop(gboolean enabled);
+
+/**
+ * 设置是否协商紧凑二进制编码，需在初始化之前调用
+ * 启用后在Accept中优先请求紧凑编码，服务器不支持时仍使用SSE文本（JSON）
+ * @param enabled 是否启用
+ */
+void osd_lyrics_set_compact_encoding(gboolean enabled);
+
+/**
+ * 设置KRC逐字高亮方式，需在初始化之前调用
+ * 默认由自绘控件按帧时钟平滑擦除（可以停在字形中间）；
+ * 关闭后按音节改写歌词标签的Pango标记
+ * @param enabled 是否使用擦除控件
+ */
+void osd_lyrics_set_wipe_render(gboolean enabled);
+
+/**
+ * 设置歌词文字样式，需在初始化之前调用
+ * 默认为浅色阴影；启用后擦除控件每行用字形轮廓画深色描边再填充（轮廓每行只生成一次并栅格化缓存），
+ * 歌词标签的阴影改为不模糊，重绘时不再做模糊
+ * @param enabled 是否使用描边样式
+ */
+void osd_lyrics_set_outline_text(gboolean enabled);
+
 /**
  * 清理OSD歌词系统资源
  */
@@ -77,4 +130,67 @@ void osd_lyrics_set_text_color(const GdkRGBA *color);
  */
 void osd_lyrics_get_text_color(GdkRGBA *color);
 
+// 多窗口API：不带句柄的设置函数作用于主窗口，歌词文本（osd_lyrics_set_text 等）显示在所有窗口中
+
+/**
+ * 获取初始化时创建的主窗口
+ * @return 主窗口，未初始化时返回NULL
+ */
+OSDLyrics* osd_lyrics_get_default(void);
+
+/**
+ * 创建附加歌词窗口（例如每个显示器一个），需在初始化之后调用
+ * 初始的字体、颜色和透明度复制自主窗口，创建后处于隐藏状态
+ * @return 新窗口，用 osd_lyrics_window_destroy 销毁；未初始化时返回NULL
+ */
+OSDLyrics* osd_lyrics_window_new(void);
+
+/**
+ * 销毁附加窗口（主窗口由 osd_lyrics_cleanup 销毁）
+ * @param window 附加窗口
+ */
+void osd_lyrics_window_destroy(OSDLyrics *window);
+
+/**
+ * 把窗口移到指定显示器工作区的底部居中
+ * @param window 窗口
+ * @param monitor_index 显示器序号（gdk_display_get_monitor）
+ */
+void osd_lyrics_window_move_to_monitor(OSDLyrics *window, gint monitor_index);
+
+/**
+ * 显示/隐藏窗口，所有窗口都隐藏时停止显示定时器
+ */
+void osd_lyrics_window_set_visible(OSDLyrics *window, gboolean visible);
+
+/**
+ * 设置窗口透明度 (0.01 - 0.90)
+ */
+void osd_lyrics_window_set_opacity(OSDLyrics *window, gdouble opacity);
+
+/**
+ * 设置窗口字体大小 (12 - 48)
+ */
+void osd_lyrics_window_set_font_size(OSDLyrics *window, gint size);
+
+/**
+ * 设置窗口鼠标穿透
+ */
+void osd_lyrics_window_set_mouse_through(OSDLyrics *window, gboolean enabled);
+
+/**
+ * 设置窗口置顶
+ */
+void osd_lyrics_window_set_always_on_top(OSDLyrics *window, gboolean enabled);
+
+/**
+ * 设置窗口文字颜色
+ */
+void osd_lyrics_window_set_text_color(OSDLyrics *window, const GdkRGBA *color);
+
+/**
+ * 获取窗口文字颜色
+ */
+void osd_lyrics_window_get_text_color(OSDLyrics *window, GdkRGBA *color);
+
 #endif // OSD_LYRICS_H
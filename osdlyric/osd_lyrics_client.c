@@ -0,0 +1,949 @@
+#include <stdio.h>
+#include <string.h>
+#include <curl/curl.h>
+#include <glib-unix.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include "osd_lyrics_client.h"
+#include "osd_lyrics_compact.h"
+
+// curl_multi_poll/curl_multi_wakeup：线程模式停止时直接唤醒连接线程，不需要进度回调轮询
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define SSE_HAVE_MULTI_WAKEUP 1
+#endif
+
+struct _SSEClient {
+    SSEEndpoint *endpoints;   // 按优先级排列的端点
+    guint n_endpoints;
+    guint current;            // 当前（或下一次）连接的端点
+    SSEBackoffPolicy policy;
+    SSEClientLyricsFunc lyrics_func;
+    SSEClientDocumentFunc document_func;
+    SSEClientPlaybackFunc playback_func;
+    SSEClientTimelineFunc timeline_func;
+    gpointer user_data;
+
+    // 线程控制
+    GMutex lock;
+    GCond cond;               // 用于唤醒退避等待
+    gint running;             // 原子访问
+    gint ref_count;           // 调用方和连接线程各持有一个引用
+    gint state;               // SSEConnectionState，原子访问
+
+    SSEParser parser;         // 跨重连保留，用于Last-Event-ID和retry
+    LyricsEventDecoder decoder;
+    gboolean compact;         // 在Accept中声明支持紧凑二进制编码
+    gboolean compact_stream;  // 当前连接的响应使用紧凑编码
+    LyricsCompactDecoder compact_decoder;
+
+    // 断线恢复：最近一次lyrics_update，重连后立即重新应用
+    gchar *last_text;
+    gchar *last_format;
+    gchar *last_song;
+    gint64 last_received_time;   // 收到时间（单调时钟，毫秒）
+    gboolean awaiting_first_event; // 新连接尚未收到任何事件
+    gboolean awaiting_lyrics;    // 重连后尚未收到新的lyrics_update
+    gint64 disconnect_time;      // 上次断线时间（毫秒），0表示没有断过线
+    gint64 attempt_start_time;   // 本次连接发起时间（毫秒）
+
+    // 重连统计
+    guint reconnects;
+    gint64 last_restore_ms;      // 断线到重新应用歌词的时间
+    gint64 last_correct_ms;      // 断线到收到新歌词的时间
+    gint64 total_correct_ms;
+    guint correct_samples;
+    SSEClientStats stats;
+
+    // 主循环传输模式
+    SSETransport transport;
+    CURLM *multi;
+    CURL *easy;                  // 当前连接
+    struct curl_slist *headers;  // 当前连接的请求头
+    guint timer_id;              // curl请求的超时定时器
+    guint reconnect_id;          // 退避重连定时器
+    gint64 backoff_start_time;   // 微秒
+
+    // 线程模式
+    CURLM *thread_multi;         // 连接线程的传输句柄，停止时通过 curl_multi_wakeup 唤醒
+};
+
+static gboolean sse_multi_reconnect(gpointer data);
+
+static const gchar *state_names[] = {"idle", "connecting", "streaming", "backoff"};
+
+void sse_backoff_policy_init_default(SSEBackoffPolicy *policy) {
+    policy->initial_ms = 500;
+    policy->max_ms = 30000;
+    policy->multiplier = 2.0;
+    policy->jitter = 0.2;
+}
+
+static inline gint64 now_ms(void) {
+    return g_get_monotonic_time() / 1000;
+}
+
+static gboolean sse_client_is_running(SSEClient *client) {
+    return g_atomic_int_get(&client->running) != 0;
+}
+
+static void sse_client_set_state(SSEClient *client, SSEConnectionState state) {
+    SSEConnectionState old_state = g_atomic_int_get(&client->state);
+    if (old_state == state) {
+        return;
+    }
+    g_atomic_int_set(&client->state, state);
+    printf("🔀 [SSE状态] %s -> %s\n", state_names[old_state], state_names[state]);
+}
+
+static void sse_client_unref(SSEClient *client) {
+    if (!g_atomic_int_dec_and_test(&client->ref_count)) {
+        return;
+    }
+
+    sse_parser_clear(&client->parser);
+    lyrics_event_decoder_clear(&client->decoder);
+    lyrics_compact_decoder_clear(&client->compact_decoder);
+    if (client->thread_multi) {
+        curl_multi_cleanup(client->thread_multi);
+    }
+    g_mutex_clear(&client->lock);
+    g_cond_clear(&client->cond);
+    g_free(client->last_text);
+    g_free(client->last_format);
+    g_free(client->last_song);
+    for (guint i = 0; i < client->n_endpoints; i++) {
+        sse_endpoint_clear(&client->endpoints[i]);
+    }
+    g_free(client->endpoints);
+    g_free(client);
+}
+
+// 连接收到第一块数据：CONNECTING -> STREAMING
+static void sse_client_mark_streaming(SSEClient *client) {
+    gint64 now = now_ms();
+
+    client->stats.connects++;
+    client->stats.last_connect_ms = now - client->attempt_start_time;
+    client->stats.total_connect_ms += client->stats.last_connect_ms;
+    if (client->disconnect_time > 0) {
+        client->stats.downtime_ms += now - client->disconnect_time;
+    }
+    sse_endpoint_record_connect(&client->endpoints[client->current], client->stats.last_connect_ms);
+
+    sse_client_set_state(client, SSE_STATE_STREAMING);
+    printf("⏱️ [SSE状态] 连接耗时 %" G_GINT64_FORMAT "ms (第 %" G_GUINT64_FORMAT " 次尝试)\n",
+           client->stats.last_connect_ms, client->stats.attempts);
+}
+
+// 重连后的第一个事件：如果服务器没有立即重发歌词，重新应用断线前的最后一行
+static void sse_restore_after_reconnect(SSEClient *client, gboolean got_lyrics) {
+    client->awaiting_first_event = FALSE;
+
+    if (client->disconnect_time == 0 || got_lyrics || !client->last_text) {
+        return;
+    }
+
+    gint64 now = now_ms();
+    printf("♻️ [SSE恢复] 重新应用断线前的歌词 (已播放 %" G_GINT64_FORMAT "ms)\n",
+           now - client->last_received_time);
+    client->lyrics_func(client->last_song, client->last_text, strlen(client->last_text),
+                        client->last_format, client->last_received_time, TRUE, client->user_data);
+    client->last_restore_ms = now - client->disconnect_time;
+    printf("⏱️ [SSE恢复] 断线后 %" G_GINT64_FORMAT "ms 恢复歌词显示\n", client->last_restore_ms);
+}
+
+// 记录重连后第一次收到新歌词的耗时
+static void sse_record_time_to_correct(SSEClient *client, gint64 now) {
+    if (!client->awaiting_lyrics) {
+        return;
+    }
+
+    client->awaiting_lyrics = FALSE;
+    client->last_correct_ms = now - client->disconnect_time;
+    client->total_correct_ms += client->last_correct_ms;
+    client->correct_samples++;
+    printf("⏱️ [SSE恢复] 断线后 %" G_GINT64_FORMAT "ms 收到正确歌词 (平均 %" G_GINT64_FORMAT "ms, %u 次重连)\n",
+           client->last_correct_ms, client->total_correct_ms / client->correct_samples,
+           client->reconnects);
+}
+
+// SSE写入回调函数
+static size_t sse_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    SSEClient *client = (SSEClient *)userp;
+
+    // 检查输入参数有效性
+    if (!client || !contents || realsize == 0) {
+        return 0;
+    }
+
+    // 客户端已停止，中断传输
+    if (!sse_client_is_running(client)) {
+        printf("⚠️ [SSE回调] 客户端已停止，停止处理数据\n");
+        return 0;
+    }
+
+    if (g_atomic_int_get(&client->state) == SSE_STATE_CONNECTING) {
+        sse_client_mark_streaming(client);
+    }
+
+    if (client->compact_stream) {
+        // 紧凑编码，格式错误时中断连接
+        if (!lyrics_compact_decoder_feed(&client->compact_decoder, (const gchar *)contents, realsize)) {
+            printf("❌ [OSD歌词] 紧凑编码数据格式错误\n");
+            return 0;
+        }
+        return realsize;
+    }
+
+    // 增量解析，不完整的行保留到下一个数据块
+    sse_parser_feed(&client->parser, (const gchar *)contents, realsize);
+
+    return realsize;
+}
+
+// 响应头回调：根据Content-Type选择解码方式（跟随重定向时以最后一个响应为准）
+static size_t sse_header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    SSEClient *client = (SSEClient *)userdata;
+    size_t realsize = size * nitems;
+    static const gchar name[] = "content-type:";
+
+    if (realsize > sizeof(name) - 1 && g_ascii_strncasecmp(buffer, name, sizeof(name) - 1) == 0) {
+        gchar *value = g_strndup(buffer + sizeof(name) - 1, realsize - (sizeof(name) - 1));
+        client->compact_stream = strstr(value, LYRICS_COMPACT_CONTENT_TYPE) != NULL;
+        g_free(value);
+        if (client->compact_stream) {
+            printf("📦 [OSD歌词] 服务器使用紧凑编码\n");
+        }
+    }
+    return realsize;
+}
+
+#ifndef SSE_HAVE_MULTI_WAKEUP
+// 传输进度回调：停止时让curl尽快返回（旧版libcurl，空闲时约每秒调用一次）
+static int sse_progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                 curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+    return sse_client_is_running((SSEClient *)clientp) ? 0 : 1;
+}
+#endif
+
+// 处理一个已解码的事件（JSON和紧凑编码共用）
+static void sse_dispatch_event(SSEClient *client, LyricsEvent *event) {
+    // 任何事件都可能带有播放状态（歌词行、心跳等）
+    if (client->playback_func &&
+        (event->position_ms >= 0 || event->paused >= 0 || event->rate > 0)) {
+        client->playback_func(event->position_ms, event->paused, event->rate,
+                              now_ms(), client->user_data);
+    }
+
+    switch (event->type) {
+    case LYRICS_EVENT_LYRICS_UPDATE: {
+        const char *text = event->text.str;
+        const char *song = event->song_name.str;
+        const char *artist = event->artist.str;
+        const char *format = event->format.len > 0 ? event->format.str : "lrc"; // 默认格式
+
+        printf("🎵 [OSD歌词] 收到歌词 (%s): %s - %s\n", format, song, artist);
+
+        gint64 now = now_ms();
+        if (client->awaiting_first_event) {
+            sse_restore_after_reconnect(client, TRUE);
+        }
+        sse_record_time_to_correct(client, now);
+
+        // 保存最后一行，断线重连后用于恢复显示
+        g_free(client->last_text);
+        g_free(client->last_format);
+        g_free(client->last_song);
+        client->last_text = g_strndup(text, event->text.len);
+        client->last_format = g_strdup(format);
+        client->last_song = g_strndup(song, event->song_name.len);
+        client->last_received_time = now;
+
+        client->lyrics_func(song, text, event->text.len, format, now, FALSE, client->user_data);
+        break;
+    }
+    case LYRICS_EVENT_LYRICS_DOCUMENT: {
+        const char *format = event->format.len > 0 ? event->format.str : "lrc";
+        if (event->timeline) {
+            printf("📜 [OSD歌词] 收到整首歌词 (%s, %u 行, 紧凑编码): %s - %s\n", format,
+                   event->timeline->n_lines, event->song_name.str, event->artist.str);
+            if (client->timeline_func) {
+                // 转移所有权
+                client->timeline_func(event->timeline, client->user_data);
+                event->timeline = NULL;
+            }
+            break;
+        }
+        printf("📜 [OSD歌词] 收到整首歌词 (%s, %" G_GSIZE_FORMAT " 字节): %s - %s\n", format,
+               event->text.len, event->song_name.str, event->artist.str);
+        if (client->document_func) {
+            client->document_func(event->song_name.str, event->artist.str, event->text.str, event->text.len,
+                                  format, client->user_data);
+        }
+        break;
+    }
+    case LYRICS_EVENT_CONNECTED:
+        printf("✅ [OSD歌词] SSE连接成功\n");
+        break;
+    case LYRICS_EVENT_HEARTBEAT:
+        sse_endpoint_record_heartbeat(&client->endpoints[client->current], now_ms());
+        break;
+    default:
+        break;
+    }
+
+    if (client->awaiting_first_event) {
+        sse_restore_after_reconnect(client, FALSE);
+    }
+}
+
+// 处理一个完整的SSE事件
+static void sse_handle_event(SSEEvent *event, gpointer user_data) {
+    SSEClient *client = (SSEClient *)user_data;
+
+    if (!sse_client_is_running(client)) {
+        return;
+    }
+
+    // 解码JSON数据（已知结构走快速路径，字符串借用事件缓冲区）
+    LyricsEvent lyrics_event;
+    if (!lyrics_event_decode(&client->decoder, event->data, event->data_len, &lyrics_event)) {
+        return;
+    }
+    sse_dispatch_event(client, &lyrics_event);
+}
+
+// 紧凑编码解码出的事件
+static void sse_handle_compact_event(LyricsEvent *event, gpointer user_data) {
+    SSEClient *client = (SSEClient *)user_data;
+
+    if (!sse_client_is_running(client)) {
+        return;
+    }
+    sse_dispatch_event(client, event);
+}
+
+// 计算端点下一次重连前的等待时间
+static guint sse_client_next_backoff(SSEClient *client, const SSEEndpoint *endpoint) {
+    // 第一次失败（例如播放器刚重启）立即重试
+    if (endpoint->consecutive_failures <= 1) {
+        return 0;
+    }
+
+    // 服务器通过retry:字段建议的间隔作为起始值
+    gdouble base = client->parser.retry_ms >= 0 ? (gdouble)client->parser.retry_ms : (gdouble)client->policy.initial_ms;
+    gdouble delay = base;
+    for (guint i = 2; i < endpoint->consecutive_failures && delay < client->policy.max_ms; i++) {
+        delay *= client->policy.multiplier;
+    }
+    delay = MIN(delay, (gdouble)client->policy.max_ms);
+
+    // 随机抖动，避免多个客户端同时重连
+    if (client->policy.jitter > 0) {
+        delay *= g_random_double_range(1.0 - client->policy.jitter, 1.0 + client->policy.jitter);
+    }
+
+    return (guint)delay;
+}
+
+// 退避等待，可被sse_client_stop立即唤醒，期间没有任何定时唤醒
+static void sse_client_backoff_wait(SSEClient *client, guint delay_ms) {
+    if (delay_ms == 0) {
+        return;
+    }
+
+    gint64 start = g_get_monotonic_time();
+    gint64 end_time = start + (gint64)delay_ms * 1000;
+
+    g_mutex_lock(&client->lock);
+    while (sse_client_is_running(client)) {
+        if (!g_cond_wait_until(&client->cond, &client->lock, end_time)) {
+            break; // 超时
+        }
+    }
+    g_mutex_unlock(&client->lock);
+
+    client->stats.backoff_waits++;
+    client->stats.backoff_ms += (g_get_monotonic_time() - start) / 1000;
+}
+
+// 开始一次连接尝试：CONNECTING，创建并配置curl句柄
+static CURL* sse_client_begin_attempt(SSEClient *client) {
+    SSEEndpoint *endpoint = &client->endpoints[client->current];
+
+    sse_parser_reset(&client->parser);
+    lyrics_compact_decoder_reset(&client->compact_decoder);
+    client->compact_stream = FALSE;
+    client->awaiting_first_event = TRUE;
+    client->attempt_start_time = now_ms();
+    client->stats.attempts++;
+    sse_endpoint_begin_attempt(endpoint);
+    sse_client_set_state(client, SSE_STATE_CONNECTING);
+
+    printf("🔗 [OSD歌词] 尝试连接到: %s\n", endpoint->url);
+
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        return NULL;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, endpoint->request_url);
+    // 本机Unix域套接字，绕过TCP回环和端口占用
+    if (endpoint->kind == SSE_ENDPOINT_UNIX) {
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, endpoint->socket_path);
+    } else if (endpoint->kind == SSE_ENDPOINT_UNIX_ABSTRACT) {
+#if LIBCURL_VERSION_NUM >= 0x073500
+        curl_easy_setopt(curl, CURLOPT_ABSTRACT_UNIX_SOCKET, endpoint->socket_path);
+#else
+        printf("⚠️ [OSD歌词] 当前libcurl不支持抽象命名空间套接字，需要7.53.0以上\n");
+        curl_easy_cleanup(curl);
+        return NULL;
+#endif
+    }
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, sse_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, client);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, sse_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, client);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 0L); // 无超时
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L); // 连接超时10秒
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);     // HTTP错误视为连接失败
+    // 添加信号处理，允许中断长时间连接
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+#ifdef SSE_HAVE_MULTI_WAKEUP
+    // 不使用进度回调：它在空闲的流上也会定时调用。停止时线程模式由 curl_multi_wakeup 唤醒，
+    // 主循环模式直接移除句柄
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+#else
+    // 停止时通过进度回调中断传输
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, sse_progress_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, client);
+#endif
+
+    // 已学到心跳间隔时，超过几个心跳周期没有数据就视为断开（连接挂起但没有关闭）
+    glong stall_timeout = sse_endpoint_stall_timeout(endpoint);
+    if (stall_timeout > 0) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, stall_timeout);
+    }
+
+    // 设置SSE头部
+    struct curl_slist *headers = NULL;
+    // 紧凑编码优先，服务器不支持时仍返回SSE文本
+    headers = curl_slist_append(headers, client->compact ?
+                                "Accept: " LYRICS_COMPACT_CONTENT_TYPE ", text/event-stream;q=0.9" :
+                                "Accept: text/event-stream");
+    headers = curl_slist_append(headers, "Cache-Control: no-cache");
+
+    // 断线续传：告诉服务器最后收到的事件ID
+    const gchar *last_id = sse_parser_get_last_id(&client->parser);
+    if (last_id) {
+        gchar *id_header = g_strdup_printf("Last-Event-ID: %s", last_id);
+        headers = curl_slist_append(headers, id_header);
+        g_free(id_header);
+        printf("🔖 [SSE恢复] 使用 Last-Event-ID: %s\n", last_id);
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    client->headers = headers;
+
+    return curl;
+}
+
+// 结束一次连接尝试：释放句柄，更新失败/断线统计
+static void sse_client_end_attempt(SSEClient *client, CURL *curl, CURLcode res) {
+    if (res != CURLE_OK) {
+        printf("❌ [OSD歌词] SSE连接失败: %s\n", curl_easy_strerror(res));
+    } else {
+        printf("🔌 [OSD歌词] SSE连接断开\n");
+    }
+
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+    curl_slist_free_all(client->headers);
+    client->headers = NULL;
+
+    gboolean streamed = g_atomic_int_get(&client->state) == SSE_STATE_STREAMING;
+    if (!streamed) {
+        // 没收到任何数据就失败了
+        client->stats.failures++;
+    } else {
+        // 正常接收过数据的连接断开，记录断线时间
+        client->disconnect_time = now_ms();
+        client->awaiting_lyrics = TRUE;
+        client->reconnects++;
+    }
+
+    // 端点各自退避
+    SSEEndpoint *endpoint = &client->endpoints[client->current];
+    endpoint->consecutive_failures++;
+    sse_endpoint_record_end(endpoint, streamed, now_ms() + sse_client_next_backoff(client, endpoint));
+
+    // 输出统计
+    sse_client_print_stats(client);
+}
+
+// 选择下一次连接的端点，返回需要等待的时间
+// 优先切换到其他已结束退避的端点中得分最高的一个；只有它们都在退避时才重试刚失败的端点，
+// 全部在退避时等待最早结束退避的端点
+static guint sse_client_select_endpoint(SSEClient *client) {
+    gint64 now = now_ms();
+    guint failed = client->current;
+    gint best = -1;
+    gdouble best_score = -1.0;
+
+    for (guint i = 0; i < client->n_endpoints; i++) {
+        SSEEndpoint *endpoint = &client->endpoints[i];
+        if (i == failed || !sse_endpoint_is_available(endpoint, now)) {
+            continue;
+        }
+        gdouble score = sse_endpoint_score(endpoint);
+        if (score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    if (best < 0) {
+        // 其他端点都不可用，等待最早结束退避的端点（包括刚失败的端点）
+        best = failed;
+        for (guint i = 0; i < client->n_endpoints; i++) {
+            if (client->endpoints[i].retry_time < client->endpoints[best].retry_time) {
+                best = i;
+            }
+        }
+    }
+
+    if ((guint)best != failed) {
+        client->stats.failovers++;
+        printf("🔀 [SSE端点] 切换到 %s (得分 %.2f)\n", client->endpoints[best].url,
+               sse_endpoint_score(&client->endpoints[best]));
+    }
+    client->current = best;
+
+    return (guint)MAX(client->endpoints[best].retry_time - now, 0);
+}
+
+// 进入退避状态，返回等待时间
+static guint sse_client_enter_backoff(SSEClient *client) {
+    guint delay_ms = sse_client_select_endpoint(client);
+    sse_client_set_state(client, SSE_STATE_BACKOFF);
+    if (delay_ms > 0) {
+        printf("⏰ [OSD歌词] %ums后重连 (连续失败 %u 次)...\n", delay_ms,
+               client->endpoints[client->current].consecutive_failures);
+    } else {
+        printf("⏰ [OSD歌词] 立即重连...\n");
+    }
+    return delay_ms;
+}
+
+// 连接线程的定时器松弛（纳秒）
+#define SSE_THREAD_TIMER_SLACK_NS (100UL * 1000 * 1000)
+
+// curl_multi_poll 的最长等待，只是兜底；数据、curl自己的定时器和停止都会提前唤醒
+#define SSE_THREAD_POLL_TIMEOUT_MS 60000
+
+// 在连接线程中执行一次传输，直到连接结束或客户端停止
+static CURLcode sse_thread_perform(SSEClient *client, CURL *curl) {
+#ifdef SSE_HAVE_MULTI_WAKEUP
+    CURLM *multi = client->thread_multi;
+    if (!multi) {
+        return CURLE_OUT_OF_MEMORY;
+    }
+
+    CURLcode res = CURLE_OK;
+    CURLMcode mc = curl_multi_add_handle(multi, curl);
+    int running_handles = 1;
+
+    while (mc == CURLM_OK && running_handles > 0 && sse_client_is_running(client)) {
+        mc = curl_multi_perform(multi, &running_handles);
+        if (mc == CURLM_OK && running_handles > 0) {
+            mc = curl_multi_poll(multi, NULL, 0, SSE_THREAD_POLL_TIMEOUT_MS, NULL);
+        }
+    }
+
+    if (mc != CURLM_OK) {
+        printf("❌ [OSD歌词] curl_multi错误: %s\n", curl_multi_strerror(mc));
+        res = CURLE_FAILED_INIT;
+    } else if (running_handles > 0) {
+        // 被 sse_client_stop 唤醒
+        res = CURLE_ABORTED_BY_CALLBACK;
+    } else {
+        CURLMsg *msg;
+        int pending;
+        while ((msg = curl_multi_info_read(multi, &pending)) != NULL) {
+            if (msg->msg == CURLMSG_DONE && msg->easy_handle == curl) {
+                res = msg->data.result;
+            }
+        }
+    }
+
+    curl_multi_remove_handle(multi, curl);
+    return res;
+#else
+    (void)client;
+    return curl_easy_perform(curl);
+#endif
+}
+
+// SSE连接线程：IDLE -> CONNECTING -> STREAMING -> BACKOFF -> CONNECTING ...
+static gpointer sse_connection_thread(gpointer data) {
+    SSEClient *client = (SSEClient *)data;
+
+    printf("🔗 [OSD歌词] 开始SSE连接线程\n");
+
+#ifdef PR_SET_TIMERSLACK
+    // 连接线程只在套接字可读时才有工作，curl内部的周期性检查不需要精确，
+    // 放宽定时器松弛让内核把它们和其他唤醒合并
+    prctl(PR_SET_TIMERSLACK, SSE_THREAD_TIMER_SLACK_NS, 0, 0, 0);
+#endif
+
+    while (sse_client_is_running(client)) {
+        CURL *curl = sse_client_begin_attempt(client);
+        CURLcode res = curl ? sse_thread_perform(client, curl) : CURLE_FAILED_INIT;
+        sse_client_end_attempt(client, curl, res);
+
+        if (!sse_client_is_running(client)) {
+            break;
+        }
+
+        sse_client_backoff_wait(client, sse_client_enter_backoff(client));
+    }
+
+    sse_client_set_state(client, SSE_STATE_IDLE);
+    printf("🔴 [OSD歌词] SSE连接线程退出\n");
+
+    sse_client_unref(client);
+    return NULL;
+}
+
+// ---- 主循环传输：curl_multi_socket_action + GLib fd监视和定时器 ----
+
+static void sse_multi_connect(SSEClient *client);
+
+// 处理已完成的传输
+static void sse_multi_check_info(SSEClient *client) {
+    CURLMsg *msg;
+    int pending;
+
+    while ((msg = curl_multi_info_read(client->multi, &pending)) != NULL) {
+        if (msg->msg != CURLMSG_DONE || msg->easy_handle != client->easy) {
+            continue;
+        }
+
+        CURL *curl = client->easy;
+        CURLcode res = msg->data.result;
+        client->easy = NULL;
+        curl_multi_remove_handle(client->multi, curl);
+        sse_client_end_attempt(client, curl, res);
+
+        if (!sse_client_is_running(client)) {
+            return;
+        }
+
+        guint delay_ms = sse_client_enter_backoff(client);
+        client->backoff_start_time = g_get_monotonic_time();
+        client->reconnect_id = g_timeout_add(delay_ms, sse_multi_reconnect, client);
+        return;
+    }
+}
+
+// 退避结束，重新连接
+static gboolean sse_multi_reconnect(gpointer data) {
+    SSEClient *client = (SSEClient *)data;
+
+    client->reconnect_id = 0;
+    client->stats.backoff_waits++;
+    client->stats.backoff_ms += (g_get_monotonic_time() - client->backoff_start_time) / 1000;
+
+    if (sse_client_is_running(client)) {
+        sse_multi_connect(client);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// curl请求的超时回调
+static gboolean sse_multi_timeout(gpointer data) {
+    SSEClient *client = (SSEClient *)data;
+    int running_handles;
+
+    client->timer_id = 0;
+    curl_multi_socket_action(client->multi, CURL_SOCKET_TIMEOUT, 0, &running_handles);
+    sse_multi_check_info(client);
+    return G_SOURCE_REMOVE;
+}
+
+// socket可读/可写
+static gboolean sse_multi_fd_ready(gint fd, GIOCondition condition, gpointer data) {
+    SSEClient *client = (SSEClient *)data;
+    int running_handles;
+    int flags = 0;
+
+    if (condition & G_IO_IN) flags |= CURL_CSELECT_IN;
+    if (condition & G_IO_OUT) flags |= CURL_CSELECT_OUT;
+    if (condition & (G_IO_ERR | G_IO_HUP)) flags |= CURL_CSELECT_ERR;
+
+    client->stats.fd_wakeups++;
+    curl_multi_socket_action(client->multi, fd, flags, &running_handles);
+    sse_multi_check_info(client);
+
+    // 如果监视已在socket回调中移除，GLib会忽略返回值
+    return G_SOURCE_CONTINUE;
+}
+
+// curl通知需要监视的socket变化
+static int sse_multi_socket_callback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp) {
+    SSEClient *client = (SSEClient *)userp;
+    guint *source_id = (guint *)socketp;
+    (void)easy;
+
+    if (source_id) {
+        g_source_remove(*source_id);
+    }
+
+    if (what == CURL_POLL_REMOVE) {
+        g_free(source_id);
+        curl_multi_assign(client->multi, s, NULL);
+        return 0;
+    }
+
+    GIOCondition condition = 0;
+    if (what & CURL_POLL_IN) condition |= G_IO_IN;
+    if (what & CURL_POLL_OUT) condition |= G_IO_OUT;
+
+    if (!source_id) {
+        source_id = g_malloc0(sizeof(guint));
+        curl_multi_assign(client->multi, s, source_id);
+    }
+    *source_id = g_unix_fd_add(s, condition, sse_multi_fd_ready, client);
+    return 0;
+}
+
+// curl通知需要的超时时间
+static int sse_multi_timer_callback(CURLM *multi, long timeout_ms, void *userp) {
+    SSEClient *client = (SSEClient *)userp;
+    (void)multi;
+
+    if (client->timer_id > 0) {
+        g_source_remove(client->timer_id);
+        client->timer_id = 0;
+    }
+    if (timeout_ms >= 0) {
+        client->timer_id = g_timeout_add((guint)timeout_ms, sse_multi_timeout, client);
+    }
+    return 0;
+}
+
+static void sse_multi_connect(SSEClient *client) {
+    CURL *curl = sse_client_begin_attempt(client);
+    if (!curl) {
+        sse_client_end_attempt(client, NULL, CURLE_FAILED_INIT);
+        client->backoff_start_time = g_get_monotonic_time();
+        client->reconnect_id = g_timeout_add(sse_client_enter_backoff(client), sse_multi_reconnect, client);
+        return;
+    }
+
+    client->easy = curl;
+    curl_multi_add_handle(client->multi, curl);
+}
+
+static void sse_multi_start(SSEClient *client) {
+    printf("🔗 [OSD歌词] 在主循环中运行SSE连接 (curl_multi)\n");
+
+    client->multi = curl_multi_init();
+    curl_multi_setopt(client->multi, CURLMOPT_SOCKETFUNCTION, sse_multi_socket_callback);
+    curl_multi_setopt(client->multi, CURLMOPT_SOCKETDATA, client);
+    curl_multi_setopt(client->multi, CURLMOPT_TIMERFUNCTION, sse_multi_timer_callback);
+    curl_multi_setopt(client->multi, CURLMOPT_TIMERDATA, client);
+
+    sse_multi_connect(client);
+}
+
+static void sse_multi_stop(SSEClient *client) {
+    if (client->reconnect_id > 0) {
+        g_source_remove(client->reconnect_id);
+        client->reconnect_id = 0;
+    }
+
+    if (client->easy) {
+        // 移除句柄时curl会通过socket回调撤销fd监视
+        curl_multi_remove_handle(client->multi, client->easy);
+        curl_easy_cleanup(client->easy);
+        client->easy = NULL;
+        curl_slist_free_all(client->headers);
+        client->headers = NULL;
+    }
+
+    if (client->timer_id > 0) {
+        g_source_remove(client->timer_id);
+        client->timer_id = 0;
+    }
+
+    if (client->multi) {
+        curl_multi_cleanup(client->multi);
+        client->multi = NULL;
+    }
+
+    sse_client_set_state(client, SSE_STATE_IDLE);
+    printf("🔴 [OSD歌词] 主循环SSE连接已停止\n");
+}
+
+SSEClient* sse_client_new(const gchar * const *urls, const SSEBackoffPolicy *policy, SSETransport transport,
+                          SSEClientLyricsFunc lyrics_func, gpointer user_data) {
+    SSEClient *client = g_malloc0(sizeof(SSEClient));
+
+    client->n_endpoints = g_strv_length((gchar **)urls);
+    client->endpoints = g_new0(SSEEndpoint, client->n_endpoints);
+    for (guint i = 0; i < client->n_endpoints; i++) {
+        sse_endpoint_init(&client->endpoints[i], urls[i]);
+    }
+    if (policy) {
+        client->policy = *policy;
+    } else {
+        sse_backoff_policy_init_default(&client->policy);
+    }
+    client->transport = transport;
+    client->lyrics_func = lyrics_func;
+    client->user_data = user_data;
+    client->ref_count = 1;
+    client->state = SSE_STATE_IDLE;
+
+    g_mutex_init(&client->lock);
+    g_cond_init(&client->cond);
+    sse_parser_init(&client->parser, sse_handle_event, client);
+    lyrics_event_decoder_init(&client->decoder);
+    lyrics_compact_decoder_init(&client->compact_decoder, sse_handle_compact_event, client);
+
+    return client;
+}
+
+void sse_client_set_document_func(SSEClient *client, SSEClientDocumentFunc document_func) {
+    client->document_func = document_func;
+}
+
+void sse_client_set_playback_func(SSEClient *client, SSEClientPlaybackFunc playback_func) {
+    client->playback_func = playback_func;
+}
+
+void sse_client_set_timeline_func(SSEClient *client, SSEClientTimelineFunc timeline_func) {
+    client->timeline_func = timeline_func;
+}
+
+void sse_client_set_compact_encoding(SSEClient *client, gboolean enabled) {
+    client->compact = enabled;
+}
+
+void sse_client_start(SSEClient *client) {
+    if (!client || sse_client_is_running(client)) {
+        return;
+    }
+
+    g_atomic_int_set(&client->running, 1);
+
+    if (client->transport == SSE_TRANSPORT_MAINLOOP) {
+        // 解析和渲染都在主线程中进行，无需跨线程传递
+        sse_multi_start(client);
+        return;
+    }
+
+    // 在新线程中运行SSE连接
+#ifdef SSE_HAVE_MULTI_WAKEUP
+    if (!client->thread_multi) {
+        client->thread_multi = curl_multi_init();
+    }
+#endif
+    g_atomic_int_inc(&client->ref_count);
+    GThread *thread = g_thread_new("sse-connection", sse_connection_thread, client);
+    g_thread_unref(thread);
+}
+
+void sse_client_stop(SSEClient *client) {
+    if (!client) {
+        return;
+    }
+
+    // 标记停止并唤醒退避等待，连接线程随后自行退出并释放引用
+    g_mutex_lock(&client->lock);
+    gboolean was_running = g_atomic_int_get(&client->running) != 0;
+    g_atomic_int_set(&client->running, 0);
+    g_cond_broadcast(&client->cond);
+    g_mutex_unlock(&client->lock);
+
+#ifdef SSE_HAVE_MULTI_WAKEUP
+    // 连接线程可能正阻塞在 curl_multi_poll 中；句柄在最后一个引用释放时才销毁
+    if (client->thread_multi) {
+        curl_multi_wakeup(client->thread_multi);
+    }
+#endif
+
+    if (was_running && client->transport == SSE_TRANSPORT_MAINLOOP) {
+        sse_multi_stop(client);
+    }
+
+    sse_client_unref(client);
+}
+
+SSEConnectionState sse_client_get_state(SSEClient *client) {
+    return client ? (SSEConnectionState)g_atomic_int_get(&client->state) : SSE_STATE_IDLE;
+}
+
+void sse_client_print_stats(SSEClient *client) {
+    const SSEClientStats *stats = &client->stats;
+    const SSEParserStats *parser_stats = &client->parser.stats;
+    const LyricsEventDecoderStats *decoder_stats = &client->decoder.stats;
+
+    printf("📊 [连接统计] 端点: %s (%s)\n", client->endpoints[client->current].url,
+           sse_endpoint_kind_name(&client->endpoints[client->current]));
+    printf("📊 [连接统计] 尝试: %" G_GUINT64_FORMAT ", 成功: %" G_GUINT64_FORMAT ", 失败: %" G_GUINT64_FORMAT
+           ", 平均连接耗时: %" G_GINT64_FORMAT "ms, 累计断线: %" G_GINT64_FORMAT "ms, 退避等待: %" G_GUINT64_FORMAT
+           " 次/%" G_GINT64_FORMAT "ms\n",
+           stats->attempts, stats->connects, stats->failures,
+           stats->connects > 0 ? stats->total_connect_ms / (gint64)stats->connects : 0,
+           stats->downtime_ms, stats->backoff_waits, stats->backoff_ms);
+    if (client->transport == SSE_TRANSPORT_MAINLOOP) {
+        printf("📊 [连接统计] 主循环socket唤醒: %" G_GUINT64_FORMAT "\n", stats->fd_wakeups);
+    }
+    if (client->n_endpoints > 1) {
+        printf("📊 [端点统计] 切换: %" G_GUINT64_FORMAT " 次\n", stats->failovers);
+        for (guint i = 0; i < client->n_endpoints; i++) {
+            const SSEEndpoint *endpoint = &client->endpoints[i];
+            printf("📊 [端点统计] %s%s (%s) 得分: %.2f, 尝试: %" G_GUINT64_FORMAT ", 成功: %" G_GUINT64_FORMAT
+                   ", 失败: %" G_GUINT64_FORMAT ", 断开: %" G_GUINT64_FORMAT ", 连接耗时: %.0fms, 心跳间隔: %.0fms (抖动 %.0fms)\n",
+                   i == client->current ? "*" : "", endpoint->url, sse_endpoint_kind_name(endpoint),
+                   sse_endpoint_score(endpoint),
+                   endpoint->attempts, endpoint->connects, endpoint->failures, endpoint->drops,
+                   MAX(endpoint->connect_ms, 0.0), endpoint->heartbeat_interval_ms, endpoint->heartbeat_jitter_ms);
+        }
+    }
+
+    const LyricsCompactStats *compact_stats = &client->compact_decoder.stats;
+    if (compact_stats->bytes > 0) {
+        printf("📊 [紧凑编码统计] 字节: %" G_GUINT64_FORMAT ", 帧: %" G_GUINT64_FORMAT ", 整首歌词: %" G_GUINT64_FORMAT
+               " (解压 %" G_GUINT64_FORMAT " 字节), 跳过: %" G_GUINT64_FORMAT ", 错误: %" G_GUINT64_FORMAT
+               ", 平均解码: %.2f us/帧\n",
+               compact_stats->bytes, compact_stats->frames, compact_stats->documents, compact_stats->inflated_bytes,
+               compact_stats->skipped, compact_stats->errors,
+               compact_stats->frames > 0 ? (gdouble)compact_stats->decode_time_us / compact_stats->frames : 0.0);
+    }
+
+    if (parser_stats->bytes == 0) {
+        return;
+    }
+
+    gdouble seconds = parser_stats->parse_time_us / 1000000.0;
+    printf("📊 [SSE统计] 字节: %" G_GUINT64_FORMAT ", 行: %" G_GUINT64_FORMAT
+           ", 事件: %" G_GUINT64_FORMAT ", 分配: %" G_GUINT64_FORMAT " (%.3f/事件), 解析吞吐: %.1f MB/s\n",
+           parser_stats->bytes, parser_stats->lines, parser_stats->events, parser_stats->allocations,
+           parser_stats->events > 0 ? (gdouble)parser_stats->allocations / parser_stats->events : 0.0,
+           seconds > 0 ? parser_stats->bytes / seconds / (1024.0 * 1024.0) : 0.0);
+
+    guint64 decoded = decoder_stats->fast_path + decoder_stats->fallback;
+    printf("📊 [JSON统计] 快速路径: %" G_GUINT64_FORMAT ", 回退json-c: %" G_GUINT64_FORMAT
+           ", 错误: %" G_GUINT64_FORMAT ", 平均解码: %.2f us/事件\n",
+           decoder_stats->fast_path, decoder_stats->fallback, decoder_stats->errors,
+           decoded > 0 ? (gdouble)decoder_stats->decode_time_us / decoded : 0.0);
+}
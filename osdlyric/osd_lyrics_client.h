@@ -0,0 +1,150 @@
+#ifndef OSD_LYRICS_CLIENT_H
+#define OSD_LYRICS_CLIENT_H
+
+#include <glib.h>
+#include "osd_lyrics_sse.h"
+#include "osd_lyrics_event.h"
+#include "osd_lyrics_endpoint.h"
+
+// SSE歌词客户端：连接状态机、指数退避重连、断线续传、多端点故障切换
+
+typedef enum {
+    SSE_STATE_IDLE = 0,    // 未启动或已停止
+    SSE_STATE_CONNECTING,  // 正在建立连接
+    SSE_STATE_STREAMING,   // 已收到数据，正在接收事件
+    SSE_STATE_BACKOFF      // 等待重连
+} SSEConnectionState;
+
+// 传输方式
+typedef enum {
+    SSE_TRANSPORT_THREAD = 0,  // 独立线程中阻塞执行 curl_easy_perform
+    SSE_TRANSPORT_MAINLOOP     // 在GLib主循环中通过 curl_multi_socket_action 驱动
+} SSETransport;
+
+// 重连退避策略
+typedef struct {
+    guint initial_ms;      // 第二次失败后的起始间隔（第一次失败立即重试）
+    guint max_ms;          // 最大间隔
+    gdouble multiplier;    // 每次失败的增长倍数
+    gdouble jitter;        // 随机抖动比例 (0.0 - 1.0)
+} SSEBackoffPolicy;
+
+// 连接统计
+typedef struct {
+    guint64 attempts;          // 连接尝试次数
+    guint64 connects;          // 成功进入STREAMING的次数
+    guint64 failures;          // 未收到数据就失败的次数
+    gint64 last_connect_ms;    // 最近一次从发起连接到收到数据的时间
+    gint64 total_connect_ms;
+    gint64 downtime_ms;        // 累计断线时长（断线到重新收到数据）
+    gint64 backoff_ms;         // 累计退避等待时长
+    guint64 backoff_waits;     // 退避等待次数
+    guint64 fd_wakeups;        // 主循环模式下socket就绪唤醒次数
+    guint64 failovers;         // 切换到其他端点的次数
+} SSEClientStats;
+
+/**
+ * 收到一行歌词时调用（线程模式在连接线程中，主循环模式在主线程中）
+ * @param song_name 歌曲名，服务器未提供时为空字符串
+ * @param text 歌词文本（不一定以'\0'结尾）
+ * @param text_len 文本长度
+ * @param format 歌词格式，"krc" 或 "lrc"
+ * @param received_time 收到时间（单调时钟，毫秒）；重连恢复时为原始收到时间
+ * @param restored 重连后重新应用的断线前最后一行，不应作为重复行丢弃
+ */
+typedef void (*SSEClientLyricsFunc)(const gchar *song_name, const gchar *text, gsize text_len,
+                                    const gchar *format, gint64 received_time, gboolean restored,
+                                    gpointer user_data);
+
+/**
+ * 收到整首歌词文档时调用（调用线程同 SSEClientLyricsFunc）
+ * @param song_name 歌曲名
+ * @param artist 歌手
+ * @param document 完整的LRC/KRC文档（不一定以'\0'结尾）
+ * @param document_len 文档长度
+ * @param format 歌词格式，"krc" 或 "lrc"
+ */
+typedef void (*SSEClientDocumentFunc)(const gchar *song_name, const gchar *artist,
+                                      const gchar *document, gsize document_len,
+                                      const gchar *format, gpointer user_data);
+
+/**
+ * 事件中带有播放状态字段时调用（调用线程同 SSEClientLyricsFunc，先于该事件的歌词回调）
+ * @param position_ms 播放位置，未提供时为-1
+ * @param paused 1暂停，0播放，未提供时为-1
+ * @param rate 播放速率，未提供时为0
+ * @param received_time 收到时间（单调时钟，毫秒）
+ */
+typedef void (*SSEClientPlaybackFunc)(gint64 position_ms, gint paused, gdouble rate,
+                                      gint64 received_time, gpointer user_data);
+
+/**
+ * 收到已构建好的整首歌词时间轴时调用（紧凑编码，调用线程同 SSEClientLyricsFunc）
+ * @param timeline 时间轴，所有权转移给回调
+ */
+typedef void (*SSEClientTimelineFunc)(LyricsTimeline *timeline, gpointer user_data);
+
+typedef struct _SSEClient SSEClient;
+
+/**
+ * 默认退避策略
+ * @param policy 输出的策略
+ */
+void sse_backoff_policy_init_default(SSEBackoffPolicy *policy);
+
+/**
+ * 创建客户端（不会立即连接）
+ * @param urls SSE连接URL列表，以NULL结尾，至少一个，靠前的优先
+ * @param policy 退避策略，NULL使用默认值
+ * @param transport 传输方式
+ * @param lyrics_func 歌词回调
+ * @param user_data 回调用户数据
+ */
+SSEClient* sse_client_new(const gchar * const *urls, const SSEBackoffPolicy *policy, SSETransport transport,
+                          SSEClientLyricsFunc lyrics_func, gpointer user_data);
+
+/**
+ * 设置整首歌词文档回调，需在 sse_client_start 之前调用
+ * 未设置时忽略 lyrics_document 事件
+ */
+void sse_client_set_document_func(SSEClient *client, SSEClientDocumentFunc document_func);
+
+/**
+ * 设置播放状态回调，需在 sse_client_start 之前调用
+ */
+void sse_client_set_playback_func(SSEClient *client, SSEClientPlaybackFunc playback_func);
+
+/**
+ * 设置紧凑编码的整首歌词回调，需在 sse_client_start 之前调用
+ * 未设置时忽略紧凑编码的整首歌词
+ */
+void sse_client_set_timeline_func(SSEClient *client, SSEClientTimelineFunc timeline_func);
+
+/**
+ * 在Accept中声明支持紧凑二进制编码，服务器不支持时仍使用SSE文本，需在 sse_client_start 之前调用
+ */
+void sse_client_set_compact_encoding(SSEClient *client, gboolean enabled);
+
+/**
+ * 启动连接循环：线程模式创建后台线程，主循环模式必须在主线程中调用
+ */
+void sse_client_start(SSEClient *client);
+
+/**
+ * 停止连接循环并释放客户端
+ * 正在进行的传输会被中断，退避等待会被立即唤醒；线程退出时释放剩余资源。
+ * 主循环模式必须在主线程中调用
+ */
+void sse_client_stop(SSEClient *client);
+
+/**
+ * 获取当前连接状态
+ */
+SSEConnectionState sse_client_get_state(SSEClient *client);
+
+/**
+ * 输出连接、解析和解码统计
+ */
+void sse_client_print_stats(SSEClient *client);
+
+#endif // OSD_LYRICS_CLIENT_H
@@ -0,0 +1,111 @@
+#include <string.h>
+#include <math.h>
+#include "osd_lyrics_clock.h"
+
+// 平滑修正的最短时间；修正速度不超过播放速度的一半，保证位置不会倒退
+#define CORRECTION_MIN_DURATION_MS 250.0
+
+void playback_clock_init(PlaybackClock *clock) {
+    memset(clock, 0, sizeof(PlaybackClock));
+    clock->rate = 1.0;
+}
+
+static gdouble playback_clock_position_exact(const PlaybackClock *clock, gint64 now) {
+    gdouble elapsed = (gdouble)MAX(now - clock->base_time, 0);
+    gdouble position = clock->base_position_ms;
+
+    if (clock->paused) {
+        return position + clock->correction_ms;
+    }
+
+    position += elapsed * clock->rate;
+    if (clock->correction_ms != 0) {
+        gdouble progress = MIN(elapsed / clock->correction_duration_ms, 1.0);
+        position += clock->correction_ms * progress;
+    }
+    return position;
+}
+
+// 以当前时间为新的基准，合并尚未完成的修正
+static void playback_clock_rebase(PlaybackClock *clock, gint64 time) {
+    clock->base_position_ms = playback_clock_position_exact(clock, time);
+    clock->base_time = time;
+    clock->correction_ms = 0;
+}
+
+gint64 playback_clock_position(const PlaybackClock *clock, gint64 now) {
+    if (!clock->valid) {
+        return -1;
+    }
+    return (gint64)playback_clock_position_exact(clock, now);
+}
+
+PlaybackClockAdjust playback_clock_observe(PlaybackClock *clock, gint64 position_ms, gint64 time) {
+    clock->stats.observations++;
+
+    if (!clock->valid) {
+        clock->valid = TRUE;
+        clock->base_position_ms = position_ms;
+        clock->base_time = time;
+        clock->correction_ms = 0;
+        clock->stats.jumps++;
+        return PLAYBACK_CLOCK_JUMP;
+    }
+
+    gdouble predicted = playback_clock_position_exact(clock, time);
+    gdouble error = position_ms - predicted;
+    clock->stats.last_error_ms = error;
+
+    if (fabs(error) > PLAYBACK_CLOCK_JUMP_THRESHOLD_MS) {
+        clock->base_position_ms = position_ms;
+        clock->base_time = time;
+        clock->correction_ms = 0;
+        clock->stats.jumps++;
+        return PLAYBACK_CLOCK_JUMP;
+    }
+
+    clock->stats.total_error_ms += fabs(error);
+    clock->stats.max_error_ms = MAX(clock->stats.max_error_ms, fabs(error));
+
+    // 从观测时间开始，在一段时间内逐渐消除偏差
+    clock->base_position_ms = predicted;
+    clock->base_time = time;
+    clock->correction_ms = error;
+    clock->correction_duration_ms = MAX(CORRECTION_MIN_DURATION_MS, fabs(error) * 2 / clock->rate);
+    return PLAYBACK_CLOCK_SLEW;
+}
+
+gboolean playback_clock_set_paused(PlaybackClock *clock, gboolean paused, gint64 time) {
+    if (clock->paused == paused) {
+        return FALSE;
+    }
+    if (clock->valid) {
+        playback_clock_rebase(clock, time);
+    }
+    clock->paused = paused;
+    return TRUE;
+}
+
+gboolean playback_clock_set_rate(PlaybackClock *clock, gdouble rate, gint64 time) {
+    if (rate <= 0 || rate == clock->rate) {
+        return FALSE;
+    }
+    if (clock->valid) {
+        playback_clock_rebase(clock, time);
+    }
+    clock->rate = rate;
+    return TRUE;
+}
+
+gint64 playback_clock_time_until(const PlaybackClock *clock, gint64 target_ms, gint64 now) {
+    if (!clock->valid || clock->paused) {
+        return -1;
+    }
+
+    gdouble remaining = target_ms - playback_clock_position_exact(clock, now);
+    if (remaining <= 0) {
+        return 0;
+    }
+    // 忽略正在进行的修正，换行时会重新计算
+    return (gint64)ceil(remaining / clock->rate);
+}
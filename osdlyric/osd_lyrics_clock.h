@@ -0,0 +1,80 @@
+#ifndef OSD_LYRICS_CLOCK_H
+#define OSD_LYRICS_CLOCK_H
+
+#include <glib.h>
+
+// 播放时钟模型：位置 = 基准位置 + (当前时间 - 基准时间) × 速率
+// 由服务器的 position 字段或歌词行的开始时间校准；小偏差在一段时间内平滑修正，
+// 大偏差视为跳转（拖动进度、换歌）立即生效；暂停时位置保持不变
+
+// 偏差超过此值时直接跳转而不平滑修正
+#define PLAYBACK_CLOCK_JUMP_THRESHOLD_MS 1000
+
+typedef enum {
+    PLAYBACK_CLOCK_SLEW = 0,   // 平滑修正
+    PLAYBACK_CLOCK_JUMP        // 跳转（包括第一次校准）
+} PlaybackClockAdjust;
+
+// 同步误差统计
+typedef struct {
+    guint64 observations;      // 校准次数
+    guint64 jumps;             // 跳转次数
+    gdouble total_error_ms;    // 平滑修正时的误差绝对值之和
+    gdouble max_error_ms;
+    gdouble last_error_ms;     // 最近一次校准的误差（观测值 - 预测值）
+} PlaybackClockStats;
+
+typedef struct {
+    gboolean valid;
+    gboolean paused;
+    gdouble rate;
+    gdouble base_position_ms;
+    gint64 base_time;          // 单调时钟，毫秒
+    gdouble correction_ms;     // 正在平滑修正的偏差
+    gdouble correction_duration_ms;
+
+    PlaybackClockStats stats;
+} PlaybackClock;
+
+/**
+ * 初始化时钟（未校准，速率1.0，播放中）
+ */
+void playback_clock_init(PlaybackClock *clock);
+
+/**
+ * 当前播放位置
+ * @param clock 时钟
+ * @param now 当前时间（单调时钟，毫秒）
+ * @return 位置（毫秒），未校准时返回-1
+ */
+gint64 playback_clock_position(const PlaybackClock *clock, gint64 now);
+
+/**
+ * 用一次位置观测校准时钟
+ * @param position_ms 观测到的位置
+ * @param time 观测时间（单调时钟，毫秒）
+ * @return 平滑修正还是跳转
+ */
+PlaybackClockAdjust playback_clock_observe(PlaybackClock *clock, gint64 position_ms, gint64 time);
+
+/**
+ * 设置暂停状态
+ * @return 状态发生变化时返回TRUE
+ */
+gboolean playback_clock_set_paused(PlaybackClock *clock, gboolean paused, gint64 time);
+
+/**
+ * 设置播放速率
+ * @return 速率发生变化时返回TRUE
+ */
+gboolean playback_clock_set_rate(PlaybackClock *clock, gdouble rate, gint64 time);
+
+/**
+ * 距离播放到指定位置还有多久
+ * @param target_ms 目标位置
+ * @param now 当前时间（单调时钟，毫秒）
+ * @return 等待时间（毫秒），暂停或未校准时返回-1
+ */
+gint64 playback_clock_time_until(const PlaybackClock *clock, gint64 target_ms, gint64 now);
+
+#endif // OSD_LYRICS_CLOCK_H
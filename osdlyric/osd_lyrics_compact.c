@@ -0,0 +1,389 @@
+#include <string.h>
+#include <zlib.h>
+#include "osd_lyrics_compact.h"
+#include "osd_lyrics_timeline.h"
+
+// 单帧和解压后整首歌词的上限，超过视为格式错误
+#define COMPACT_MAX_FRAME (4 * 1024 * 1024)
+#define COMPACT_MAX_DOCUMENT (16 * 1024 * 1024)
+// 时间（毫秒）的上限，行和音节的开始时间累加后也不超过，避免有符号溢出和负的时长
+#define COMPACT_MAX_TIME_MS G_MAXINT32
+
+#define PLAYBACK_HAS_POSITION 0x01
+#define PLAYBACK_HAS_PAUSED   0x02
+#define PLAYBACK_PAUSED       0x04
+#define PLAYBACK_HAS_RATE     0x08
+
+#define DOCUMENT_DEFLATE      0x01
+
+// 帧载荷读取位置
+typedef struct {
+    const guint8 *p;
+    const guint8 *end;
+} CompactReader;
+
+static const LyricsSlice empty_slice = {"", 0};
+
+static gboolean read_varint(CompactReader *reader, guint64 *value) {
+    guint shift = 0;
+    *value = 0;
+    while (reader->p < reader->end && shift < 64) {
+        guint8 byte = *reader->p++;
+        *value |= (guint64)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return TRUE;
+        }
+        shift += 7;
+    }
+    return FALSE;
+}
+
+static gboolean read_u8(CompactReader *reader, guint8 *value) {
+    if (reader->p >= reader->end) {
+        return FALSE;
+    }
+    *value = *reader->p++;
+    return TRUE;
+}
+
+// 字符串借用帧数据，不以'\0'结尾
+static gboolean read_string(CompactReader *reader, const gchar **str, gsize *len) {
+    guint64 length;
+    if (!read_varint(reader, &length) || length > (guint64)(reader->end - reader->p)) {
+        return FALSE;
+    }
+    *str = (const gchar *)reader->p;
+    *len = (gsize)length;
+    reader->p += length;
+    return TRUE;
+}
+
+// 读取一行到 decoder->syllables，start_ms 为行的绝对开始时间
+static gboolean read_line(LyricsCompactDecoder *decoder, CompactReader *reader, gint64 previous_start,
+                          gint64 *start_ms, gint64 *duration_ms, const gchar **text, gsize *text_len) {
+    guint64 start, duration, count;
+    if (!read_varint(reader, &start) || !read_varint(reader, &duration) || !read_varint(reader, &count)) {
+        return FALSE;
+    }
+    if (start > COMPACT_MAX_TIME_MS || duration > COMPACT_MAX_TIME_MS ||
+        (guint64)previous_start + start > COMPACT_MAX_TIME_MS) {
+        return FALSE;
+    }
+    // 每个音节至少3字节
+    if (count > (guint64)(reader->end - reader->p) / 3) {
+        return FALSE;
+    }
+
+    g_array_set_size(decoder->syllables, (guint)count);
+    LyricsSyllable *syllables = (LyricsSyllable *)(void *)decoder->syllables->data;
+    gint64 syllable_start = 0;
+    // 64位累计并逐个音节检查：文本在音节之后，长度不会超过帧的剩余部分
+    guint64 byte_offset = 0;
+    for (guint i = 0; i < (guint)count; i++) {
+        guint64 delta, syllable_duration, byte_length;
+        if (!read_varint(reader, &delta) || !read_varint(reader, &syllable_duration) ||
+            !read_varint(reader, &byte_length)) {
+            return FALSE;
+        }
+        guint64 remaining = (guint64)(reader->end - reader->p);
+        if (byte_length > G_MAXUINT || byte_offset > remaining || byte_length > remaining - byte_offset) {
+            return FALSE;
+        }
+        if (delta > COMPACT_MAX_TIME_MS || syllable_duration > COMPACT_MAX_TIME_MS ||
+            (guint64)syllable_start + delta > COMPACT_MAX_TIME_MS) {
+            return FALSE;
+        }
+        syllable_start += (gint64)delta;
+        syllables[i].start_ms = syllable_start;
+        syllables[i].duration_ms = (gint64)syllable_duration;
+        syllables[i].byte_offset = (guint)byte_offset;
+        syllables[i].byte_length = (guint)byte_length;
+        byte_offset += byte_length;
+    }
+
+    // 音节连续覆盖文本开头，总长度不超过文本即每个音节都在文本范围内
+    if (!read_string(reader, text, text_len) || byte_offset > (guint64)*text_len) {
+        return FALSE;
+    }
+    *start_ms = previous_start + (gint64)start;
+    *duration_ms = (gint64)duration;
+    return TRUE;
+}
+
+static void fill_song(const LyricsCompactDecoder *decoder, LyricsEvent *event) {
+    event->song_name.str = decoder->song_name ? decoder->song_name : "";
+    event->song_name.len = strlen(event->song_name.str);
+    event->artist.str = decoder->artist ? decoder->artist : "";
+    event->artist.len = strlen(event->artist.str);
+    event->format.str = decoder->krc ? "krc" : "lrc";
+    event->format.len = 3;
+}
+
+// 分发前结束本帧的计时，回调耗时不计入解码
+static void dispatch_event(LyricsCompactDecoder *decoder, LyricsEvent *event, gint64 start_time) {
+    decoder->stats.decode_time_us += g_get_monotonic_time() - start_time;
+    decoder->callback(event, decoder->user_data);
+    lyrics_timeline_free(event->timeline);
+}
+
+static gboolean decode_song(LyricsCompactDecoder *decoder, CompactReader *reader) {
+    guint64 song_id;
+    const gchar *name, *artist;
+    gsize name_len, artist_len;
+    guint8 format;
+
+    if (!read_varint(reader, &song_id) || !read_string(reader, &name, &name_len) ||
+        !read_string(reader, &artist, &artist_len) || !read_u8(reader, &format)) {
+        return FALSE;
+    }
+
+    g_free(decoder->song_name);
+    g_free(decoder->artist);
+    decoder->song_id = song_id;
+    decoder->song_name = g_strndup(name, name_len);
+    decoder->artist = g_strndup(artist, artist_len);
+    decoder->krc = format == 1;
+    return TRUE;
+}
+
+static gboolean check_song(LyricsCompactDecoder *decoder, CompactReader *reader) {
+    guint64 song_id;
+    return read_varint(reader, &song_id) && decoder->song_name && song_id == decoder->song_id;
+}
+
+static gboolean decode_line(LyricsCompactDecoder *decoder, CompactReader *reader, LyricsEvent *event) {
+    gint64 start_ms, duration_ms;
+    const gchar *text;
+    gsize text_len;
+
+    if (!check_song(decoder, reader) ||
+        !read_line(decoder, reader, 0, &start_ms, &duration_ms, &text, &text_len)) {
+        return FALSE;
+    }
+
+    // 下游（队列去重、同步参考、无时间轴时的显示）使用与文本编码相同的行格式
+    g_string_truncate(decoder->line, 0);
+    lyrics_timeline_format_line(decoder->line, decoder->krc, start_ms, duration_ms,
+                                (const LyricsSyllable *)(void *)decoder->syllables->data,
+                                decoder->syllables->len, text, text_len);
+
+    event->type = LYRICS_EVENT_LYRICS_UPDATE;
+    event->text.str = decoder->line->str;
+    event->text.len = decoder->line->len;
+    fill_song(decoder, event);
+    return TRUE;
+}
+
+// 整首歌词直接构建为时间轴，不经过文本解析
+static gboolean decode_document(LyricsCompactDecoder *decoder, CompactReader *reader, LyricsEvent *event) {
+    guint8 flags;
+    guint64 raw_len;
+
+    if (!check_song(decoder, reader) || !read_u8(reader, &flags) || !read_varint(reader, &raw_len) ||
+        raw_len > COMPACT_MAX_DOCUMENT) {
+        return FALSE;
+    }
+
+    CompactReader data = *reader;
+    if (flags & DOCUMENT_DEFLATE) {
+        uLongf inflated_len = (uLongf)raw_len;
+        g_byte_array_set_size(decoder->inflated, (guint)raw_len);
+        if (uncompress(decoder->inflated->data, &inflated_len, reader->p, (uLong)(reader->end - reader->p)) != Z_OK ||
+            inflated_len != raw_len) {
+            return FALSE;
+        }
+        data.p = decoder->inflated->data;
+        data.end = data.p + inflated_len;
+        decoder->stats.inflated_bytes += inflated_len;
+    } else if (raw_len != (guint64)(reader->end - reader->p)) {
+        return FALSE;
+    }
+
+    guint64 n_lines;
+    if (!read_varint(&data, &n_lines)) {
+        return FALSE;
+    }
+
+    LyricsTimelineBuilder *builder = lyrics_timeline_builder_new(decoder->song_name, decoder->krc ? "krc" : "lrc",
+                                                                 (gsize)raw_len);
+    gint64 previous_start = 0;
+    for (guint64 i = 0; i < n_lines; i++) {
+        gint64 start_ms, duration_ms;
+        const gchar *text;
+        gsize text_len;
+        if (!read_line(decoder, &data, previous_start, &start_ms, &duration_ms, &text, &text_len)) {
+            lyrics_timeline_free(lyrics_timeline_builder_finish(builder));
+            return FALSE;
+        }
+        lyrics_timeline_builder_add_line(builder, start_ms, duration_ms,
+                                         (const LyricsSyllable *)(void *)decoder->syllables->data,
+                                         decoder->syllables->len, text, text_len);
+        previous_start = start_ms;
+    }
+
+    event->type = LYRICS_EVENT_LYRICS_DOCUMENT;
+    event->timeline = lyrics_timeline_builder_finish(builder);
+    fill_song(decoder, event);
+    decoder->stats.documents++;
+    return TRUE;
+}
+
+static gboolean decode_playback(CompactReader *reader, LyricsEvent *event) {
+    guint8 flags;
+    guint64 value;
+
+    if (!read_u8(reader, &flags)) {
+        return FALSE;
+    }
+    if (flags & PLAYBACK_HAS_POSITION) {
+        if (!read_varint(reader, &value)) return FALSE;
+        event->position_ms = (gint64)value;
+    }
+    if (flags & PLAYBACK_HAS_PAUSED) {
+        event->paused = (flags & PLAYBACK_PAUSED) ? 1 : 0;
+    }
+    if (flags & PLAYBACK_HAS_RATE) {
+        if (!read_varint(reader, &value)) return FALSE;
+        event->rate = value / 1000.0;
+    }
+    event->type = LYRICS_EVENT_UNKNOWN;
+    return TRUE;
+}
+
+// 解码一个完整的帧
+static gboolean decode_frame(LyricsCompactDecoder *decoder, const guint8 *frame, gsize len) {
+    gint64 start_time = g_get_monotonic_time();
+    CompactReader reader = {frame + 1, frame + len};
+    LyricsEvent event;
+    gboolean ok;
+
+    memset(&event, 0, sizeof(event));
+    event.position_ms = -1;
+    event.paused = -1;
+    event.type_name = empty_slice;
+    event.text = empty_slice;
+    event.song_name = empty_slice;
+    event.artist = empty_slice;
+    event.format = empty_slice;
+
+    switch (frame[0]) {
+    case LYRICS_COMPACT_CONNECTED:
+        event.type = LYRICS_EVENT_CONNECTED;
+        ok = TRUE;
+        break;
+    case LYRICS_COMPACT_HEARTBEAT:
+        event.type = LYRICS_EVENT_HEARTBEAT;
+        ok = TRUE;
+        break;
+    case LYRICS_COMPACT_SONG:
+        // 只更新歌曲表，不产生事件
+        ok = decode_song(decoder, &reader);
+        decoder->stats.frames += ok;
+        decoder->stats.decode_time_us += g_get_monotonic_time() - start_time;
+        return ok;
+    case LYRICS_COMPACT_LINE:
+        ok = decode_line(decoder, &reader, &event);
+        break;
+    case LYRICS_COMPACT_DOCUMENT:
+        ok = decode_document(decoder, &reader, &event);
+        break;
+    case LYRICS_COMPACT_PLAYBACK:
+        ok = decode_playback(&reader, &event);
+        break;
+    default:
+        // 新版本服务器的帧类型，跳过
+        decoder->stats.skipped++;
+        return TRUE;
+    }
+
+    if (!ok) {
+        return FALSE;
+    }
+    decoder->stats.frames++;
+    dispatch_event(decoder, &event, start_time);
+    return TRUE;
+}
+
+// 解码 data 中所有完整的帧，返回已消耗的字节数，格式错误时返回-1
+static gssize decode_frames(LyricsCompactDecoder *decoder, const guint8 *data, gsize len) {
+    CompactReader reader = {data, data + len};
+
+    while (reader.p < reader.end) {
+        const guint8 *frame_start = reader.p;
+        guint64 frame_len;
+        if (!read_varint(&reader, &frame_len)) {
+            // 长度本身不完整（varint最多10字节）
+            if (reader.end - frame_start >= 10) {
+                return -1;
+            }
+            return frame_start - data;
+        }
+        if (frame_len == 0 || frame_len > COMPACT_MAX_FRAME) {
+            return -1;
+        }
+        if (frame_len > (guint64)(reader.end - reader.p)) {
+            return frame_start - data;
+        }
+        if (!decode_frame(decoder, reader.p, (gsize)frame_len)) {
+            return -1;
+        }
+        reader.p += frame_len;
+    }
+    return len;
+}
+
+void lyrics_compact_decoder_init(LyricsCompactDecoder *decoder, LyricsCompactFunc callback, gpointer user_data) {
+    memset(decoder, 0, sizeof(LyricsCompactDecoder));
+    decoder->pending = g_byte_array_new();
+    decoder->syllables = g_array_new(FALSE, FALSE, sizeof(LyricsSyllable));
+    decoder->line = g_string_sized_new(256);
+    decoder->inflated = g_byte_array_new();
+    decoder->callback = callback;
+    decoder->user_data = user_data;
+}
+
+void lyrics_compact_decoder_reset(LyricsCompactDecoder *decoder) {
+    g_byte_array_set_size(decoder->pending, 0);
+    g_free(decoder->song_name);
+    g_free(decoder->artist);
+    decoder->song_name = NULL;
+    decoder->artist = NULL;
+    decoder->song_id = 0;
+    decoder->krc = FALSE;
+}
+
+void lyrics_compact_decoder_clear(LyricsCompactDecoder *decoder) {
+    lyrics_compact_decoder_reset(decoder);
+    g_byte_array_free(decoder->pending, TRUE);
+    g_array_free(decoder->syllables, TRUE);
+    g_string_free(decoder->line, TRUE);
+    g_byte_array_free(decoder->inflated, TRUE);
+}
+
+gboolean lyrics_compact_decoder_feed(LyricsCompactDecoder *decoder, const gchar *chunk, gsize len) {
+    const guint8 *data = (const guint8 *)chunk;
+    gssize consumed;
+
+    decoder->stats.bytes += len;
+
+    if (decoder->pending->len == 0) {
+        // 常见情况：直接解码网络数据，只保留末尾不完整的帧
+        consumed = decode_frames(decoder, data, len);
+        if (consumed >= 0 && (gsize)consumed < len) {
+            g_byte_array_append(decoder->pending, data + consumed, len - consumed);
+        }
+    } else {
+        g_byte_array_append(decoder->pending, data, len);
+        consumed = decode_frames(decoder, decoder->pending->data, decoder->pending->len);
+        if (consumed > 0) {
+            g_byte_array_remove_range(decoder->pending, 0, (guint)consumed);
+        }
+    }
+
+    if (consumed < 0) {
+        decoder->stats.errors++;
+        g_byte_array_set_size(decoder->pending, 0);
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,91 @@
+#ifndef OSD_LYRICS_COMPACT_H
+#define OSD_LYRICS_COMPACT_H
+
+#include <glib.h>
+#include "osd_lyrics_event.h"
+
+// 紧凑二进制事件编码
+// 客户端在Accept中声明支持，服务器以 LYRICS_COMPACT_CONTENT_TYPE 响应时使用，否则仍然是SSE文本。
+//
+// 流由连续的帧组成：varint(帧长度) + u8(类型) + 载荷，整数都是无符号LEB128 varint，
+// 字符串为 varint(长度) + 字节：
+//   CONNECTED / HEARTBEAT  无载荷
+//   SONG      歌曲ID, 歌曲名, 歌手, u8(0=LRC 1=KRC)        每首歌只发送一次
+//   LINE      歌曲ID, 行                                     单行歌词
+//   DOCUMENT  歌曲ID, u8(标志，bit0=zlib压缩), varint(原始长度), 数据
+//             数据为 varint(行数) + 行...，行的开始时间为与上一行的差值
+//   PLAYBACK  u8(标志：1=有位置 2=有暂停状态 4=暂停 8=有速率), [位置毫秒], [速率×1000]
+// 行：开始时间, 时长, 音节数, 音节(与上一个音节开始时间的差值, 时长, 字节数)..., 纯文本
+// 音节按顺序连续覆盖纯文本的开头部分，解码时直接得到 LyricsSyllable 数组
+
+#define LYRICS_COMPACT_CONTENT_TYPE "application/x-osd-lyrics-compact"
+
+typedef enum {
+    LYRICS_COMPACT_CONNECTED = 1,
+    LYRICS_COMPACT_HEARTBEAT = 2,
+    LYRICS_COMPACT_SONG = 3,
+    LYRICS_COMPACT_LINE = 4,
+    LYRICS_COMPACT_DOCUMENT = 5,
+    LYRICS_COMPACT_PLAYBACK = 6
+} LyricsCompactFrameType;
+
+/**
+ * 解码出一个事件，event 只在回调期间有效
+ * 回调可以取走 event->timeline 的所有权（置为NULL），否则由解码器释放
+ */
+typedef void (*LyricsCompactFunc)(LyricsEvent *event, gpointer user_data);
+
+// 解码统计
+typedef struct {
+    guint64 bytes;           // 输入字节数
+    guint64 frames;          // 解码的帧数
+    guint64 skipped;         // 未知类型而跳过的帧
+    guint64 errors;          // 格式错误
+    guint64 documents;       // 整首歌词
+    guint64 inflated_bytes;  // 解压后的字节数
+    guint64 decode_time_us;  // 解码耗时（不含回调）
+} LyricsCompactStats;
+
+typedef struct {
+    GByteArray *pending;     // 跨数据块的不完整帧
+    GArray *syllables;       // 复用的音节数组
+    GString *line;           // 复用的行文本（还原为LRC/KRC格式）
+    GByteArray *inflated;    // 复用的解压缓冲区
+
+    // 当前歌曲（SONG帧）
+    guint64 song_id;
+    gchar *song_name;
+    gchar *artist;
+    gboolean krc;
+
+    LyricsCompactFunc callback;
+    gpointer user_data;
+
+    LyricsCompactStats stats;
+} LyricsCompactDecoder;
+
+/**
+ * 初始化解码器
+ * @param decoder 解码器
+ * @param callback 事件回调
+ * @param user_data 回调用户数据
+ */
+void lyrics_compact_decoder_init(LyricsCompactDecoder *decoder, LyricsCompactFunc callback, gpointer user_data);
+
+/**
+ * 重置流状态（新连接时调用），保留统计信息
+ */
+void lyrics_compact_decoder_reset(LyricsCompactDecoder *decoder);
+
+/**
+ * 释放解码器资源
+ */
+void lyrics_compact_decoder_clear(LyricsCompactDecoder *decoder);
+
+/**
+ * 输入一块网络数据，完整的帧会同步分发给回调
+ * @return 数据格式错误时返回FALSE，调用方应断开连接
+ */
+gboolean lyrics_compact_decoder_feed(LyricsCompactDecoder *decoder, const gchar *chunk, gsize len);
+
+#endif // OSD_LYRICS_COMPACT_H
@@ -0,0 +1,127 @@
+#include <string.h>
+#include <math.h>
+#include "osd_lyrics_endpoint.h"
+
+// 指数移动平均的权重
+#define ENDPOINT_EWMA_ALPHA 0.3
+// 连接耗时达到此值时得分减半
+#define ENDPOINT_CONNECT_REFERENCE_MS 500.0
+// 学习心跳间隔需要的样本数
+#define ENDPOINT_MIN_HEARTBEAT_SAMPLES 3
+// 无数据超时为心跳间隔的倍数，最短2秒
+#define ENDPOINT_STALL_HEARTBEATS 3.0
+#define ENDPOINT_MIN_STALL_SECONDS 2
+
+static const gchar *kind_names[] = {"tcp", "unix", "unix-abstract"};
+
+static gdouble ewma(gdouble average, gdouble sample) {
+    return average + ENDPOINT_EWMA_ALPHA * (sample - average);
+}
+
+// 解析 <套接字>[:<请求路径>]，请求发往 http://localhost<请求路径>
+static void parse_socket_address(SSEEndpoint *endpoint, const gchar *address) {
+    const gchar *path = strstr(address, ":/");
+
+    if (path) {
+        endpoint->socket_path = g_strndup(address, path - address);
+        path++;
+    } else {
+        endpoint->socket_path = g_strdup(address);
+        path = SSE_ENDPOINT_DEFAULT_PATH;
+    }
+    endpoint->request_url = g_strconcat("http://localhost", path, NULL);
+}
+
+void sse_endpoint_init(SSEEndpoint *endpoint, const gchar *url) {
+    memset(endpoint, 0, sizeof(SSEEndpoint));
+    endpoint->url = g_strdup(url);
+    endpoint->connect_ms = -1;
+
+    if (g_str_has_prefix(url, "unix-abstract:")) {
+        endpoint->kind = SSE_ENDPOINT_UNIX_ABSTRACT;
+        parse_socket_address(endpoint, url + strlen("unix-abstract:"));
+    } else if (g_str_has_prefix(url, "unix:")) {
+        endpoint->kind = SSE_ENDPOINT_UNIX;
+        parse_socket_address(endpoint, url + strlen("unix:"));
+    } else {
+        endpoint->kind = SSE_ENDPOINT_TCP;
+        endpoint->request_url = g_strdup(url);
+    }
+}
+
+void sse_endpoint_clear(SSEEndpoint *endpoint) {
+    g_free(endpoint->url);
+    g_free(endpoint->request_url);
+    g_free(endpoint->socket_path);
+    endpoint->url = NULL;
+    endpoint->request_url = NULL;
+    endpoint->socket_path = NULL;
+}
+
+void sse_endpoint_begin_attempt(SSEEndpoint *endpoint) {
+    endpoint->attempts++;
+    // 心跳间隔只在同一个连接内计算
+    endpoint->last_heartbeat_time = 0;
+}
+
+void sse_endpoint_record_connect(SSEEndpoint *endpoint, gint64 connect_ms) {
+    endpoint->connects++;
+    endpoint->connect_ms = endpoint->connect_ms < 0 ? connect_ms : ewma(endpoint->connect_ms, connect_ms);
+    endpoint->error_rate = ewma(endpoint->error_rate, 0.0);
+    endpoint->consecutive_failures = 0;
+    endpoint->retry_time = 0;
+}
+
+void sse_endpoint_record_end(SSEEndpoint *endpoint, gboolean streamed, gint64 retry_time) {
+    if (streamed) {
+        endpoint->drops++;
+    } else {
+        endpoint->failures++;
+    }
+    endpoint->error_rate = ewma(endpoint->error_rate, 1.0);
+    endpoint->retry_time = retry_time;
+}
+
+void sse_endpoint_record_heartbeat(SSEEndpoint *endpoint, gint64 now) {
+    if (endpoint->last_heartbeat_time > 0) {
+        gdouble interval = now - endpoint->last_heartbeat_time;
+        if (endpoint->heartbeat_samples == 0) {
+            endpoint->heartbeat_interval_ms = interval;
+        } else {
+            endpoint->heartbeat_jitter_ms = ewma(endpoint->heartbeat_jitter_ms,
+                                                 fabs(interval - endpoint->heartbeat_interval_ms));
+            endpoint->heartbeat_interval_ms = ewma(endpoint->heartbeat_interval_ms, interval);
+        }
+        endpoint->heartbeat_samples++;
+    }
+    endpoint->last_heartbeat_time = now;
+}
+
+gboolean sse_endpoint_is_available(const SSEEndpoint *endpoint, gint64 now) {
+    return now >= endpoint->retry_time;
+}
+
+const gchar* sse_endpoint_kind_name(const SSEEndpoint *endpoint) {
+    return kind_names[endpoint->kind];
+}
+
+gdouble sse_endpoint_score(const SSEEndpoint *endpoint) {
+    gdouble score = 1.0 - endpoint->error_rate;
+
+    if (endpoint->connect_ms >= 0) {
+        score /= 1.0 + endpoint->connect_ms / ENDPOINT_CONNECT_REFERENCE_MS;
+    }
+    if (endpoint->heartbeat_samples >= ENDPOINT_MIN_HEARTBEAT_SAMPLES && endpoint->heartbeat_interval_ms > 0) {
+        score /= 1.0 + endpoint->heartbeat_jitter_ms / endpoint->heartbeat_interval_ms;
+    }
+    return score;
+}
+
+glong sse_endpoint_stall_timeout(const SSEEndpoint *endpoint) {
+    if (endpoint->heartbeat_samples < ENDPOINT_MIN_HEARTBEAT_SAMPLES) {
+        return 0;
+    }
+
+    gdouble timeout_ms = ENDPOINT_STALL_HEARTBEATS * endpoint->heartbeat_interval_ms + 2 * endpoint->heartbeat_jitter_ms;
+    return MAX((glong)ceil(timeout_ms / 1000.0), ENDPOINT_MIN_STALL_SECONDS);
+}
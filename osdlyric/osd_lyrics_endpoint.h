@@ -0,0 +1,106 @@
+#ifndef OSD_LYRICS_ENDPOINT_H
+#define OSD_LYRICS_ENDPOINT_H
+
+#include <glib.h>
+
+// SSE端点健康度
+// 每个端点根据连接耗时、出错比例和心跳规律性打分，失败的端点各自退避；
+// 当前端点断开时，客户端立即切换到得分最高的可用端点，而不是等待退避结束
+//
+// 除了普通的http(s) URL，还支持本机的Unix域套接字（写法与nginx相同，冒号后为请求路径，可省略）：
+//   unix:/run/user/1000/gomusic.sock:/api/osd-lyrics/sse
+//   unix-abstract:gomusic:/api/osd-lyrics/sse   （Linux抽象命名空间，不占用文件系统路径）
+
+// 省略请求路径时使用的默认路径
+#define SSE_ENDPOINT_DEFAULT_PATH "/api/osd-lyrics/sse"
+
+typedef enum {
+    SSE_ENDPOINT_TCP = 0,        // http(s)
+    SSE_ENDPOINT_UNIX,           // unix:
+    SSE_ENDPOINT_UNIX_ABSTRACT   // unix-abstract:
+} SSEEndpointKind;
+
+typedef struct {
+    gchar *url;                  // 用户指定的地址，用于日志
+    SSEEndpointKind kind;
+    gchar *request_url;          // 交给curl的URL
+    gchar *socket_path;          // Unix套接字路径或抽象名称，TCP时为NULL
+
+    // 连接结果
+    guint64 attempts;            // 连接尝试次数
+    guint64 connects;            // 成功收到数据的次数
+    guint64 failures;            // 未收到数据就失败的次数
+    guint64 drops;               // 收到过数据后断开的次数
+    gdouble connect_ms;          // 连接耗时的指数移动平均，<0表示还没有样本
+    gdouble error_rate;          // 出错比例的指数移动平均（成功记0，失败或断开记1）
+
+    // 心跳规律性
+    gint64 last_heartbeat_time;  // 本次连接上一次心跳的时间（毫秒），0表示还没有
+    gdouble heartbeat_interval_ms; // 心跳间隔的指数移动平均
+    gdouble heartbeat_jitter_ms;   // 心跳间隔偏差的指数移动平均
+    guint64 heartbeat_samples;
+
+    // 退避
+    guint consecutive_failures;  // 连续失败次数，收到数据后清零
+    gint64 retry_time;           // 在此时间（毫秒）之前不再尝试
+} SSEEndpoint;
+
+/**
+ * 初始化端点并解析地址
+ * @param endpoint 端点
+ * @param url SSE连接URL，http(s)、unix: 或 unix-abstract:
+ */
+void sse_endpoint_init(SSEEndpoint *endpoint, const gchar *url);
+
+/**
+ * 释放端点占用的资源
+ */
+void sse_endpoint_clear(SSEEndpoint *endpoint);
+
+/**
+ * 记录一次连接尝试的开始
+ */
+void sse_endpoint_begin_attempt(SSEEndpoint *endpoint);
+
+/**
+ * 记录连接成功（收到第一块数据）
+ * @param connect_ms 从发起连接到收到数据的时间
+ */
+void sse_endpoint_record_connect(SSEEndpoint *endpoint, gint64 connect_ms);
+
+/**
+ * 记录连接结束
+ * @param streamed 是否收到过数据
+ * @param retry_time 下一次允许尝试的时间（毫秒）
+ */
+void sse_endpoint_record_end(SSEEndpoint *endpoint, gboolean streamed, gint64 retry_time);
+
+/**
+ * 记录一次心跳
+ * @param now 当前时间（毫秒）
+ */
+void sse_endpoint_record_heartbeat(SSEEndpoint *endpoint, gint64 now);
+
+/**
+ * 端点是否已结束退避
+ */
+gboolean sse_endpoint_is_available(const SSEEndpoint *endpoint, gint64 now);
+
+/**
+ * 端点类型名称（"tcp"、"unix"、"unix-abstract"）
+ */
+const gchar* sse_endpoint_kind_name(const SSEEndpoint *endpoint);
+
+/**
+ * 健康得分，越高越好 (0.0 - 1.0)，得分相同时按端点列表顺序优先
+ * (1 - 出错比例) × 连接耗时因子 × 心跳规律性因子，没有样本的项按满分计
+ */
+gdouble sse_endpoint_score(const SSEEndpoint *endpoint);
+
+/**
+ * 无数据超时（秒）：根据学习到的心跳间隔检测已经断开但没有关闭的连接
+ * @return 超时秒数，心跳样本不足时返回0表示不检测
+ */
+glong sse_endpoint_stall_timeout(const SSEEndpoint *endpoint);
+
+#endif // OSD_LYRICS_ENDPOINT_H
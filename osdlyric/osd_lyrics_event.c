@@ -0,0 +1,448 @@
+#include <math.h>
+#include <string.h>
+#include "osd_lyrics_event.h"
+
+// 快速路径第一遍扫描记录的字符串字段位置
+typedef struct {
+    gchar *start;        // 引号之后的第一个字符
+    gchar *end;          // 结尾引号
+    gboolean escaped;    // 是否包含转义序列
+    gboolean present;
+} FastField;
+
+enum {
+    FIELD_TYPE = 0,
+    FIELD_TEXT,
+    FIELD_SONG_NAME,
+    FIELD_ARTIST,
+    FIELD_FORMAT,
+    FIELD_COUNT
+};
+
+enum {
+    SCALAR_POSITION = 0,
+    SCALAR_PAUSED,
+    SCALAR_RATE
+};
+
+static const LyricsSlice empty_slice = {"", 0};
+
+// 播放位置必须是 0..G_MAXINT64 范围内的有限数，否则转换为整数是未定义行为
+static gboolean position_from_number(gdouble number, gint64 *position_ms) {
+    if (!isfinite(number) || number < 0 || number >= (gdouble)G_MAXINT64) {
+        return FALSE;
+    }
+    *position_ms = (gint64)number;
+    return TRUE;
+}
+
+// json_tokener在第一个完整值之后停止，返回已消费的字节数
+static gsize tokener_parse_end(json_tokener *tokener) {
+#if JSON_C_VERSION_NUM >= ((0 << 16) | (15 << 8))
+    return json_tokener_get_parse_end(tokener);
+#else
+    return (gsize)tokener->char_offset;
+#endif
+}
+
+void lyrics_event_decoder_init(LyricsEventDecoder *decoder) {
+    memset(decoder, 0, sizeof(LyricsEventDecoder));
+    decoder->tokener = json_tokener_new();
+}
+
+void lyrics_event_decoder_clear(LyricsEventDecoder *decoder) {
+    if (decoder->fallback_root) {
+        json_object_put(decoder->fallback_root);
+        decoder->fallback_root = NULL;
+    }
+    if (decoder->tokener) {
+        json_tokener_free(decoder->tokener);
+        decoder->tokener = NULL;
+    }
+}
+
+static LyricsEventType lyrics_event_type_from_name(const gchar *name, gsize len) {
+    switch (len) {
+    case 9:
+        if (memcmp(name, "connected", 9) == 0) return LYRICS_EVENT_CONNECTED;
+        if (memcmp(name, "heartbeat", 9) == 0) return LYRICS_EVENT_HEARTBEAT;
+        break;
+    case 13:
+        if (memcmp(name, "lyrics_update", 13) == 0) return LYRICS_EVENT_LYRICS_UPDATE;
+        break;
+    case 15:
+        if (memcmp(name, "lyrics_document", 15) == 0) return LYRICS_EVENT_LYRICS_DOCUMENT;
+        break;
+    default:
+        break;
+    }
+    return LYRICS_EVENT_UNKNOWN;
+}
+
+static gint fast_field_index(const gchar *key, gsize len) {
+    switch (len) {
+    case 4:
+        if (memcmp(key, "type", 4) == 0) return FIELD_TYPE;
+        if (memcmp(key, "text", 4) == 0) return FIELD_TEXT;
+        break;
+    case 6:
+        if (memcmp(key, "artist", 6) == 0) return FIELD_ARTIST;
+        if (memcmp(key, "format", 6) == 0) return FIELD_FORMAT;
+        break;
+    case 8:
+        if (memcmp(key, "songName", 8) == 0) return FIELD_SONG_NAME;
+        break;
+    default:
+        break;
+    }
+    return -1;
+}
+
+// 播放状态字段（数字或布尔值）
+static gint fast_scalar_index(const gchar *key, gsize len) {
+    switch (len) {
+    case 4:
+        if (memcmp(key, "rate", 4) == 0) return SCALAR_RATE;
+        break;
+    case 6:
+        if (memcmp(key, "paused", 6) == 0) return SCALAR_PAUSED;
+        break;
+    case 8:
+        if (memcmp(key, "position", 8) == 0) return SCALAR_POSITION;
+        break;
+    default:
+        break;
+    }
+    return -1;
+}
+
+static void reset_playback_fields(LyricsEvent *event) {
+    event->position_ms = -1;
+    event->paused = -1;
+    event->rate = 0;
+}
+
+static inline const gchar* skip_ws(const gchar *p) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    return p;
+}
+
+static inline gint hex_value(gchar c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static gint parse_hex4(const gchar *p) {
+    gint value = 0;
+    for (gint i = 0; i < 4; i++) {
+        gint digit = hex_value(p[i]);
+        if (digit < 0) return -1;
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+// 扫描一个字符串（p指向开头引号），不修改数据；返回结尾引号之后的位置
+static const gchar* scan_string(const gchar *p, FastField *field) {
+    p++; // 跳过开头引号
+    field->start = (gchar *)p;
+    field->escaped = FALSE;
+
+    while (*p != '"') {
+        if (*p == '\0' || (guchar)*p < 0x20) {
+            return NULL;
+        }
+        if (*p == '\\') {
+            field->escaped = TRUE;
+            p++;
+            switch (*p) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                p++;
+                break;
+            case 'u': {
+                gint code = parse_hex4(p + 1);
+                // \u0000 会截断C字符串，孤立的代理项交给json-c处理
+                if (code <= 0 || (code >= 0xDC00 && code <= 0xDFFF)) return NULL;
+                p += 5;
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    if (p[0] != '\\' || p[1] != 'u') return NULL;
+                    gint low = parse_hex4(p + 2);
+                    if (low < 0xDC00 || low > 0xDFFF) return NULL;
+                    p += 6;
+                }
+                break;
+            }
+            default:
+                return NULL;
+            }
+        } else {
+            p++;
+        }
+    }
+
+    field->end = (gchar *)p;
+    return p + 1;
+}
+
+static inline const gchar* skip_digits(const gchar *p) {
+    while (*p >= '0' && *p <= '9') p++;
+    return p;
+}
+
+// 按JSON数字语法跳过一个数字：-?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+// 不符合语法时返回NULL，整个事件交给json-c处理（与json-c一样拒绝 1-2、--、01 等）
+static const gchar* skip_number(const gchar *p) {
+    if (*p == '-') p++;
+    if (*p == '0') {
+        p++;
+    } else if (*p >= '1' && *p <= '9') {
+        p = skip_digits(p);
+    } else {
+        return NULL;
+    }
+    if (*p == '.') {
+        const gchar *fraction = p + 1;
+        p = skip_digits(fraction);
+        if (p == fraction) return NULL;
+    }
+    if (*p == 'e' || *p == 'E') {
+        p++;
+        if (*p == '+' || *p == '-') p++;
+        const gchar *exponent = p;
+        p = skip_digits(exponent);
+        if (p == exponent) return NULL;
+    }
+    return p;
+}
+
+// 跳过数字或 true/false/null
+static const gchar* skip_scalar(const gchar *p) {
+    if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        return skip_number(p);
+    }
+    if (strncmp(p, "true", 4) == 0) return p + 4;
+    if (strncmp(p, "false", 5) == 0) return p + 5;
+    if (strncmp(p, "null", 4) == 0) return p + 4;
+    return NULL;
+}
+
+// 原地反转义并以'\0'结尾，输出总是不长于输入
+static LyricsSlice unescape_in_place(FastField *field) {
+    LyricsSlice slice;
+
+    if (!field->escaped) {
+        *field->end = '\0';
+        slice.str = field->start;
+        slice.len = field->end - field->start;
+        return slice;
+    }
+
+    const gchar *src = field->start;
+    gchar *dst = field->start;
+    while (src < field->end) {
+        if (*src != '\\') {
+            *dst++ = *src++;
+            continue;
+        }
+        src++;
+        switch (*src++) {
+        case 'b': *dst++ = '\b'; break;
+        case 'f': *dst++ = '\f'; break;
+        case 'n': *dst++ = '\n'; break;
+        case 'r': *dst++ = '\r'; break;
+        case 't': *dst++ = '\t'; break;
+        case 'u': {
+            gunichar code = parse_hex4(src);
+            src += 4;
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                gunichar low = parse_hex4(src + 2);
+                src += 6;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            dst += g_unichar_to_utf8(code, dst);
+            break;
+        }
+        default:
+            // '"', '\\', '/'
+            *dst++ = src[-1];
+            break;
+        }
+    }
+    *dst = '\0';
+
+    slice.str = field->start;
+    slice.len = dst - field->start;
+    return slice;
+}
+
+// 快速路径：只接受所有值都是标量的扁平对象，已知字段必须是字符串
+static gboolean decode_fast(gchar *data, LyricsEvent *event) {
+    FastField fields[FIELD_COUNT];
+    memset(fields, 0, sizeof(fields));
+
+    // 第一遍：只扫描结构，不修改数据，不支持的结构原样交给json-c
+    const gchar *p = skip_ws(data);
+    if (*p != '{') return FALSE;
+    p = skip_ws(p + 1);
+
+    if (*p != '}') {
+        while (TRUE) {
+            FastField key;
+            if (*p != '"') return FALSE;
+            p = scan_string(p, &key);
+            if (!p || key.escaped) return FALSE;
+
+            p = skip_ws(p);
+            if (*p != ':') return FALSE;
+            p = skip_ws(p + 1);
+
+            gint index = fast_field_index(key.start, key.end - key.start);
+            gint scalar = index < 0 ? fast_scalar_index(key.start, key.end - key.start) : -1;
+            if (scalar >= 0) {
+                // 播放状态：位置和速率必须是数字，暂停必须是布尔值
+                const gchar *value_end = skip_scalar(p);
+                if (!value_end) return FALSE;
+                if (scalar == SCALAR_PAUSED) {
+                    if (*p != 't' && *p != 'f') return FALSE;
+                    event->paused = *p == 't';
+                } else {
+                    if (*p != '-' && (*p < '0' || *p > '9')) return FALSE;
+                    // 超出范围的数字交给回退路径判断
+                    gdouble number = g_ascii_strtod(p, NULL);
+                    if (scalar == SCALAR_POSITION) {
+                        if (!position_from_number(number, &event->position_ms)) return FALSE;
+                    } else {
+                        if (!isfinite(number)) return FALSE;
+                        event->rate = number;
+                    }
+                }
+                p = value_end;
+            } else if (*p == '"') {
+                FastField value;
+                p = scan_string(p, &value);
+                if (!p) return FALSE;
+                if (index >= 0) {
+                    value.present = TRUE;
+                    fields[index] = value;
+                }
+            } else {
+                // 嵌套对象/数组，或已知字段不是字符串
+                if (index >= 0) return FALSE;
+                p = skip_scalar(p);
+                if (!p) return FALSE;
+            }
+
+            p = skip_ws(p);
+            if (*p == ',') {
+                p = skip_ws(p + 1);
+                continue;
+            }
+            if (*p == '}') break;
+            return FALSE;
+        }
+    }
+    if (*skip_ws(p + 1) != '\0') return FALSE;
+
+    // 第二遍：结构有效，原地反转义各字段
+    LyricsSlice *slices[FIELD_COUNT] = {
+        &event->type_name, &event->text, &event->song_name, &event->artist, &event->format
+    };
+    for (gint i = 0; i < FIELD_COUNT; i++) {
+        *slices[i] = fields[i].present ? unescape_in_place(&fields[i]) : empty_slice;
+    }
+
+    return TRUE;
+}
+
+static void slice_from_json(json_object *root, const char *key, LyricsSlice *slice) {
+    json_object *obj;
+    const char *str;
+
+    *slice = empty_slice;
+    if (json_object_object_get_ex(root, key, &obj) && (str = json_object_get_string(obj)) != NULL) {
+        slice->str = str;
+        slice->len = strlen(str);
+    }
+}
+
+// 通用路径：复用json_tokener解析任意结构
+static gboolean decode_fallback(LyricsEventDecoder *decoder, const gchar *data, gsize len, LyricsEvent *event) {
+    json_tokener_reset(decoder->tokener);
+    json_object *root = json_tokener_parse_ex(decoder->tokener, data, (int)len);
+    if (!root || json_tokener_get_error(decoder->tokener) != json_tokener_success) {
+        if (root) {
+            json_object_put(root);
+        }
+        return FALSE;
+    }
+
+    // 与快速路径一致：对象之后只允许空白
+    gsize end = tokener_parse_end(decoder->tokener);
+    if (end > len || *skip_ws(data + end) != '\0' || !json_object_is_type(root, json_type_object)) {
+        json_object_put(root);
+        return FALSE;
+    }
+
+    // 数值字段超出范围与快速路径一样视为无效数据
+    reset_playback_fields(event);
+    json_object *obj;
+    gboolean valid = TRUE;
+    if (json_object_object_get_ex(root, "position", &obj) &&
+        (json_object_is_type(obj, json_type_int) || json_object_is_type(obj, json_type_double))) {
+        valid = position_from_number(json_object_get_double(obj), &event->position_ms);
+    }
+    if (json_object_object_get_ex(root, "paused", &obj) && json_object_is_type(obj, json_type_boolean)) {
+        event->paused = json_object_get_boolean(obj) ? 1 : 0;
+    }
+    if (json_object_object_get_ex(root, "rate", &obj) &&
+        (json_object_is_type(obj, json_type_int) || json_object_is_type(obj, json_type_double))) {
+        event->rate = json_object_get_double(obj);
+        valid = valid && isfinite(event->rate);
+    }
+    if (!valid) {
+        json_object_put(root);
+        return FALSE;
+    }
+
+    decoder->fallback_root = root;
+    slice_from_json(root, "type", &event->type_name);
+    slice_from_json(root, "text", &event->text);
+    slice_from_json(root, "songName", &event->song_name);
+    slice_from_json(root, "artist", &event->artist);
+    slice_from_json(root, "format", &event->format);
+    return TRUE;
+}
+
+gboolean lyrics_event_decode(LyricsEventDecoder *decoder, gchar *data, gsize len, LyricsEvent *event) {
+    gint64 start_time = g_get_monotonic_time();
+    gboolean ok;
+
+    // 释放上一次回退路径的结果
+    if (decoder->fallback_root) {
+        json_object_put(decoder->fallback_root);
+        decoder->fallback_root = NULL;
+    }
+
+    memset(event, 0, sizeof(LyricsEvent));
+    reset_playback_fields(event);
+
+    if (decode_fast(data, event)) {
+        decoder->stats.fast_path++;
+        ok = TRUE;
+    } else if (decode_fallback(decoder, data, len, event)) {
+        decoder->stats.fallback++;
+        ok = TRUE;
+    } else {
+        decoder->stats.errors++;
+        ok = FALSE;
+    }
+
+    if (ok) {
+        event->type = lyrics_event_type_from_name(event->type_name.str, event->type_name.len);
+    }
+
+    decoder->stats.decode_time_us += g_get_monotonic_time() - start_time;
+    return ok;
+}
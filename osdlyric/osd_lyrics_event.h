@@ -0,0 +1,80 @@
+#ifndef OSD_LYRICS_EVENT_H
+#define OSD_LYRICS_EVENT_H
+
+#include <glib.h>
+#include <json-c/json.h>
+#include "osd_lyrics_timeline.h"
+
+// SSE事件数据（JSON）解码
+// 对已知的 type/text/songName/artist/format（以及可选的 position/paused/rate）扁平结构走专用快速路径，
+// 字符串在输入缓冲区中原地反转义并以'\0'结尾，解码结果只借用不复制；
+// 其他结构回退到复用的 json_tokener
+
+// 借用的字符串片段，str 以'\0'结尾，生命周期与输入缓冲区相同
+typedef struct {
+    const gchar *str;
+    gsize len;
+} LyricsSlice;
+
+typedef enum {
+    LYRICS_EVENT_UNKNOWN = 0,
+    LYRICS_EVENT_LYRICS_UPDATE,
+    LYRICS_EVENT_CONNECTED,
+    LYRICS_EVENT_HEARTBEAT,
+    LYRICS_EVENT_LYRICS_DOCUMENT   // 整首歌词，text为完整的LRC/KRC文档
+} LyricsEventType;
+
+typedef struct {
+    LyricsEventType type;
+    LyricsSlice type_name;
+    LyricsSlice text;
+    LyricsSlice song_name;
+    LyricsSlice artist;
+    LyricsSlice format;
+
+    // 可选的播放状态字段
+    gint64 position_ms;      // 播放位置，未提供时为-1
+    gint paused;             // 1暂停，0播放，未提供时为-1
+    gdouble rate;            // 播放速率，未提供时为0
+
+    // 紧凑编码的整首歌词直接解码为时间轴（此时 text 为空），JSON路径始终为NULL
+    LyricsTimeline *timeline;
+} LyricsEvent;
+
+// 解码统计
+typedef struct {
+    guint64 fast_path;       // 快速路径解码次数
+    guint64 fallback;        // 回退到json-c的次数
+    guint64 errors;          // 无法解析的数据
+    guint64 decode_time_us;  // 解码总耗时
+} LyricsEventDecoderStats;
+
+typedef struct {
+    json_tokener *tokener;     // 跨事件复用的json-c解析器
+    json_object *fallback_root; // 回退路径的解析结果，保留到下一次解码
+    LyricsEventDecoderStats stats;
+} LyricsEventDecoder;
+
+/**
+ * 初始化解码器
+ * @param decoder 解码器
+ */
+void lyrics_event_decoder_init(LyricsEventDecoder *decoder);
+
+/**
+ * 释放解码器资源（包括上一次回退路径的解析结果）
+ * @param decoder 解码器
+ */
+void lyrics_event_decoder_clear(LyricsEventDecoder *decoder);
+
+/**
+ * 解码一个事件的JSON数据
+ * @param decoder 解码器
+ * @param data JSON数据，快速路径会原地修改，必须以'\0'结尾
+ * @param len 数据长度
+ * @param event 输出的事件，片段借用 data 或解码器内部对象
+ * @return 成功返回TRUE，数据无效返回FALSE
+ */
+gboolean lyrics_event_decode(LyricsEventDecoder *decoder, gchar *data, gsize len, LyricsEvent *event);
+
+#endif // OSD_LYRICS_EVENT_H
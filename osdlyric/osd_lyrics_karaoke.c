@@ -0,0 +1,128 @@
+#include <string.h>
+#include "osd_lyrics_karaoke.h"
+
+#define UNPLAYED_SPAN "<span foreground=\"#666666\">"
+#define SPAN_END "</span>"
+
+// 追加Pango标记转义后的文本
+static void append_escaped(GString *out, const gchar *text, gsize len) {
+    const gchar *run = text;
+    const gchar *end = text + len;
+
+    for (const gchar *p = text; p < end; p++) {
+        const gchar *entity;
+        switch (*p) {
+        case '<': entity = "&lt;"; break;
+        case '>': entity = "&gt;"; break;
+        case '&': entity = "&amp;"; break;
+        case '"': entity = "&quot;"; break;
+        case '\'': entity = "&#39;"; break;
+        default: continue;
+        }
+        g_string_append_len(out, run, p - run);
+        g_string_append(out, entity);
+        run = p + 1;
+    }
+    g_string_append_len(out, run, end - run);
+}
+
+// 记录缓冲区扩容，用于确认稳定后没有分配
+static void track_growth(KaraokeLine *line, GString *buffer, gsize allocated_len) {
+    if (buffer->allocated_len != allocated_len) {
+        line->stats.growths++;
+    }
+}
+
+void karaoke_line_init(KaraokeLine *line) {
+    memset(line, 0, sizeof(KaraokeLine));
+    line->escaped = g_string_sized_new(256);
+    line->markup = g_string_sized_new(512);
+}
+
+void karaoke_line_clear(KaraokeLine *line) {
+    g_free(line->syllables);
+    g_string_free(line->escaped, TRUE);
+    g_string_free(line->markup, TRUE);
+    line->syllables = NULL;
+    line->escaped = NULL;
+    line->markup = NULL;
+}
+
+void karaoke_line_set(KaraokeLine *line, const gchar *text, gsize text_len,
+                      const LyricsSyllable *syllables, guint n_syllables) {
+    gsize escaped_allocated = line->escaped->allocated_len;
+
+    if (n_syllables > line->syllables_cap) {
+        line->syllables_cap = MAX(n_syllables, line->syllables_cap * 2);
+        line->syllables = g_renew(KaraokeSyllable, line->syllables, line->syllables_cap);
+        line->stats.growths++;
+    }
+    line->n_syllables = n_syllables;
+
+    g_string_truncate(line->escaped, 0);
+    gsize first = n_syllables > 0 ? MIN(syllables[0].byte_offset, text_len) : text_len;
+    append_escaped(line->escaped, text, first);
+
+    for (guint i = 0; i < n_syllables; i++) {
+        gsize start = MIN(syllables[i].byte_offset, text_len);
+        gsize end = i + 1 < n_syllables ? MIN(syllables[i + 1].byte_offset, text_len) : text_len;
+        KaraokeSyllable *syllable = &line->syllables[i];
+
+        syllable->start_ms = syllables[i].start_ms;
+        syllable->duration_ms = syllables[i].duration_ms;
+        syllable->markup_offset = line->escaped->len;
+        append_escaped(line->escaped, text + start, end > start ? end - start : 0);
+        syllable->markup_length = line->escaped->len - syllable->markup_offset;
+    }
+    track_growth(line, line->escaped, escaped_allocated);
+
+    line->rendered = FALSE;
+    line->stats.lines++;
+}
+
+guint karaoke_line_played_count(const KaraokeLine *line, gint64 progress_ms) {
+    guint low = 0;
+    guint high = line->n_syllables;
+
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+        if (line->syllables[mid].start_ms <= progress_ms) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+const gchar* karaoke_line_render(KaraokeLine *line, gint64 progress_ms, const gchar *played_color) {
+    guint played = karaoke_line_played_count(line, progress_ms);
+    guint split = played < line->n_syllables ? line->syllables[played].markup_offset : line->escaped->len;
+
+    line->stats.renders++;
+    if (line->rendered && split == line->split && strcmp(played_color, line->played_color) == 0) {
+        line->stats.unchanged++;
+        return NULL;
+    }
+
+    gsize markup_allocated = line->markup->allocated_len;
+    GString *markup = g_string_truncate(line->markup, 0);
+    if (split > 0) {
+        g_string_append(markup, "<span foreground=\"");
+        g_string_append(markup, played_color);
+        g_string_append(markup, "\">");
+        g_string_append_len(markup, line->escaped->str, split);
+        g_string_append(markup, SPAN_END);
+    }
+    if (split < line->escaped->len) {
+        g_string_append(markup, UNPLAYED_SPAN);
+        g_string_append_len(markup, line->escaped->str + split, line->escaped->len - split);
+        g_string_append(markup, SPAN_END);
+    }
+    track_growth(line, markup, markup_allocated);
+
+    line->split = split;
+    g_strlcpy(line->played_color, played_color, sizeof(line->played_color));
+    line->rendered = TRUE;
+    return markup->str;
+}
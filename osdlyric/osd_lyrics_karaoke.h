@@ -0,0 +1,74 @@
+#ifndef OSD_LYRICS_KARAOKE_H
+#define OSD_LYRICS_KARAOKE_H
+
+#include <glib.h>
+#include "osd_lyrics_timeline.h"
+
+// KRC逐字高亮
+// 每行只在开始时解析一次：得到按时间排序的音节数组，整行文本预先做好Pango标记转义。
+// 每次刷新只需二分查找已唱/未唱的分界，把两段预先转义好的文本拼接到复用的缓冲区中；
+// 分界和颜色都没变时直接返回，不做任何工作
+
+// 一个音节及其后没有时间标签的文本
+typedef struct {
+    gint64 start_ms;         // 相对于行开始的时间
+    gint64 duration_ms;
+    guint markup_offset;     // 在转义文本中的偏移
+    guint markup_length;
+} KaraokeSyllable;
+
+// 刷新统计
+typedef struct {
+    guint64 lines;           // 开始显示的行数
+    guint64 renders;         // 刷新次数
+    guint64 unchanged;       // 分界未变化而跳过的刷新
+    guint64 growths;         // 缓冲区扩容次数（稳定后应不再增长）
+} KaraokeStats;
+
+typedef struct {
+    KaraokeSyllable *syllables;
+    guint n_syllables;
+    guint syllables_cap;
+    GString *escaped;        // 整行转义后的文本，第一个音节之前的文本始终视为已唱
+    GString *markup;         // 复用的输出缓冲区
+    guint split;             // 上次输出时已唱部分在转义文本中的长度
+    gchar played_color[8];   // 上次输出时已唱部分的颜色 #rrggbb
+    gboolean rendered;
+
+    KaraokeStats stats;
+} KaraokeLine;
+
+/**
+ * 初始化（缓冲区在各行之间复用）
+ */
+void karaoke_line_init(KaraokeLine *line);
+
+/**
+ * 释放缓冲区
+ */
+void karaoke_line_clear(KaraokeLine *line);
+
+/**
+ * 设置当前行
+ * @param text 行的纯文本
+ * @param text_len 文本长度
+ * @param syllables 逐字时间（byte_offset 相对于 text，按顺序且不重叠）
+ * @param n_syllables 音节数
+ */
+void karaoke_line_set(KaraokeLine *line, const gchar *text, gsize text_len,
+                      const LyricsSyllable *syllables, guint n_syllables);
+
+/**
+ * 已经开始唱的音节数（最后一个 start_ms <= progress_ms 的音节之后）
+ */
+guint karaoke_line_played_count(const KaraokeLine *line, gint64 progress_ms);
+
+/**
+ * 生成当前进度的Pango标记
+ * @param progress_ms 行内进度
+ * @param played_color 已唱部分的颜色，#rrggbb
+ * @return 标记文本（属于 line，下次调用前有效）；与上次输出相同时返回NULL
+ */
+const gchar* karaoke_line_render(KaraokeLine *line, gint64 progress_ms, const gchar *played_color);
+
+#endif // OSD_LYRICS_KARAOKE_H
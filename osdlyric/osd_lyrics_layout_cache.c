@@ -0,0 +1,98 @@
+#include <string.h>
+#include "osd_lyrics_layout_cache.h"
+
+struct _LyricsLayoutCacheEntry {
+    gchar *text;             // 哈希表的键
+    PangoLayout *layout;
+    PangoFontDescription *font;
+    gint scale;
+    GList link;              // 在LRU队列中的节点
+};
+
+static void entry_free(gpointer data) {
+    LyricsLayoutCacheEntry *entry = (LyricsLayoutCacheEntry *)data;
+
+    g_free(entry->text);
+    g_object_unref(entry->layout);
+    pango_font_description_free(entry->font);
+    g_free(entry);
+}
+
+// 从LRU队列和哈希表中移除并释放
+static void entry_remove(LyricsLayoutCache *cache, LyricsLayoutCacheEntry *entry) {
+    g_queue_unlink(&cache->lru, &entry->link);
+    g_hash_table_remove(cache->entries, entry->text);
+}
+
+void lyrics_layout_cache_init(LyricsLayoutCache *cache, guint capacity) {
+    cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, entry_free);
+    g_queue_init(&cache->lru);
+    cache->capacity = MAX(capacity, 1);
+    cache->key = g_string_sized_new(256);
+    memset(&cache->stats, 0, sizeof(cache->stats));
+}
+
+void lyrics_layout_cache_clear(LyricsLayoutCache *cache) {
+    if (!cache->entries) {
+        return;
+    }
+    g_queue_init(&cache->lru);
+    g_hash_table_destroy(cache->entries);
+    g_string_free(cache->key, TRUE);
+    cache->entries = NULL;
+    cache->key = NULL;
+}
+
+void lyrics_layout_cache_invalidate(LyricsLayoutCache *cache) {
+    g_queue_init(&cache->lru);
+    g_hash_table_remove_all(cache->entries);
+    cache->stats.invalidations++;
+}
+
+PangoLayout* lyrics_layout_cache_lookup(LyricsLayoutCache *cache, const gchar *text, gsize text_len,
+                                        const PangoFontDescription *font, gint scale) {
+    cache->stats.lookups++;
+
+    g_string_truncate(cache->key, 0);
+    g_string_append_len(cache->key, text, text_len);
+    LyricsLayoutCacheEntry *entry = g_hash_table_lookup(cache->entries, cache->key->str);
+    if (!entry) {
+        return NULL;
+    }
+
+    if (entry->scale != scale || !pango_font_description_equal(entry->font, font)) {
+        cache->stats.stale++;
+        entry_remove(cache, entry);
+        return NULL;
+    }
+
+    g_queue_unlink(&cache->lru, &entry->link);
+    g_queue_push_head_link(&cache->lru, &entry->link);
+    cache->stats.hits++;
+    return entry->layout;
+}
+
+void lyrics_layout_cache_insert(LyricsLayoutCache *cache, const gchar *text, gsize text_len,
+                                const PangoFontDescription *font, gint scale, PangoLayout *layout) {
+    LyricsLayoutCacheEntry *entry = g_new0(LyricsLayoutCacheEntry, 1);
+    entry->text = g_strndup(text, text_len);
+    entry->layout = g_object_ref(layout);
+    entry->font = pango_font_description_copy(font);
+    entry->scale = scale;
+    entry->link.data = entry;
+
+    // 替换同一文本的旧条目
+    LyricsLayoutCacheEntry *old = g_hash_table_lookup(cache->entries, entry->text);
+    if (old) {
+        entry_remove(cache, old);
+    }
+
+    g_hash_table_insert(cache->entries, entry->text, entry);
+    g_queue_push_head_link(&cache->lru, &entry->link);
+
+    while (cache->lru.length > cache->capacity) {
+        LyricsLayoutCacheEntry *oldest = (LyricsLayoutCacheEntry *)g_queue_peek_tail(&cache->lru);
+        entry_remove(cache, oldest);
+        cache->stats.evictions++;
+    }
+}
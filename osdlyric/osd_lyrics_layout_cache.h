@@ -0,0 +1,62 @@
+#ifndef OSD_LYRICS_LAYOUT_CACHE_H
+#define OSD_LYRICS_LAYOUT_CACHE_H
+
+#include <glib.h>
+#include <pango/pango.h>
+
+// 已排版PangoLayout的LRU缓存
+// 副歌会反复出现，中日韩文本加字体回退的排版代价很高。按行文本缓存排版好的布局，
+// 条目记录创建时的字体和缩放比例，不一致时视为未命中；字体变化时整体失效
+
+typedef struct _LyricsLayoutCacheEntry LyricsLayoutCacheEntry;
+
+// 缓存统计
+typedef struct {
+    guint64 lookups;         // 查找次数
+    guint64 hits;            // 命中次数
+    guint64 stale;           // 文本相同但字体或缩放比例不同
+    guint64 evictions;       // 超出容量淘汰的条目
+    guint64 invalidations;   // 整体失效次数
+} LyricsLayoutCacheStats;
+
+typedef struct {
+    GHashTable *entries;     // 行文本 -> 条目
+    GQueue lru;              // 表头为最近使用
+    guint capacity;
+    GString *key;            // 复用的查找键，行文本不一定以NUL结尾
+
+    LyricsLayoutCacheStats stats;
+} LyricsLayoutCache;
+
+/**
+ * 初始化缓存
+ * @param capacity 最多保留的布局数
+ */
+void lyrics_layout_cache_init(LyricsLayoutCache *cache, guint capacity);
+
+/**
+ * 释放所有布局
+ */
+void lyrics_layout_cache_clear(LyricsLayoutCache *cache);
+
+/**
+ * 丢弃所有布局（字体或样式变化时调用），保留统计信息
+ */
+void lyrics_layout_cache_invalidate(LyricsLayoutCache *cache);
+
+/**
+ * 查找行文本对应的布局，命中时移到表头
+ * @param font 当前字体
+ * @param scale 当前缩放比例
+ * @return 布局（属于缓存，调用方需要保留时自行增加引用），未命中返回NULL
+ */
+PangoLayout* lyrics_layout_cache_lookup(LyricsLayoutCache *cache, const gchar *text, gsize text_len,
+                                        const PangoFontDescription *font, gint scale);
+
+/**
+ * 加入新排版的布局（增加引用），超出容量时淘汰最久未使用的条目
+ */
+void lyrics_layout_cache_insert(LyricsLayoutCache *cache, const gchar *text, gsize text_len,
+                                const PangoFontDescription *font, gint scale, PangoLayout *layout);
+
+#endif // OSD_LYRICS_LAYOUT_CACHE_H
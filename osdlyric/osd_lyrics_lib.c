@@ -5,14 +5,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <time.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 #include <curl/curl.h>
 #include <json-c/json.h>
-
-typedef struct {
+#include "osd_lyrics.h"
+#include "osd_lyrics_client.h"
+#include "osd_lyrics_queue.h"
+#include "osd_lyrics_timeline.h"
+#include "osd_lyrics_timeline_cache.h"
+#include "osd_lyrics_clock.h"
+#include "osd_lyrics_karaoke.h"
+#include "osd_lyrics_wipe.h"
+
+// 一个歌词窗口；同一进程中的所有窗口共享SSE连接、播放时钟和解析好的时间轴，
+// 字体、颜色、透明度和位置各自独立
+struct _OSDLyrics {
     GtkWidget *window;
     GtkWidget *label;
+    KaraokeWipe *wipe;   // 逐字擦除控件，使用Pango标记高亮时为NULL
     GtkWidget *close_button;
     GtkWidget *settings_box;
     GtkWidget *opacity_increase_btn;
@@ -35,6 +50,23 @@ typedef struct {
     gint resize_start_height;
     gint window_width;
     gint window_height;
+
+    // 拖动和调整大小时指针事件只记录目标，由帧时钟每帧最多移动或调整一次
+    gboolean move_pending;
+    gint pending_x;
+    gint pending_y;
+    gboolean resize_pending;     // 目标大小为 window_width x window_height
+    guint pointer_tick_id;
+    guint64 pointer_motions;     // 拖动或调整大小时的指针事件数
+    guint64 pointer_frames;      // 实际移动或调整大小的次数
+
+    // 歌词标签的绘制耗时（逐字标记方式和擦除控件出现之前的文本）
+    gint64 label_draw_start_us;
+    guint64 label_draws;
+    gint64 label_draw_us;
+    gint64 label_draw_max_us;
+    GdkCursor *resize_cursors[3]; // 右下角、右边缘、底边缘的光标，首次使用时创建
+    GdkCursor *current_cursor;   // 当前设置的光标，NULL表示默认
     
     gboolean settings_visible;
     gboolean is_locked;
@@ -43,26 +75,228 @@ typedef struct {
     guint unlock_timer_id;  // 解锁显示定时器ID
     gboolean showing_unlock_icon;  // 是否正在显示解锁图标
 
+    guint check_height_id;  // 显示后检查窗口高度的延迟定时器
+    gint karaoke_played;    // 标签方式下已应用到标签的已唱音节数，-1表示需要重新渲染
+
     gchar *current_lyrics;
     gdouble opacity;
     gint font_size;
     GdkRGBA text_color;  // 文字颜色
-    gchar *sse_url;      // SSE连接URL
+    GtkCssProvider *css_provider; // 静态样式表，只加载一次
+    gchar **sse_urls;    // SSE连接URL列表，按优先级排列
+    SSEClient *sse_client; // SSE连接客户端
+    LyricsQueue update_queue; // SSE歌词到界面的合并队列
+    gboolean persistent;  // 设置保存在配置文件中（只有主窗口）
     gboolean initialized;
-} OSDLyrics;
+};
 
+// 主窗口，持有SSE连接、合并队列、样式表和配置文件（以上字段只在主窗口中使用）
 static OSDLyrics *osd = NULL;
 
-// KRC渐进式播放状态
+// 所有歌词窗口，主窗口在第一个；歌词显示逐个应用到每个窗口，只由主线程访问
+static GPtrArray *osd_windows = NULL;
+
+// 重连退避策略，可在初始化前通过 osd_lyrics_set_reconnect_policy 修改
+static SSEBackoffPolicy reconnect_policy = {500, 30000, 2.0, 0.2};
+
+// 网络到界面的环形缓冲区大小，满时最新的行进入溢出信箱
+#define LYRICS_QUEUE_CAPACITY 16
+
+// SSE传输方式，可在初始化前通过 osd_lyrics_set_sse_main_loop 修改
+static SSETransport sse_transport = SSE_TRANSPORT_THREAD;
+
+// 是否协商紧凑二进制编码，可在初始化前通过 osd_lyrics_set_compact_encoding 修改
+static gboolean compact_encoding = FALSE;
+
+// 逐字高亮方式，可在初始化前通过 osd_lyrics_set_wipe_render 修改
+// TRUE：自绘控件按帧平滑擦除；FALSE：按音节改写标签的Pango标记
+static gboolean wipe_render = TRUE;
+
+// 歌词文字样式，可在初始化前通过 osd_lyrics_set_outline_text 修改
+// FALSE：浅色阴影（标签由CSS text-shadow模糊绘制）；TRUE：深色描边，标签阴影不模糊
+static gboolean outline_text = FALSE;
+
+// 从收到歌词到开始显示的分发延迟统计
 static struct {
-    gchar *current_krc_line;
-    gint64 line_start_time;
-    guint timer_id;
+    guint64 count;
+    gint64 total_us;
+    gint64 max_us;
+} dispatch_stats = {0, 0, 0};
+
+// KRC渐进式播放状态，只由主线程访问
+static struct {
+    KaraokeLine line;         // 当前行（音节数组和预先转义的文本），缓冲区跨行复用
+    GArray *wipe_syllables;   // 擦除方式下当前行的音节（文本为 osd->current_lyrics），新窗口据此接手
+    gint64 line_start_time;   // 收到该行的时间（单调时钟，毫秒），播放时钟未校准时使用
+    gint64 line_position_ms;  // 该行在歌曲中的开始时间，未知时为-1
+    guint timer_id;           // 下一个音节开始时的唤醒，整行唱完或暂停时为0
+    gint64 scheduled_us;      // 计划唤醒时间（单调时钟，微秒）
     gboolean is_active;
-} krc_progress_state = {NULL, 0, 0, FALSE};
+    guint generation;   // 每次开始或清理时递增，过期的定时器回调据此直接退出
+    guint64 wakeups;          // 定时器唤醒次数
+    gint64 total_late_us;     // 唤醒相对计划时间的累计延迟
+} krc_progress_state;
+
+// 播放时钟，只由主线程访问
+static PlaybackClock playback_clock;
+
+// 整首歌词的本地播放状态，只由主线程访问
+// 每行歌词事件只作为同步参考（校准播放时钟），换行由本地定时器按播放时钟驱动
+static struct {
+    LyricsTimeline *timeline;
+    gchar *anchor_song;          // 同步参考所属的歌曲
+    gboolean explicit_position;  // 服务器提供了position字段，不再用行开始时间校准
+    gint64 last_position_time;   // 最近一次应用的position观测时间
+    gint current_line;           // 正在显示的行，-1表示没有
+    guint timer_id;              // 下一次换行的定时器
+    gint64 scheduled_us;         // 下一次换行的计划时间（单调时钟，微秒）
+    guint64 local_switches;      // 本地定时器驱动的换行次数
+    guint64 sync_hints;          // 收到的同步参考次数
+    gint64 total_late_us;        // 换行相对计划时间的累计延迟
+} timeline_state = {NULL, NULL, FALSE, 0, -1, 0, 0, 0, 0, 0};
+
+// 解析好的整首歌词，按歌曲身份缓存在内存和配置目录中，只由主线程访问
+static LyricsTimelineCache timeline_cache;
+
+// 空闲原因：暂停、窗口隐藏、锁屏，任一成立时停止换行、逐字和擦除的全部定时器，
+// 只剩SSE套接字能唤醒进程；恢复时按播放时钟重新同步
+#define POWER_IDLE_PAUSED 0x01
+#define POWER_IDLE_HIDDEN 0x02
+#define POWER_IDLE_LOCKED 0x04
+
+// 空闲时主线程的定时器松弛，让内核把剩余的唤醒（如连接的超时检查）合并到一起
+#define POWER_IDLE_TIMER_SLACK_NS (50 * 1000 * 1000)
+
+// 发出 ActiveChanged(b) 的屏幕保护程序服务：总线名称（同时是接口名）和对象路径
+// 只接受这些服务发出的信号，会话总线上其他程序的同名信号不会让歌词进入空闲
+static const struct {
+    const gchar *name;
+    const gchar *path;
+} screensaver_services[] = {
+    {"org.freedesktop.ScreenSaver", "/org/freedesktop/ScreenSaver"},  // KDE等
+    {"org.gnome.ScreenSaver", "/org/gnome/ScreenSaver"}
+};
+
+// 省电状态和唤醒统计，只由主线程访问
+// 唤醒次数按进程的自愿上下文切换计算（每次阻塞等待结束算一次）
+static struct {
+    guint reasons;              // POWER_IDLE_* 的组合，0表示正常显示
+    gint64 start_us;            // 初始化时间（单调时钟，微秒）
+    glong start_wakeups;        // 初始化时的唤醒次数
+    gint64 idle_since_us;       // 本次进入空闲的时间
+    glong idle_since_wakeups;
+    gint64 idle_us;             // 已结束的空闲时段累计时长
+    glong idle_wakeups;         // 已结束的空闲时段累计唤醒次数
+    glong normal_slack_ns;      // 进入空闲前的定时器松弛，-1表示不支持
+    GDBusConnection *bus;       // 会话总线，用于监听锁屏
+    guint screensaver_ids[G_N_ELEMENTS(screensaver_services)]; // 每个服务的 ActiveChanged 信号订阅
+} power_state = {0, 0, 0, 0, 0, 0, 0, -1, NULL, {0}};
+
+// 静态样式表，背景透明度和文字颜色不在这里
+static const gchar osd_stylesheet[] =
+    "window {"
+    "  background-color: transparent;"  /* 背景按透明度在 on_window_draw 中绘制 */
+    "  border-radius: 1px;"
+    "  border: none;"  /* 移除边框 */
+    "}"
+    "label {"  /* 文字颜色由 update_text_color 覆盖 */
+    "  font-weight: bold;"
+    "  text-shadow: 0px 1px 2px rgba(255, 255, 255, 0.8);"
+    "}"
+    "label.outline {"  /* 描边样式：模糊半径为0时GTK不为阴影创建模糊表面 */
+    "  text-shadow: 0px 1px 0px rgba(0, 0, 0, 0.75);"
+    "}"
+    "scale {"
+    "  color: rgb(51, 51, 51);"
+    "}"
+    "scale trough {"
+    "  background-color: rgba(200, 200, 200, 0.8);"
+    "}"
+    "scale slider {"
+    "  background-color: rgb(100, 100, 100);"
+    "}"
+    "checkbutton {"
+    "  color: rgb(51, 51, 51);"
+    "}"
+    "checkbutton check {"
+    "  background-color: rgb(240, 240, 240);"
+    "  border: 1px solid rgb(200, 200, 200);"
+    "}"
+    "button {"
+    "  background-color: rgba(240, 240, 240, 0.9);"
+    "  color: rgb(51, 51, 51);"
+    "  border: 1px solid rgba(200, 200, 200, 0.8);"
+    "  border-radius: 50%;"
+    "  padding: 2px;"
+    "  font-weight: bold;"
+    "}"
+    "button:hover {"
+    "  background-color: rgba(220, 220, 220, 0.95);"
+    "  color: rgb(255, 85, 85);"
+    "}"
+    "button#close-button {"
+    "  background: none !important;"
+    "  background-color: transparent !important;"
+    "  background-image: none !important;"
+    "  border: none !important;"
+    "  border-radius: 0 !important;"
+    "  box-shadow: none !important;"
+    "  color: rgba(100, 100, 100, 0.8);"
+    "  font-weight: bold;"
+    "  font-size: 16px;"
+    "  padding: 2px;"
+    "}"
+    "button#close-button:hover {"
+    "  color: rgb(255, 85, 85);"
+    "  background: none !important;"
+    "  background-color: transparent !important;"
+    "  background-image: none !important;"
+    "  border-radius: 0 !important;"
+    "  box-shadow: none !important;"
+    "}"
+    "button#color-button {"  /* 色块在 on_color_button_draw 中绘制 */
+    "  background: none;"
+    "  border: 1px solid rgba(150, 150, 150, 0.6);"
+    "  border-radius: 2px;"
+    "  min-width: 16px;"
+    "  min-height: 16px;"
+    "  max-width: 16px;"
+    "  max-height: 16px;"
+    "  padding: 0px;"
+    "  margin: 2px;"
+    "  box-shadow: none;"
+    "}"
+    "button#color-button:hover {"
+    "  border: 1px solid rgba(100, 100, 100, 0.8);"
+    "}"
+    "button#mini-btn {"
+    "  background: none;"
+    "  border: none;"
+    "  color: rgba(100, 100, 100, 0.8);"
+    "  font-size: 12px;"
+    "  min-width: 20px;"
+    "  min-height: 20px;"
+    "  max-width: 20px;"
+    "  max-height: 20px;"
+    "  padding: 0px;"
+    "  margin: 1px;"
+    "  box-shadow: none;"
+    "}"
+    "button#mini-btn:hover {"
+    "  color: rgba(50, 50, 50, 1.0);"
+    "}"
+    "tooltip {"
+    "  background-color: rgba(255, 255, 255, 0.95);"
+    "  color: rgba(50, 50, 50, 1.0);"
+    "  border: 1px solid rgba(200, 200, 200, 0.8);"
+    "  border-radius: 4px;"
+    "  padding: 4px 8px;"
+    "  font-size: 11px;"
+    "  box-shadow: 0 2px 4px rgba(0, 0, 0, 0.1);"
+    "}";
 
 // 函数声明
-static void update_opacity(OSDLyrics *osd);  // 移到前面，因为setup_css需要调用它
+static void update_opacity(OSDLyrics *osd);
 static void on_window_realize(GtkWidget *widget);
 static void setup_window_properties(OSDLyrics *osd);
 static void create_ui(OSDLyrics *osd);
@@ -87,20 +321,52 @@ static void toggle_settings(OSDLyrics *osd);
 static void update_font_size(OSDLyrics *osd);
 static void update_text_color(OSDLyrics *osd);
 static void update_color_button_appearance(OSDLyrics *osd);
+static gboolean on_window_draw(GtkWidget *widget, cairo_t *cr, gpointer data);
+static gboolean on_color_button_draw(GtkWidget *widget, cairo_t *cr, gpointer data);
+static gboolean on_label_draw_begin(GtkWidget *widget, cairo_t *cr, gpointer data);
+static gboolean on_label_draw_end(GtkWidget *widget, cairo_t *cr, gpointer data);
 static void update_mouse_through(OSDLyrics *osd);
 static void start_sse_connection(OSDLyrics *osd);
-static size_t sse_write_callback(void *contents, size_t size, size_t nmemb, void *userp);
-static gboolean update_krc_lyrics_from_sse(gpointer data);
-static void osd_lyrics_start_krc_progressive_display(const char *krc_line);
+static void sse_apply_lyrics(const gchar *song_name, const gchar *text, gsize text_len,
+                             const gchar *format, gint64 received_time, gboolean restored,
+                             gpointer user_data);
+static void display_sse_lyrics(const LyricsUpdate *update, gpointer user_data);
+static void sse_apply_document(const gchar *song_name, const gchar *artist,
+                               const gchar *document, gsize document_len,
+                               const gchar *format, gpointer user_data);
+static void sse_apply_timeline(LyricsTimeline *timeline, gpointer user_data);
+static gboolean load_lyrics_document(gpointer data);
+static gboolean timeline_handle_hint(const LyricsUpdate *update, gint64 line_start_ms);
+static gint64 timeline_position_ms(void);
+static void apply_playback_state(const LyricsPlayback *playback, gpointer user_data);
+static void playback_resync(void);
+static void sse_apply_playback(gint64 position_ms, gint paused, gdouble rate, gint64 received_time,
+                               gpointer user_data);
+static void timeline_reset(void);
+static void print_dispatch_stats(void);
+static void power_init(void);
+static void power_cleanup(void);
+static void power_set_idle(guint reason, gboolean idle);
+static void osd_lyrics_start_krc_progressive_display(const char *krc_line, gint64 line_start_time,
+                                                     gint64 line_position_ms);
+static void start_karaoke_line(const gchar *text, gsize text_len, const LyricsSyllable *syllables,
+                               guint n_syllables, gint64 line_start_time, gint64 line_position_ms);
 static gboolean osd_lyrics_update_krc_progress(gpointer data);
+static void krc_progress_sync(void);
+static gint64 krc_wipe_progress(gint64 now, gpointer user_data);
+static void set_wipe_visible(gboolean visible);
+static void window_set_wipe_visible(OSDLyrics *instance, gboolean visible);
+static void window_show_text(OSDLyrics *instance, const gchar *text);
+static void power_update_hidden(void);
+static void timeline_show_line(gint index);
 static void osd_lyrics_process_krc_line(const char *krc_line);
-static void osd_lyrics_process_lrc_line(const char *lrc_line);
+static void osd_lyrics_process_lrc_line(const char *lrc_line, gint64 received_time, gint64 line_start_ms);
 static void clear_krc_state(void);
-static gpointer sse_connection_thread(gpointer data);
 static void save_config(OSDLyrics *osd);
 static void load_config(OSDLyrics *osd);
 static gchar* get_config_dir(void);
 static gchar* get_config_file_path(void);
+static gchar* get_timeline_cache_path(void);
 
 // 窗口实现时调用，启用覆盖重定向以移除窗口管理器装饰（如阴影）
 static void on_window_realize(GtkWidget *widget) {
@@ -200,9 +466,22 @@ static void create_ui(OSDLyrics *osd) {
     // 设置标签为单行显示，超出部分省略
     gtk_label_set_ellipsize(GTK_LABEL(osd->label), PANGO_ELLIPSIZE_START);  // 开头省略
     gtk_label_set_single_line_mode(GTK_LABEL(osd->label), TRUE);  // 单行模式
+    if (outline_text) {
+        gtk_style_context_add_class(gtk_widget_get_style_context(osd->label), "outline");
+    }
+    g_signal_connect(osd->label, "draw", G_CALLBACK(on_label_draw_begin), osd);
+    g_signal_connect_after(osd->label, "draw", G_CALLBACK(on_label_draw_end), osd);
     
     // 将歌词标签添加到歌词容器
     gtk_box_pack_start(GTK_BOX(lyrics_container), osd->label, TRUE, TRUE, 0);
+
+    // 逐字擦除控件与标签占同一位置，只在显示KRC行时替换标签
+    if (wipe_render) {
+        osd->wipe = karaoke_wipe_new(krc_wipe_progress, NULL);
+        karaoke_wipe_set_style(osd->wipe, outline_text ? KARAOKE_WIPE_STYLE_OUTLINE : KARAOKE_WIPE_STYLE_SHADOW);
+        gtk_widget_set_no_show_all(osd->wipe->widget, TRUE);
+        gtk_box_pack_start(GTK_BOX(lyrics_container), osd->wipe->widget, TRUE, TRUE, 0);
+    }
     
     // 将歌词容器作为主要内容添加到叠加容器
     gtk_container_add(GTK_CONTAINER(overlay), lyrics_container);
@@ -267,29 +546,8 @@ static void create_ui(OSDLyrics *osd) {
     gtk_widget_set_halign(osd->color_button, GTK_ALIGN_CENTER);
     gtk_widget_set_valign(osd->color_button, GTK_ALIGN_CENTER);
 
-    // 设置按钮的背景颜色为红色
-    GtkCssProvider *color_provider = gtk_css_provider_new();
-    gchar *color_css = g_strdup_printf(
-        "button#color-button {"
-        "  background-color: rgb(255, 0, 0);"
-        "  border: 1px solid rgba(150, 150, 150, 0.6);"
-        "  border-radius: 2px;"
-        "  min-width: 16px;"
-        "  min-height: 16px;"
-        "  max-width: 16px;"
-        "  max-height: 16px;"
-        "  padding: 0px;"
-        "  margin: 2px;"
-        "  box-shadow: none;"
-        "}");
-    gtk_css_provider_load_from_data(color_provider, color_css, -1, NULL);
-    gtk_style_context_add_provider(
-        gtk_widget_get_style_context(osd->color_button),
-        GTK_STYLE_PROVIDER(color_provider),
-        GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-    g_object_unref(color_provider);
-    g_free(color_css);
-
+    // 色块按文字颜色直接绘制，样式表中只有边框和尺寸
+    g_signal_connect_after(osd->color_button, "draw", G_CALLBACK(on_color_button_draw), osd);
     g_signal_connect(osd->color_button, "clicked", G_CALLBACK(on_color_button_clicked), osd);
 
     // 关闭按钮 - 使用Unicode符号，无背景
@@ -341,8 +599,81 @@ static void create_ui(OSDLyrics *osd) {
 }
 
 static void setup_css(OSDLyrics *osd) {
-    // 初始CSS设置，透明度将通过update_opacity动态更新
-    update_opacity(osd);
+    // 静态样式表只解析一次，所有窗口共用；背景透明度和文字颜色在变化时直接重绘或覆盖，不再重新加载CSS
+    osd->css_provider = gtk_css_provider_new();
+    gtk_css_provider_load_from_data(osd->css_provider, osd_stylesheet, -1, NULL);
+    gtk_style_context_add_provider_for_screen(gdk_screen_get_default(),
+                                            GTK_STYLE_PROVIDER(osd->css_provider),
+                                            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+}
+
+// 歌词标签绘制前后，统计每帧绘制耗时（阴影样式包括CSS阴影的模糊）
+static gboolean on_label_draw_begin(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    OSDLyrics *osd = (OSDLyrics *)data;
+    (void)widget; (void)cr;
+    osd->label_draw_start_us = g_get_monotonic_time();
+    return FALSE;
+}
+
+static gboolean on_label_draw_end(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    OSDLyrics *osd = (OSDLyrics *)data;
+    gint64 elapsed_us = g_get_monotonic_time() - osd->label_draw_start_us;
+    (void)widget; (void)cr;
+    osd->label_draws++;
+    osd->label_draw_us += elapsed_us;
+    osd->label_draw_max_us = MAX(osd->label_draw_max_us, elapsed_us);
+    return FALSE;
+}
+
+// 调整大小光标在 resize_cursors 中的下标
+#define RESIZE_CURSOR_CORNER 0
+#define RESIZE_CURSOR_RIGHT 1
+#define RESIZE_CURSOR_BOTTOM 2
+
+// 调整大小光标只创建一次
+static GdkCursor* resize_cursor(OSDLyrics *osd, GdkWindow *gdk_window, gint index) {
+    static const GdkCursorType types[] = {GDK_BOTTOM_RIGHT_CORNER, GDK_SB_H_DOUBLE_ARROW, GDK_SB_V_DOUBLE_ARROW};
+
+    if (!osd->resize_cursors[index]) {
+        osd->resize_cursors[index] = gdk_cursor_new_for_display(gdk_window_get_display(gdk_window), types[index]);
+    }
+    return osd->resize_cursors[index];
+}
+
+// 应用等待中的移动和调整大小，返回是否有变化
+static gboolean apply_pointer_frame(OSDLyrics *osd) {
+    gboolean applied = osd->move_pending || osd->resize_pending;
+
+    if (osd->move_pending) {
+        gtk_window_move(GTK_WINDOW(osd->window), osd->pending_x, osd->pending_y);
+        osd->move_pending = FALSE;
+    }
+    if (osd->resize_pending) {
+        gtk_window_resize(GTK_WINDOW(osd->window), osd->window_width, osd->window_height);
+        osd->resize_pending = FALSE;
+    }
+    if (applied) {
+        osd->pointer_frames++;
+    }
+    return applied;
+}
+
+// 帧时钟回调：每帧最多移动或调整一次，没有新的指针事件时停止
+static gboolean on_pointer_frame(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data) {
+    (void)widget; (void)frame_clock;
+    OSDLyrics *osd = (OSDLyrics *)data;
+
+    if (apply_pointer_frame(osd)) {
+        return G_SOURCE_CONTINUE;
+    }
+    osd->pointer_tick_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void schedule_pointer_frame(OSDLyrics *osd) {
+    if (osd->pointer_tick_id == 0) {
+        osd->pointer_tick_id = gtk_widget_add_tick_callback(osd->window, on_pointer_frame, osd, NULL);
+    }
 }
 
 static gboolean on_button_press(GtkWidget *widget, GdkEventButton *event, gpointer data) {
@@ -421,6 +752,8 @@ static gboolean on_button_release(GtkWidget *widget, GdkEventButton *event, gpoi
     OSDLyrics *osd = (OSDLyrics *)data;
 
     if (event->button == 1) {
+        // 松开时立即应用最后的位置和大小
+        apply_pointer_frame(osd);
         if (osd->resizing) {
             osd->resizing = FALSE;
             // 重置调整起始点
@@ -446,30 +779,29 @@ static gboolean on_motion_notify(GtkWidget *widget, GdkEventMotion *event, gpoin
 
     // 更新鼠标光标样式（锁定状态下也允许）
     if (!osd->dragging && !osd->resizing && !osd->is_locked) {
-        gtk_window_get_size(GTK_WINDOW(osd->window), &osd->window_width, &osd->window_height);
-        gboolean at_right_edge = (event->x >= osd->window_width - 10);
-        gboolean at_bottom_edge = (event->y >= osd->window_height - 10);
+        gboolean at_right_edge = (event->x >= gtk_widget_get_allocated_width(widget) - 10);
+        gboolean at_bottom_edge = (event->y >= gtk_widget_get_allocated_height(widget) - 10);
         gboolean at_corner = at_right_edge && at_bottom_edge;
         
         GdkWindow *gdk_window = gtk_widget_get_window(widget);
         if (gdk_window) {
-            GdkDisplay *display = gdk_window_get_display(gdk_window);
             GdkCursor *cursor = NULL;
             
             if (at_corner) {
                 // 右下角：双向调整光标
-                cursor = gdk_cursor_new_for_display(display, GDK_BOTTOM_RIGHT_CORNER);
+                cursor = resize_cursor(osd, gdk_window, RESIZE_CURSOR_CORNER);
             } else if (at_right_edge) {
                 // 右边缘：水平调整光标
-                cursor = gdk_cursor_new_for_display(display, GDK_SB_H_DOUBLE_ARROW);
+                cursor = resize_cursor(osd, gdk_window, RESIZE_CURSOR_RIGHT);
             } else if (at_bottom_edge) {
                 // 底边缘：垂直调整光标
-                cursor = gdk_cursor_new_for_display(display, GDK_SB_V_DOUBLE_ARROW);
+                cursor = resize_cursor(osd, gdk_window, RESIZE_CURSOR_BOTTOM);
             }
             
-            gdk_window_set_cursor(gdk_window, cursor);
-            if (cursor) {
-                g_object_unref(cursor);
+            // 光标不变时不再设置
+            if (cursor != osd->current_cursor) {
+                gdk_window_set_cursor(gdk_window, cursor);
+                osd->current_cursor = cursor;
             }
         }
     }
@@ -502,17 +834,20 @@ static gboolean on_motion_notify(GtkWidget *widget, GdkEventMotion *event, gpoin
             }
         }
         
-        // 如果有变化，更新窗口大小
+        // 如果有变化，在下一帧更新窗口大小
         if (width_changed || height_changed) {
-            gtk_window_resize(GTK_WINDOW(osd->window), osd->window_width, osd->window_height);
-            printf("🔧 [窗口调整] 调整大小到: %dx%d\n", osd->window_width, osd->window_height);
+            osd->resize_pending = TRUE;
+            schedule_pointer_frame(osd);
         }
+        osd->pointer_motions++;
         return TRUE;
     } else if (osd->dragging) {
-        // 自定义拖拽处理（主要用于KDE环境）
-        gint new_x = osd->window_start_x + (event->x_root - osd->drag_start_x);
-        gint new_y = osd->window_start_y + (event->y_root - osd->drag_start_y);
-        gtk_window_move(GTK_WINDOW(osd->window), new_x, new_y);
+        // 自定义拖拽处理（主要用于KDE环境），在下一帧移动窗口
+        osd->pending_x = osd->window_start_x + (event->x_root - osd->drag_start_x);
+        osd->pending_y = osd->window_start_y + (event->y_root - osd->drag_start_y);
+        osd->move_pending = TRUE;
+        schedule_pointer_frame(osd);
+        osd->pointer_motions++;
         return TRUE;
     }
     return FALSE;
@@ -625,6 +960,11 @@ static gboolean on_window_configure(GtkWidget *widget, GdkEventConfigure *event,
     static gint last_x = -1, last_y = -1;
     OSDLyrics *osd = (OSDLyrics *)data;
 
+    // 附加窗口的位置不保存
+    if (!osd->persistent) {
+        return FALSE;
+    }
+
     // 只有当位置真正变化时才保存配置
     if (event->x != last_x || event->y != last_y) {
         last_x = event->x;
@@ -741,6 +1081,13 @@ static void on_always_on_top_toggled(GtkToggleButton *button, gpointer data) {
 }
 
 static void on_close_clicked(GtkButton *button, gpointer data) {
+    OSDLyrics *instance = (OSDLyrics *)data;
+
+    // 附加窗口只关闭自己，主窗口退出程序
+    if (instance != osd) {
+        osd_lyrics_window_destroy(instance);
+        return;
+    }
     gtk_main_quit();
 }
 
@@ -784,158 +1131,84 @@ static void toggle_settings(OSDLyrics *osd) {
     }
 }
 
-// 更新透明度 - 只对背景设置透明度，文字保持不透明
-static void update_opacity(OSDLyrics *osd) {
-    // 不使用gtk_widget_set_opacity，而是通过CSS只对背景设置透明度
-    GtkCssProvider *provider = gtk_css_provider_new();
+// 绘制窗口背景 - 只对背景设置透明度，文字保持不透明
+static gboolean on_window_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    OSDLyrics *osd = (OSDLyrics *)data;
 
-    // 确保颜色值有效
-    gdouble red = osd->text_color.red * 255;
-    gdouble green = osd->text_color.green * 255;
-    gdouble blue = osd->text_color.blue * 255;
+    cairo_save(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, osd->opacity);
+    cairo_paint(cr);
+    cairo_restore(cr);
+    return FALSE;  // 继续绘制子控件
+}
 
-    // 如果颜色值无效，使用默认红色
-    if (red < 0 || red > 255 || green < 0 || green > 255 || blue < 0 || blue > 255) {
-        red = 255;
-        green = 0;
-        blue = 0;
-    }
-
-    gchar *css_data = g_strdup_printf(
-        "window {"
-        "  background-color: rgba(255, 255, 255, %.2f);"  /* 只有背景有透明度 */
-        "  border-radius: 1px;"
-        "  border: none;"  /* 移除边框 */
-        "}"
-        "label {"
-        "  color: rgba(%.0f, %.0f, %.0f, 1.0);"  /* 使用动态文字颜色 */
-        "  font-weight: bold;"
-        "  text-shadow: 0px 1px 2px rgba(255, 255, 255, 0.8);"
-        "}"
-        "scale {"
-        "  color: rgb(51, 51, 51);"
-        "}"
-        "scale trough {"
-        "  background-color: rgba(200, 200, 200, 0.8);"
-        "}"
-        "scale slider {"
-        "  background-color: rgb(100, 100, 100);"
-        "}"
-        "checkbutton {"
-        "  color: rgb(51, 51, 51);"
-        "}"
-        "checkbutton check {"
-        "  background-color: rgb(240, 240, 240);"
-        "  border: 1px solid rgb(200, 200, 200);"
-        "}"
-        "button {"
-        "  background-color: rgba(240, 240, 240, 0.9);"
-        "  color: rgb(51, 51, 51);"
-        "  border: 1px solid rgba(200, 200, 200, 0.8);"
-        "  border-radius: 50%%;"
-        "  padding: 2px;"
-        "  font-weight: bold;"
-        "}"
-        "button:hover {"
-        "  background-color: rgba(220, 220, 220, 0.95);"
-        "  color: rgb(255, 85, 85);"
-        "}"
-        "button#close-button {"
-        "  background: none !important;"
-        "  background-color: transparent !important;"
-        "  background-image: none !important;"
-        "  border: none !important;"
-        "  border-radius: 0 !important;"
-        "  box-shadow: none !important;"
-        "  color: rgba(100, 100, 100, 0.8);"
-        "  font-weight: bold;"
-        "  font-size: 16px;"
-        "  padding: 2px;"
-        "}"
-        "button#close-button:hover {"
-        "  color: rgb(255, 85, 85);"
-        "  background: none !important;"
-        "  background-color: transparent !important;"
-        "  background-image: none !important;"
-        "  border-radius: 0 !important;"
-        "  box-shadow: none !important;"
-        "}"
-        "button#mini-btn {"
-        "  background: none;"
-        "  border: none;"
-        "  color: rgba(100, 100, 100, 0.8);"
-        "  font-size: 12px;"
-        "  min-width: 20px;"
-        "  min-height: 20px;"
-        "  max-width: 20px;"
-        "  max-height: 20px;"
-        "  padding: 0px;"
-        "  margin: 1px;"
-        "  box-shadow: none;"
-        "}"
-        "button#mini-btn:hover {"
-        "  color: rgba(50, 50, 50, 1.0);"
-        "}"
-        "tooltip {"
-        "  background-color: rgba(255, 255, 255, 0.95);"
-        "  color: rgba(50, 50, 50, 1.0);"
-        "  border: 1px solid rgba(200, 200, 200, 0.8);"
-        "  border-radius: 4px;"
-        "  padding: 4px 8px;"
-        "  font-size: 11px;"
-        "  box-shadow: 0 2px 4px rgba(0, 0, 0, 0.1);"
-        "}", osd->opacity, red, green, blue);
-
-    gtk_css_provider_load_from_data(provider, css_data, -1, NULL);
-    gtk_style_context_add_provider_for_screen(gdk_screen_get_default(),
-                                            GTK_STYLE_PROVIDER(provider),
-                                            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-    g_object_unref(provider);
-    g_free(css_data);
+// 更新透明度 - 只重绘背景，不重新加载样式表
+static void update_opacity(OSDLyrics *osd) {
+    if (osd->window) {
+        gtk_widget_queue_draw(osd->window);
+    }
 }
 
 // 更新文字颜色
 static void update_text_color(OSDLyrics *osd) {
-    // 重新应用CSS以更新文字颜色
-    update_opacity(osd);
+    GdkRGBA color = osd->text_color;
+    color.alpha = 1.0;
+
+    // 如果颜色值无效，使用默认红色
+    if (color.red < 0 || color.red > 1 || color.green < 0 || color.green > 1 ||
+        color.blue < 0 || color.blue > 1) {
+        color.red = 1.0;
+        color.green = 0.0;
+        color.blue = 0.0;
+    }
+    gtk_widget_override_color(osd->label, GTK_STATE_FLAG_NORMAL, &color);
+
+    // 擦除控件和逐字高亮的已唱部分也使用文字颜色
+    if (osd->wipe) {
+        karaoke_wipe_set_played_color(osd->wipe, &osd->text_color);
+    }
+    osd->karaoke_played = -1;
+    krc_progress_sync();
+}
+
+// 绘制颜色按钮的色块（在边框以内）
+static gboolean on_color_button_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    OSDLyrics *osd = (OSDLyrics *)data;
+    GtkStyleContext *context = gtk_widget_get_style_context(widget);
+    GtkStateFlags state = gtk_style_context_get_state(context);
+    GtkBorder margin, border;
+
+    gtk_style_context_get_margin(context, state, &margin);
+    gtk_style_context_get_border(context, state, &border);
+    gdouble x = margin.left + border.left;
+    gdouble y = margin.top + border.top;
+    gdouble width = gtk_widget_get_allocated_width(widget) - x - margin.right - border.right;
+    gdouble height = gtk_widget_get_allocated_height(widget) - y - margin.bottom - border.bottom;
+    if (width <= 0 || height <= 0) {
+        return FALSE;
+    }
+
+    cairo_set_source_rgb(cr, osd->text_color.red, osd->text_color.green, osd->text_color.blue);
+    cairo_rectangle(cr, x, y, width, height);
+    cairo_fill(cr);
+    return FALSE;
 }
 
 // 更新颜色按钮外观
 static void update_color_button_appearance(OSDLyrics *osd) {
-    GtkCssProvider *color_provider = gtk_css_provider_new();
-    gchar *color_css = g_strdup_printf(
-        "button#color-button {"
-        "  background-color: rgb(%.0f, %.0f, %.0f);"
-        "  border: 1px solid rgba(150, 150, 150, 0.6);"
-        "  border-radius: 2px;"
-        "  min-width: 16px;"
-        "  min-height: 16px;"
-        "  max-width: 16px;"
-        "  max-height: 16px;"
-        "  padding: 0px;"
-        "  margin: 2px;"
-        "  box-shadow: none;"
-        "}"
-        "button#color-button:hover {"
-        "  border: 1px solid rgba(100, 100, 100, 0.8);"
-        "}",
-        osd->text_color.red * 255,
-        osd->text_color.green * 255,
-        osd->text_color.blue * 255);
-
-    gtk_css_provider_load_from_data(color_provider, color_css, -1, NULL);
-    gtk_style_context_add_provider(
-        gtk_widget_get_style_context(osd->color_button),
-        GTK_STYLE_PROVIDER(color_provider),
-        GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-    g_object_unref(color_provider);
-    g_free(color_css);
+    if (osd->color_button) {
+        gtk_widget_queue_draw(osd->color_button);
+    }
 }
 
 static void update_font_size(OSDLyrics *osd) {
     gchar *font_desc = g_strdup_printf("Sans Bold %d", osd->font_size);
     PangoFontDescription *font = pango_font_description_from_string(font_desc);
     gtk_widget_override_font(osd->label, font);
+    if (osd->wipe) {
+        gtk_widget_override_font(osd->wipe->widget, font);
+    }
     pango_font_description_free(font);
     g_free(font_desc);
 }
@@ -958,77 +1231,140 @@ static void update_mouse_through(OSDLyrics *osd) {
     }
 }
 
-// 使用SSE URL初始化OSD歌词系统
-gboolean osd_lyrics_init_with_sse(const gchar *sse_url);
+// 使用SSE URL列表初始化OSD歌词系统
+gboolean osd_lyrics_init_with_sse_urls(const gchar * const *sse_urls);
 
 // 初始化OSD歌词系统
 gboolean osd_lyrics_init(void) {
-    return osd_lyrics_init_with_sse(NULL);
+    return osd_lyrics_init_with_sse_urls(NULL);
 }
 
 // 使用SSE URL初始化OSD歌词系统
 gboolean osd_lyrics_init_with_sse(const gchar *sse_url) {
-    if (osd && osd->initialized) {
-        return TRUE; // 已经初始化
-    }
+    const gchar *sse_urls[] = {sse_url, NULL};
+    return osd_lyrics_init_with_sse_urls(sse_url ? sse_urls : NULL);
+}
 
-    osd = g_malloc0(sizeof(OSDLyrics));
+// 创建一个歌词窗口并应用默认设置（主窗口和附加窗口共用），加入窗口列表
+static OSDLyrics* osd_window_new(void) {
+    OSDLyrics *instance = g_malloc0(sizeof(OSDLyrics));
 
     // 创建窗口
-    osd->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    gtk_window_set_title(GTK_WINDOW(osd->window), "OSD Lyrics");
+    instance->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(instance->window), "OSD Lyrics");
 
     // 初始化默认值
-    osd->opacity = 0.7;  // 默认透明度调整为0.7
-    osd->font_size = 24;
-    osd->is_locked = FALSE;
-    osd->dragging = FALSE;
-    osd->resizing = FALSE;
-    osd->window_width = 800;
-    osd->window_height = 100;
-    osd->settings_visible = FALSE;
-    osd->hide_timer_id = 0;
-    osd->mouse_in_window = FALSE;
-    osd->unlock_timer_id = 0;
-    osd->showing_unlock_icon = FALSE;
-    osd->current_lyrics = g_strdup("OSD Lyrics - 鼠标悬停显示控制");
+    instance->opacity = 0.7;  // 默认透明度调整为0.7
+    instance->font_size = 24;
+    instance->window_width = 800;
+    instance->window_height = 100;
+    instance->karaoke_played = -1;
 
     // 设置默认红色文字
-    osd->text_color.red = 1.0;    // 红色
-    osd->text_color.green = 0.0;  // 绿色
-    osd->text_color.blue = 0.0;   // 蓝色
-    osd->text_color.alpha = 1.0;  // 不透明
+    instance->text_color.red = 1.0;    // 红色
+    instance->text_color.green = 0.0;  // 绿色
+    instance->text_color.blue = 0.0;   // 蓝色
+    instance->text_color.alpha = 1.0;  // 不透明
+
+    instance->initialized = TRUE;
+
+    // 设置窗口属性
+    setup_window_properties(instance);
+
+    // 创建UI
+    create_ui(instance);
+    g_signal_connect(instance->window, "draw", G_CALLBACK(on_window_draw), instance);
+
+    // 应用初始设置
+    update_text_color(instance);
+    update_font_size(instance);
+    update_opacity(instance);
+
+    g_ptr_array_add(osd_windows, instance);
+    return instance;
+}
+
+// 停止窗口的定时器，销毁窗口并从窗口列表中移除
+static void osd_window_free(OSDLyrics *instance) {
+    instance->initialized = FALSE;
 
-    // 设置SSE URL
-    if (sse_url) {
-        osd->sse_url = g_strdup(sse_url);
+    // 清理UI定时器
+    if (instance->hide_timer_id > 0) {
+        if (g_source_remove(instance->hide_timer_id)) {
+            printf("🧹 [清理] 已停止隐藏定时器 (ID: %u)\n", instance->hide_timer_id);
+        }
+        instance->hide_timer_id = 0;
+    }
+    if (instance->unlock_timer_id > 0) {
+        if (g_source_remove(instance->unlock_timer_id)) {
+            printf("🧹 [清理] 已停止解锁定时器 (ID: %u)\n", instance->unlock_timer_id);
+        }
+        instance->unlock_timer_id = 0;
+    }
+    if (instance->check_height_id > 0) {
+        g_source_remove(instance->check_height_id);
+        instance->check_height_id = 0;
     }
 
-    // 更新颜色按钮外观
-    update_color_button_appearance(osd);
+    g_free(instance->current_lyrics);
+    instance->current_lyrics = NULL;
 
-    osd->initialized = TRUE;
+    // 擦除控件本身随窗口销毁
+    karaoke_wipe_free(instance->wipe);
+    instance->wipe = NULL;
 
-    // 如果没有SSE URL，设置默认URL
-    if (!osd->sse_url) {
-        osd->sse_url = g_strdup("http://127.0.0.1:18911/api/osd-lyrics/sse");
+    for (guint i = 0; i < G_N_ELEMENTS(instance->resize_cursors); i++) {
+        if (instance->resize_cursors[i]) {
+            g_object_unref(instance->resize_cursors[i]);
+            instance->resize_cursors[i] = NULL;
+        }
     }
 
-    // 启动SSE连接
-    start_sse_connection(osd);
+    // 销毁GTK窗口（同时移除指针帧回调）
+    if (instance->window) {
+        gtk_widget_destroy(instance->window);
+        instance->window = NULL;
+    }
 
-    // 设置窗口属性
-    setup_window_properties(osd);
+    g_ptr_array_remove(osd_windows, instance);
+    g_free(instance);
+}
 
-    // 创建UI
-    create_ui(osd);
+// 使用SSE URL列表初始化OSD歌词系统
+gboolean osd_lyrics_init_with_sse_urls(const gchar * const *sse_urls) {
+    if (osd && osd->initialized) {
+        return TRUE; // 已经初始化
+    }
 
-    // 设置CSS样式
+    osd_windows = g_ptr_array_new();
+
+    // 设置CSS样式（所有窗口共用）
+    osd = osd_window_new();
+    osd->persistent = TRUE;
+    osd->current_lyrics = g_strdup("OSD Lyrics - 鼠标悬停显示控制");
     setup_css(osd);
 
-    // 应用初始设置
-    update_font_size(osd);
-    update_opacity(osd);
+    // 设置SSE URL列表
+    if (sse_urls && sse_urls[0]) {
+        osd->sse_urls = g_strdupv((gchar **)sse_urls);
+    }
+
+    // 如果没有SSE URL，设置默认URL
+    if (!osd->sse_urls) {
+        const gchar *default_urls[] = {"http://127.0.0.1:18911/api/osd-lyrics/sse", NULL};
+        osd->sse_urls = g_strdupv((gchar **)default_urls);
+    }
+
+    // 映射上次保存的时间轴缓存
+    gchar *cache_file = get_timeline_cache_path();
+    lyrics_timeline_cache_init(&timeline_cache, LYRICS_TIMELINE_CACHE_MEMORY_SIZE, cache_file);
+    g_free(cache_file);
+
+    // 开始统计唤醒次数，监听锁屏
+    power_init();
+
+    // 启动SSE连接（进程中只有这一个连接，附加窗口共享）
+    start_sse_connection(osd);
 
     // 加载保存的配置
     load_config(osd);
@@ -1036,6 +1372,88 @@ gboolean osd_lyrics_init_with_sse(const gchar *sse_url) {
     return TRUE;
 }
 
+// 获取主窗口
+OSDLyrics* osd_lyrics_get_default(void) {
+    return (osd && osd->initialized) ? osd : NULL;
+}
+
+// 创建附加窗口，初始设置复制自主窗口，立即显示当前行
+OSDLyrics* osd_lyrics_window_new(void) {
+    if (!osd || !osd->initialized) {
+        return NULL;
+    }
+
+    OSDLyrics *instance = osd_window_new();
+    instance->opacity = osd->opacity;
+    instance->font_size = osd->font_size;
+    instance->text_color = osd->text_color;
+    update_text_color(instance);
+    update_font_size(instance);
+    update_opacity(instance);
+    update_color_button_appearance(instance);
+    printf("🪟 [多窗口] 新建歌词窗口，共 %u 个\n", osd_windows->len);
+
+    // 有时间轴时从时间轴重新开始当前行（不再解析）；单行的逐字歌词交给新窗口，与其他窗口显示同一进度
+    if (timeline_state.timeline && timeline_state.current_line >= 0) {
+        timeline_show_line(timeline_state.current_line);
+    } else if (krc_progress_state.is_active && wipe_render) {
+        GArray *syllables = krc_progress_state.wipe_syllables;
+        karaoke_wipe_set_line(instance->wipe, osd->current_lyrics, strlen(osd->current_lyrics),
+                              (const LyricsSyllable *)(void *)syllables->data, syllables->len);
+        window_set_wipe_visible(instance, TRUE);
+        krc_progress_sync();
+    } else if (krc_progress_state.is_active) {
+        // 标签方式下逐字进度由同步渲染到新窗口
+        krc_progress_sync();
+    } else if (osd->current_lyrics) {
+        window_show_text(instance, osd->current_lyrics);
+    }
+    return instance;
+}
+
+// 销毁附加窗口
+void osd_lyrics_window_destroy(OSDLyrics *instance) {
+    if (!instance || instance == osd || !osd_windows) {
+        return;
+    }
+    osd_window_free(instance);
+    printf("🪟 [多窗口] 关闭歌词窗口，剩余 %u 个\n", osd_windows->len);
+    power_update_hidden();
+}
+
+// 把窗口移到指定显示器工作区的底部居中
+void osd_lyrics_window_move_to_monitor(OSDLyrics *instance, gint monitor_index) {
+    if (!instance || !instance->initialized) {
+        return;
+    }
+
+    GdkDisplay *display = gtk_widget_get_display(instance->window);
+    GdkMonitor *monitor = gdk_display_get_monitor(display, monitor_index);
+    if (!monitor) {
+        return;
+    }
+
+    GdkRectangle workarea;
+    gint width, height;
+    gdk_monitor_get_workarea(monitor, &workarea);
+    gtk_window_get_size(GTK_WINDOW(instance->window), &width, &height);
+    gtk_window_move(GTK_WINDOW(instance->window),
+                    workarea.x + (workarea.width - width) / 2,
+                    workarea.y + workarea.height - height - workarea.height / 10);
+}
+
+// 在一个窗口中显示整行文本：擦除控件可用时整行按已唱颜色绘制，反复出现的行直接复用缓存的布局
+static void window_show_text(OSDLyrics *instance, const gchar *text) {
+    if (instance->wipe) {
+        karaoke_wipe_set_line(instance->wipe, text, strlen(text), NULL, 0);
+        karaoke_wipe_set_played_color(instance->wipe, &instance->text_color);
+        window_set_wipe_visible(instance, TRUE);
+        karaoke_wipe_sync(instance->wipe, FALSE);
+        return;
+    }
+    gtk_label_set_text(GTK_LABEL(instance->label), text);
+}
+
 // 设置歌词文本
 void osd_lyrics_set_text(const gchar *lyrics) {
     if (!osd || !osd->label || !osd->initialized || !lyrics) {
@@ -1066,8 +1484,10 @@ void osd_lyrics_set_text(const gchar *lyrics) {
     }
     osd->current_lyrics = g_strdup(lyrics);
 
-    // 使用 try-catch 机制保护 GTK 调用
-    gtk_label_set_text(GTK_LABEL(osd->label), lyrics);
+    // 每个窗口按自己的颜色和字体显示同一行
+    for (guint i = 0; i < osd_windows->len; i++) {
+        window_show_text(g_ptr_array_index(osd_windows, i), lyrics);
+    }
 }
 
 // 设置带Pango标记的歌词文本（用于渐进式颜色效果）
@@ -1116,8 +1536,11 @@ void osd_lyrics_set_markup_text(const gchar *markup) {
     }
     osd->current_lyrics = g_strdup(markup);
 
-    // 使用 try-catch 机制保护 GTK 调用
-    gtk_label_set_markup(GTK_LABEL(osd->label), markup);
+    set_wipe_visible(FALSE);
+    for (guint i = 0; i < osd_windows->len; i++) {
+        OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+        gtk_label_set_markup(GTK_LABEL(instance->label), markup);
+    }
 }
 
 // 线程安全的文本更新结构
@@ -1189,6 +1612,7 @@ const gchar* osd_lyrics_get_text(void) {
 // 强制检查并修正窗口高度（防止GNOME环境下高度异常）
 static gboolean force_check_window_height(gpointer data) {
     OSDLyrics *osd = (OSDLyrics *)data;
+    osd->check_height_id = 0;
     if (osd && osd->window && osd->initialized) {
         gint current_width, current_height;
         gtk_window_get_size(GTK_WINDOW(osd->window), &current_width, &current_height);
@@ -1210,306 +1634,772 @@ static gboolean force_check_window_height(gpointer data) {
 }
 
 // 显示/隐藏窗口
-void osd_lyrics_set_visible(gboolean visible) {
-    if (osd && osd->window && osd->initialized) {
+void osd_lyrics_window_set_visible(OSDLyrics *instance, gboolean visible) {
+    if (instance && instance->window && instance->initialized) {
         if (visible) {
-            gtk_widget_show_all(osd->window);
-            if (!osd->settings_visible) {
-                gtk_widget_hide(osd->settings_box);
+            gtk_widget_show_all(instance->window);
+            if (!instance->settings_visible) {
+                gtk_widget_hide(instance->settings_box);
             }
             // 延迟检查窗口高度，确保窗口管理器完成布局后再修正
-            g_timeout_add(100, force_check_window_height, osd);
+            if (instance->check_height_id == 0) {
+                instance->check_height_id = g_timeout_add(100, force_check_window_height, instance);
+            }
         } else {
-            gtk_widget_hide(osd->window);
+            gtk_widget_hide(instance->window);
         }
+        power_update_hidden();
     }
 }
 
+void osd_lyrics_set_visible(gboolean visible) {
+    osd_lyrics_window_set_visible(osd, visible);
+}
+
 // 设置透明度
-void osd_lyrics_set_opacity(gdouble opacity) {
-    if (osd && osd->initialized) {
-        osd->opacity = CLAMP(opacity, 0.01, 0.90);
-        update_opacity(osd);
+void osd_lyrics_window_set_opacity(OSDLyrics *instance, gdouble opacity) {
+    if (instance && instance->initialized) {
+        instance->opacity = CLAMP(opacity, 0.01, 0.90);
+        update_opacity(instance);
     }
 }
 
+void osd_lyrics_set_opacity(gdouble opacity) {
+    osd_lyrics_window_set_opacity(osd, opacity);
+}
+
 // 设置字体大小
-void osd_lyrics_set_font_size(gint size) {
-    if (osd && osd->initialized) {
-        osd->font_size = CLAMP(size, 12, 48);
-        update_font_size(osd);
+void osd_lyrics_window_set_font_size(OSDLyrics *instance, gint size) {
+    if (instance && instance->initialized) {
+        instance->font_size = CLAMP(size, 12, 48);
+        update_font_size(instance);
     }
 }
 
+void osd_lyrics_set_font_size(gint size) {
+    osd_lyrics_window_set_font_size(osd, size);
+}
+
 // 设置锁定状态
-void osd_lyrics_set_mouse_through(gboolean enabled) {
-    if (osd && osd->initialized) {
-        osd->is_locked = enabled;
+void osd_lyrics_window_set_mouse_through(OSDLyrics *instance, gboolean enabled) {
+    if (instance && instance->initialized) {
+        instance->is_locked = enabled;
         if (enabled) {
-            gtk_button_set_label(GTK_BUTTON(osd->lock_button), "🔒");
-            gtk_widget_set_tooltip_text(osd->lock_button, "已锁定（鼠标穿透）");
+            gtk_button_set_label(GTK_BUTTON(instance->lock_button), "🔒");
+            gtk_widget_set_tooltip_text(instance->lock_button, "已锁定（鼠标穿透）");
         } else {
-            gtk_button_set_label(GTK_BUTTON(osd->lock_button), "🔓");
-            gtk_widget_set_tooltip_text(osd->lock_button, "锁定窗口（启用鼠标穿透）");
+            gtk_button_set_label(GTK_BUTTON(instance->lock_button), "🔓");
+            gtk_widget_set_tooltip_text(instance->lock_button, "锁定窗口（启用鼠标穿透）");
         }
-        update_mouse_through(osd);
+        update_mouse_through(instance);
     }
 }
 
+void osd_lyrics_set_mouse_through(gboolean enabled) {
+    osd_lyrics_window_set_mouse_through(osd, enabled);
+}
+
 // 设置置顶
-void osd_lyrics_set_always_on_top(gboolean enabled) {
-    if (osd && osd->initialized) {
-        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(osd->always_on_top_toggle), enabled);
-        gtk_window_set_keep_above(GTK_WINDOW(osd->window), enabled);
+void osd_lyrics_window_set_always_on_top(OSDLyrics *instance, gboolean enabled) {
+    if (instance && instance->initialized) {
+        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(instance->always_on_top_toggle), enabled);
+        gtk_window_set_keep_above(GTK_WINDOW(instance->window), enabled);
         
         // GNOME兼容性设置
         if (enabled) {
-            gtk_window_set_type_hint(GTK_WINDOW(osd->window), GDK_WINDOW_TYPE_HINT_DOCK);
-            gtk_window_present(GTK_WINDOW(osd->window));
+            gtk_window_set_type_hint(GTK_WINDOW(instance->window), GDK_WINDOW_TYPE_HINT_DOCK);
+            gtk_window_present(GTK_WINDOW(instance->window));
         } else {
-            gtk_window_set_type_hint(GTK_WINDOW(osd->window), GDK_WINDOW_TYPE_HINT_NORMAL);
+            gtk_window_set_type_hint(GTK_WINDOW(instance->window), GDK_WINDOW_TYPE_HINT_NORMAL);
         }
     }
 }
 
+void osd_lyrics_set_always_on_top(gboolean enabled) {
+    osd_lyrics_window_set_always_on_top(osd, enabled);
+}
+
 // 设置文字颜色
-void osd_lyrics_set_text_color(const GdkRGBA *color) {
-    if (osd && osd->initialized && color) {
+void osd_lyrics_window_set_text_color(OSDLyrics *instance, const GdkRGBA *color) {
+    if (instance && instance->initialized && color) {
         // 复制颜色值
-        osd->text_color = *color;
+        instance->text_color = *color;
 
         // 更新颜色按钮外观
-        update_color_button_appearance(osd);
+        update_color_button_appearance(instance);
 
         // 更新文字颜色
-        update_text_color(osd);
+        update_text_color(instance);
     }
 }
 
+void osd_lyrics_set_text_color(const GdkRGBA *color) {
+    osd_lyrics_window_set_text_color(osd, color);
+}
+
 // 获取当前文字颜色
+void osd_lyrics_window_get_text_color(OSDLyrics *instance, GdkRGBA *color) {
+    if (instance && instance->initialized && color) {
+        *color = instance->text_color;
+    }
+}
+
 void osd_lyrics_get_text_color(GdkRGBA *color) {
-    if (osd && osd->initialized && color) {
-        *color = osd->text_color;
+    osd_lyrics_window_get_text_color(osd, color);
+}
+
+// 把一行歌词交给显示逻辑（SSE客户端回调，线程模式在连接线程中调用，主循环模式在主线程中调用）
+// 两种模式都经过无锁队列发布到主线程，歌词和KRC状态只由主线程访问
+static void sse_apply_lyrics(const gchar *song_name, const gchar *text, gsize text_len,
+                             const gchar *format, gint64 received_time, gboolean restored,
+                             gpointer user_data) {
+    OSDLyrics *osd = (OSDLyrics *)user_data;
+    if (!osd || !osd->initialized) {
+        return;
+    }
+
+    if (!lyrics_queue_push(&osd->update_queue, song_name, text, text_len, format, received_time, restored)) {
+        printf("♻️ [OSD歌词] 丢弃重复歌词\n");
     }
 }
 
-// SSE数据结构
+// 显示一行歌词（队列回调，在主线程中调用）
+static void display_sse_lyrics(const LyricsUpdate *update, gpointer user_data) {
+    OSDLyrics *osd = (OSDLyrics *)user_data;
+    const gchar *lyrics_text = update->text;
+
+    if (!osd->initialized) {
+        return;
+    }
+
+    gint64 latency_us = g_get_monotonic_time() - update->queued_us;
+    dispatch_stats.count++;
+    dispatch_stats.total_us += latency_us;
+    dispatch_stats.max_us = MAX(dispatch_stats.max_us, latency_us);
+
+    // 重复时间标签的行（副歌）按当前位置选定一个时间标签，同步参考和逐字显示使用同一个
+    gint64 line_start_ms = lyrics_timeline_line_start(lyrics_text, timeline_position_ms());
+
+    // 已有整首歌词时，该行只用于同步本地时间轴
+    if (timeline_handle_hint(update, line_start_ms)) {
+        return;
+    }
+
+    // 根据格式字段正确处理歌词
+    if (strcmp(update->format, "krc") != 0) {
+        printf("📝 [OSD歌词] 处理LRC格式歌词\n");
+        // 清理KRC状态
+        clear_krc_state();
+        osd_lyrics_process_lrc_line(lyrics_text, update->received_time, line_start_ms);
+        return;
+    }
+
+    printf("📝 [OSD歌词] 处理原始歌词: %s\n", lyrics_text);
+
+    if (strstr(lyrics_text, "[") && strstr(lyrics_text, ",") && strstr(lyrics_text, "]<")) {
+        // KRC格式：[171960,5040]<0,240,0>你<240,150,0>走...
+        printf("🎤 [OSD歌词] 检测到KRC格式，启动渐进式播放模式\n");
+        osd_lyrics_start_krc_progressive_display(lyrics_text, update->received_time, line_start_ms);
+    } else if (strstr(lyrics_text, "[") && strstr(lyrics_text, ":") && strstr(lyrics_text, "]")) {
+        // LRC格式：[02:51.96]你走之后我又 再为谁等候
+        printf("📝 [OSD歌词] 检测到LRC格式，提取文本显示\n");
+        osd_lyrics_process_lrc_line(lyrics_text, update->received_time, line_start_ms);
+    } else {
+        // 纯文本
+        printf("📝 [OSD歌词] 纯文本模式: %s\n", lyrics_text);
+        clear_krc_state();
+        osd_lyrics_set_text_safe(lyrics_text);
+    }
+}
+
+// 整首歌词文档（在主线程中加载）
 typedef struct {
-    OSDLyrics *osd;
-    gchar *buffer;
-    size_t buffer_size;
-} SSEData;
-
-// SSE写入回调函数
-static size_t sse_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    SSEData *sse_data = (SSEData *)userp;
-
-    // 检查输入参数有效性
-    if (!sse_data || !contents || realsize == 0) {
-        return 0;
-    }
-
-    // 检查OSD对象是否仍然有效
-    if (!sse_data->osd || !sse_data->osd->initialized) {
-        printf("⚠️ [SSE回调] OSD对象已失效，停止处理数据\n");
-        return 0;
-    }
-
-    // 重新分配缓冲区，添加错误检查
-    gchar *new_buffer = g_realloc(sse_data->buffer, sse_data->buffer_size + realsize + 1);
-    if (new_buffer == NULL) {
-        g_warning("SSE缓冲区内存分配失败");
-        return 0;
-    }
-    sse_data->buffer = new_buffer;
-
-    // 复制数据到缓冲区
-    memcpy(&(sse_data->buffer[sse_data->buffer_size]), contents, realsize);
-    sse_data->buffer_size += realsize;
-    sse_data->buffer[sse_data->buffer_size] = 0;
-
-    // 处理SSE数据
-    gchar **lines = g_strsplit(sse_data->buffer, "\n", -1);
-    for (int i = 0; lines[i] != NULL; i++) {
-        if (g_str_has_prefix(lines[i], "data: ")) {
-            gchar *json_data = lines[i] + 6; // 跳过 "data: "
-
-            // 解析JSON数据
-            json_object *root = json_tokener_parse(json_data);
-            if (root) {
-                json_object *type_obj, *text_obj, *song_obj, *artist_obj;
-
-                if (json_object_object_get_ex(root, "type", &type_obj)) {
-                    const char *type = json_object_get_string(type_obj);
-
-                    if (strcmp(type, "lyrics_update") == 0) {
-                        const char *text = "";
-                        const char *song = "";
-                        const char *artist = "";
-                        const char *format = "lrc"; // 默认格式
-
-                        if (json_object_object_get_ex(root, "text", &text_obj)) {
-                            text = json_object_get_string(text_obj);
-                        }
-                        if (json_object_object_get_ex(root, "songName", &song_obj)) {
-                            song = json_object_get_string(song_obj);
-                        }
-                        if (json_object_object_get_ex(root, "artist", &artist_obj)) {
-                            artist = json_object_get_string(artist_obj);
-                        }
-
-                        // 检查歌词格式
-                        json_object *format_obj;
-                        if (json_object_object_get_ex(root, "format", &format_obj)) {
-                            format = json_object_get_string(format_obj);
-                        }
-
-                        printf("🎵 [OSD歌词] 收到歌词 (%s): %s - %s\n", format, song, artist);
-
-                        // 根据格式字段正确处理歌词
-                        if (strcmp(format, "krc") == 0) {
-                            printf("🎤 [OSD歌词] 处理KRC格式歌词\n");
-                            gchar *lyrics_data = g_strdup(text);
-                            gdk_threads_add_idle(update_krc_lyrics_from_sse, lyrics_data);
-                        } else {
-                            printf("📝 [OSD歌词] 处理LRC格式歌词\n");
-                            // 清理KRC状态
-                            clear_krc_state();
-                            // 直接处理LRC歌词
-                            osd_lyrics_process_lrc_line(text);
-                        }
-                    } else if (strcmp(type, "connected") == 0) {
-                        printf("✅ [OSD歌词] SSE连接成功\n");
-                    } else if (strcmp(type, "heartbeat") == 0) {
-                        printf("💓 [OSD歌词] 收到心跳\n");
-                    }
-                }
+    gchar *song;
+    gchar *artist;             // 紧凑编码时为NULL
+    gchar *format;
+    gchar *document;
+    gsize document_len;
+    LyricsTimeline *timeline;  // 紧凑编码已构建好的时间轴，此时没有 document
+} LyricsDocumentUpdate;
+
+// 整首歌词文档回调（与 sse_apply_lyrics 在同一线程中调用），交给主线程解析
+static void sse_apply_document(const gchar *song_name, const gchar *artist,
+                               const gchar *document, gsize document_len,
+                               const gchar *format, gpointer user_data) {
+    OSDLyrics *osd = (OSDLyrics *)user_data;
+    if (!osd || !osd->initialized) {
+        return;
+    }
 
-                json_object_put(root);
-            }
+    LyricsDocumentUpdate *update = g_malloc0(sizeof(LyricsDocumentUpdate));
+    update->song = g_strdup(song_name);
+    update->artist = g_strdup(artist);
+    update->format = g_strdup(format);
+    update->document = g_strndup(document, document_len);
+    update->document_len = document_len;
+    gdk_threads_add_idle(load_lyrics_document, update);
+}
+
+// 紧凑编码的整首歌词回调，时间轴已在网络线程中构建好，交给主线程替换
+static void sse_apply_timeline(LyricsTimeline *timeline, gpointer user_data) {
+    OSDLyrics *osd = (OSDLyrics *)user_data;
+    if (!osd || !osd->initialized) {
+        lyrics_timeline_free(timeline);
+        return;
+    }
+
+    LyricsDocumentUpdate *update = g_malloc0(sizeof(LyricsDocumentUpdate));
+    update->song = g_strdup(timeline->song);
+    update->format = g_strdup(timeline->format);
+    update->timeline = timeline;
+    gdk_threads_add_idle(load_lyrics_document, update);
+}
+
+// 当前播放位置（毫秒），未校准时为-1
+static gint64 timeline_position_ms(void) {
+    return playback_clock_position(&playback_clock, g_get_monotonic_time() / 1000);
+}
+
+// 显示时间轴中的一行
+static void timeline_show_line(gint index) {
+    const LyricsTimeline *timeline = timeline_state.timeline;
+
+    timeline_state.current_line = index;
+    if (index < 0) {
+        // 第一行之前（前奏）
+        clear_krc_state();
+        osd_lyrics_set_text("");
+        return;
+    }
+
+    const LyricsLine *line = &timeline->lines[index];
+    if (line->syllable_count > 0) {
+        // 逐字进度由播放时钟驱动，直接使用时间轴中的音节，不再解析原始行
+        start_karaoke_line(lyrics_timeline_line_text(timeline, index), line->text_length,
+                           timeline->syllables + line->first_syllable, line->syllable_count,
+                           g_get_monotonic_time() / 1000, line->start_ms);
+    } else {
+        clear_krc_state();
+        osd_lyrics_set_text(lyrics_timeline_line_text(timeline, index));
+    }
+}
+
+static gboolean on_timeline_switch(gpointer data);
+
+// 在下一行的开始时间安排换行
+static void timeline_schedule_next(void) {
+    const LyricsTimeline *timeline = timeline_state.timeline;
+
+    if (timeline_state.timer_id > 0) {
+        g_source_remove(timeline_state.timer_id);
+        timeline_state.timer_id = 0;
+    }
+
+    guint next = (guint)(timeline_state.current_line + 1);
+    if (next >= timeline->n_lines || power_state.reasons) {
+        return; // 最后一行，或空闲时停止换行
+    }
+
+    // 暂停时不安排换行，恢复播放时重新同步
+    gint64 delay_ms = playback_clock_time_until(&playback_clock, timeline->lines[next].start_ms,
+                                                g_get_monotonic_time() / 1000);
+    if (delay_ms < 0) {
+        return;
+    }
+    timeline_state.scheduled_us = g_get_monotonic_time() + delay_ms * 1000;
+    timeline_state.timer_id = g_timeout_add((guint)delay_ms, on_timeline_switch, NULL);
+
+    // 在换行之前的空闲时间里排版并栅格化下一行（每个窗口按自己的字体）
+    for (guint i = 0; i < osd_windows->len; i++) {
+        OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+        if (instance->wipe) {
+            karaoke_wipe_prepare(instance->wipe, lyrics_timeline_line_text(timeline, next),
+                                 timeline->lines[next].text_length);
         }
     }
-    g_strfreev(lines);
+}
+
+// 按当前位置显示正确的行并安排下一次换行
+static void timeline_sync(void) {
+    if (!playback_clock.valid) {
+        return;
+    }
+
+    gint index = lyrics_timeline_find_line(timeline_state.timeline, timeline_position_ms());
+    if (index != timeline_state.current_line) {
+        timeline_show_line(index);
+    } else {
+        // 仍是同一行，但时钟可能被校准过，重新安排逐字唤醒
+        krc_progress_sync();
+    }
+    timeline_schedule_next();
+}
 
-    // 清空缓冲区
-    sse_data->buffer_size = 0;
+// 本地换行定时器
+static gboolean on_timeline_switch(gpointer data) {
+    (void)data;
+    timeline_state.timer_id = 0;
+    if (!timeline_state.timeline || !osd || !osd->initialized) {
+        return G_SOURCE_REMOVE;
+    }
+
+    // timeline_sync 会安排下一次换行，先记下这次的计划时间
+    gint64 scheduled_us = timeline_state.scheduled_us;
+    timeline_state.local_switches++;
+    timeline_state.total_late_us += g_get_monotonic_time() - scheduled_us;
+    timeline_sync();
+    for (guint i = 0; i < osd_windows->len; i++) {
+        OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+        if (instance->wipe) {
+            karaoke_wipe_note_switch(instance->wipe, scheduled_us);
+        }
+    }
+    return G_SOURCE_REMOVE;
+}
 
-    return realsize;
+// 释放当前时间轴并停止本地换行
+static void timeline_reset(void) {
+    if (timeline_state.timer_id > 0) {
+        g_source_remove(timeline_state.timer_id);
+        timeline_state.timer_id = 0;
+    }
+    lyrics_timeline_free(timeline_state.timeline);
+    timeline_state.timeline = NULL;
+    timeline_state.current_line = -1;
 }
 
-// 旧的更新函数已移除，现在统一使用 update_krc_lyrics_from_sse
+// 处理一行歌词事件：记录同步参考；时间轴属于同一首歌时返回TRUE，由时间轴负责显示
+static gboolean timeline_handle_hint(const LyricsUpdate *update, gint64 line_start_ms) {
+    gint64 position_ms = line_start_ms;
+    if (position_ms >= 0) {
+        if (!timeline_state.anchor_song || strcmp(timeline_state.anchor_song, update->song) != 0) {
+            g_free(timeline_state.anchor_song);
+            timeline_state.anchor_song = g_strdup(update->song);
+        }
+        // 服务器提供position时以它为准，行开始时间包含网络延迟
+        if (!timeline_state.explicit_position) {
+            playback_clock_observe(&playback_clock, position_ms, update->received_time);
+        }
+        timeline_state.sync_hints++;
+    }
 
-// 在主线程中更新歌词（处理原始KRC/LRC格式）
-static gboolean update_krc_lyrics_from_sse(gpointer data) {
-    gchar *lyrics_text = (gchar *)data;
-    if (lyrics_text && osd && osd->initialized) {
-        printf("📝 [OSD歌词] 处理原始歌词: %s\n", lyrics_text);
+    if (!timeline_state.timeline) {
+        return FALSE;
+    }
+    if (strcmp(timeline_state.timeline->song, update->song) != 0) {
+        // 换歌了，等待新歌的整首歌词
+        printf("📜 [时间轴] 歌曲已切换，释放旧时间轴\n");
+        timeline_reset();
+        return FALSE;
+    }
+    if (position_ms < 0) {
+        return FALSE;
+    }
+
+    timeline_sync();
+    return TRUE;
+}
 
-        if (strstr(lyrics_text, "[") && strstr(lyrics_text, ",") && strstr(lyrics_text, "]<")) {
-            // KRC格式：[171960,5040]<0,240,0>你<240,150,0>走...
-            printf("🎤 [OSD歌词] 检测到KRC格式，启动渐进式播放模式\n");
-            osd_lyrics_start_krc_progressive_display(lyrics_text);
-        } else if (strstr(lyrics_text, "[") && strstr(lyrics_text, ":") && strstr(lyrics_text, "]")) {
-            // LRC格式：[02:51.96]你走之后我又 再为谁等候
-            printf("📝 [OSD歌词] 检测到LRC格式，提取文本显示\n");
-            osd_lyrics_process_lrc_line(lyrics_text);
+// 在主线程中解析整首歌词
+static gboolean load_lyrics_document(gpointer data) {
+    LyricsDocumentUpdate *update = (LyricsDocumentUpdate *)data;
+
+    if (osd && osd->initialized) {
+        gint64 start_time = g_get_monotonic_time();
+        gboolean cached = FALSE;
+        timeline_reset();
+        if (update->timeline) {
+            timeline_state.timeline = update->timeline;
+            update->timeline = NULL;
         } else {
-            // 纯文本
-            printf("📝 [OSD歌词] 纯文本模式: %s\n", lyrics_text);
-            osd_lyrics_set_text_safe(lyrics_text);
+            // 重复播放的歌曲从缓存取回，不再解析
+            timeline_state.timeline = lyrics_timeline_cache_lookup(&timeline_cache, update->song, update->artist,
+                                                                   update->format, update->document,
+                                                                   update->document_len);
+            cached = timeline_state.timeline != NULL;
+            if (!cached) {
+                timeline_state.timeline = lyrics_timeline_parse(update->song, update->format,
+                                                                update->document, update->document_len);
+                lyrics_timeline_cache_insert(&timeline_cache, update->song, update->artist, update->format,
+                                             timeline_state.timeline);
+            }
         }
 
-        g_free(lyrics_text);
+        if (timeline_state.timeline) {
+            printf("📜 [时间轴] 已加载 %s: %u 行, %u 个音节, %s耗时 %" G_GINT64_FORMAT "us\n",
+                   update->song, timeline_state.timeline->n_lines, timeline_state.timeline->n_syllables,
+                   cached ? "缓存命中, " : "解析", g_get_monotonic_time() - start_time);
+
+            // 已经收到过这首歌的行，立即开始本地播放
+            if (timeline_state.anchor_song && strcmp(timeline_state.anchor_song, update->song) == 0) {
+                timeline_sync();
+            }
+        } else {
+            printf("⚠️ [时间轴] 整首歌词中没有带时间的行\n");
+        }
     }
+
+    g_free(update->song);
+    g_free(update->artist);
+    g_free(update->format);
+    g_free(update->document);
+    lyrics_timeline_free(update->timeline);
+    g_free(update);
     return G_SOURCE_REMOVE;
 }
 
-// 启动SSE连接
-static void start_sse_connection(OSDLyrics *osd) {
-    if (!osd->sse_url) {
+// 播放状态回调（与 sse_apply_lyrics 在同一线程中调用），经队列交给主线程
+static void sse_apply_playback(gint64 position_ms, gint paused, gdouble rate, gint64 received_time,
+                               gpointer user_data) {
+    OSDLyrics *osd = (OSDLyrics *)user_data;
+    if (!osd || !osd->initialized) {
         return;
     }
+    lyrics_queue_push_playback(&osd->update_queue, position_ms, paused, rate, received_time);
+}
 
-    // 在新线程中运行SSE连接
-    g_thread_new("sse-connection", (GThreadFunc)sse_connection_thread, osd);
+// 在主线程中应用播放状态：速率、暂停，然后用位置校准时钟
+static void apply_playback_state(const LyricsPlayback *playback, gpointer user_data) {
+    OSDLyrics *osd = (OSDLyrics *)user_data;
+    gint64 now = g_get_monotonic_time() / 1000;
+
+    if (!osd->initialized) {
+        return;
+    }
+
+    if (playback->rate > 0 && playback_clock_set_rate(&playback_clock, playback->rate, now)) {
+        printf("⏩ [播放时钟] 速率: %.2f\n", playback->rate);
+    }
+    if (playback->paused >= 0 && playback_clock_set_paused(&playback_clock, playback->paused, now)) {
+        printf("%s [播放时钟] %s\n", playback->paused ? "⏸️" : "▶️", playback->paused ? "暂停" : "继续播放");
+        power_set_idle(POWER_IDLE_PAUSED, playback->paused);
+    }
+
+    // 快照中的位置可能已经应用过
+    if (playback->position_ms >= 0 && playback->position_time > timeline_state.last_position_time) {
+        timeline_state.explicit_position = TRUE;
+        timeline_state.last_position_time = playback->position_time;
+
+        if (playback_clock_observe(&playback_clock, playback->position_ms, playback->position_time) == PLAYBACK_CLOCK_JUMP) {
+            const LyricsTimeline *timeline = timeline_state.timeline;
+            gint line = timeline ? lyrics_timeline_find_line(timeline, playback->position_ms) : -1;
+            gint syllable = line >= 0 ? lyrics_timeline_find_syllable(timeline, line, playback->position_ms) : -1;
+            printf("⏭️ [播放时钟] 跳转到 %" G_GINT64_FORMAT "ms (第 %d 行, 第 %d 个字)\n",
+                   playback->position_ms, line, syllable);
+        }
+    }
+
+    // 按新的时钟重新确定当前行和下一次换行（暂停时停止换行）
+    playback_resync();
 }
 
-// SSE连接线程
-static gpointer sse_connection_thread(gpointer data) {
-    OSDLyrics *osd = (OSDLyrics *)data;
+// 按播放时钟重新确定当前行、下一次换行和逐字进度
+static void playback_resync(void) {
+    if (timeline_state.timeline && timeline_state.anchor_song &&
+        strcmp(timeline_state.timeline->song, timeline_state.anchor_song) == 0) {
+        timeline_sync();
+    } else {
+        krc_progress_sync();
+    }
+}
 
-    if (!osd) {
-        printf("❌ [SSE线程] OSD对象为空，线程退出\n");
-        return NULL;
+// 进程到目前为止的唤醒次数
+static glong process_wakeups(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_nvcsw : 0;
+}
+
+// 设置主线程的定时器松弛，不支持时忽略
+static void power_set_timer_slack(glong slack_ns) {
+#ifdef PR_SET_TIMERSLACK
+    if (slack_ns >= 0) {
+        prctl(PR_SET_TIMERSLACK, (unsigned long)slack_ns, 0, 0, 0);
     }
+#else
+    (void)slack_ns;
+#endif
+}
 
-    printf("🔗 [OSD歌词] 开始SSE连接线程\n");
+// 屏幕保护程序（锁屏）状态变化，GNOME和KDE都发出 ActiveChanged(b)
+static void on_screensaver_active_changed(GDBusConnection *connection, const gchar *sender_name,
+                                          const gchar *object_path, const gchar *interface_name,
+                                          const gchar *signal_name, GVariant *parameters, gpointer user_data) {
+    gboolean active = FALSE;
 
-    while (osd && osd->initialized) {
-        CURL *curl;
-        CURLcode res;
-        SSEData sse_data = {0};
+    (void)connection; (void)sender_name; (void)object_path;
+    (void)interface_name; (void)signal_name; (void)user_data;
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(b)"))) {
+        return;
+    }
+    g_variant_get(parameters, "(b)", &active);
+    if (osd && osd->initialized) {
+        power_set_idle(POWER_IDLE_LOCKED, active);
+    }
+}
 
-        // 再次检查OSD对象有效性
-        if (!osd || !osd->initialized) {
-            printf("⚠️ [SSE线程] OSD对象已失效，退出连接循环\n");
-            break;
+// 记录唤醒统计的起点，订阅锁屏信号
+static void power_init(void) {
+    power_state.reasons = 0;
+    power_state.start_us = g_get_monotonic_time();
+    power_state.start_wakeups = process_wakeups();
+    power_state.idle_us = 0;
+    power_state.idle_wakeups = 0;
+#ifdef PR_GET_TIMERSLACK
+    power_state.normal_slack_ns = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+#endif
+
+    // 没有会话总线（如在无桌面环境中运行）时只按暂停和隐藏进入空闲
+    power_state.bus = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, NULL);
+    if (power_state.bus) {
+        for (guint i = 0; i < G_N_ELEMENTS(screensaver_services); i++) {
+            power_state.screensaver_ids[i] = g_dbus_connection_signal_subscribe(
+                power_state.bus, screensaver_services[i].name, screensaver_services[i].name, "ActiveChanged",
+                screensaver_services[i].path, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+                on_screensaver_active_changed, NULL, NULL);
         }
+    }
+}
 
-        sse_data.osd = osd;
-        sse_data.buffer = NULL;
-        sse_data.buffer_size = 0;
-
-        printf("🔗 [OSD歌词] 尝试连接到: %s\n", osd->sse_url);
-
-        curl = curl_easy_init();
-        if (curl) {
-            curl_easy_setopt(curl, CURLOPT_URL, osd->sse_url);
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, sse_write_callback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sse_data);
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT, 0L); // 无超时
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L); // 连接超时10秒
-            // 添加信号处理，允许中断长时间连接
-            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-
-            // 设置SSE头部
-            struct curl_slist *headers = NULL;
-            headers = curl_slist_append(headers, "Accept: text/event-stream");
-            headers = curl_slist_append(headers, "Cache-Control: no-cache");
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-            res = curl_easy_perform(curl);
-
-            if (res != CURLE_OK) {
-                printf("❌ [OSD歌词] SSE连接失败: %s\n", curl_easy_strerror(res));
-            } else {
-                printf("🔌 [OSD歌词] SSE连接断开\n");
+// 取消锁屏信号订阅，恢复定时器松弛
+static void power_cleanup(void) {
+    if (power_state.bus) {
+        for (guint i = 0; i < G_N_ELEMENTS(power_state.screensaver_ids); i++) {
+            if (power_state.screensaver_ids[i] > 0) {
+                g_dbus_connection_signal_unsubscribe(power_state.bus, power_state.screensaver_ids[i]);
+                power_state.screensaver_ids[i] = 0;
             }
-
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
         }
+        g_object_unref(power_state.bus);
+        power_state.bus = NULL;
+    }
+    if (power_state.reasons) {
+        power_set_timer_slack(power_state.normal_slack_ns);
+    }
+}
+
+// 所有窗口都隐藏时才算隐藏
+static void power_update_hidden(void) {
+    gboolean hidden = TRUE;
 
-        // 安全清理缓冲区
-        if (sse_data.buffer) {
-            g_free(sse_data.buffer);
-            sse_data.buffer = NULL;
+    for (guint i = 0; i < osd_windows->len; i++) {
+        OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+        if (gtk_widget_get_visible(instance->window)) {
+            hidden = FALSE;
+            break;
         }
+    }
+    power_set_idle(POWER_IDLE_HIDDEN, hidden);
+}
+
+// 设置或清除一个空闲原因
+// 第一个原因出现时停止所有显示定时器并放宽定时器松弛，最后一个原因消失时恢复并重新同步
+static void power_set_idle(guint reason, gboolean idle) {
+    guint reasons = idle ? (power_state.reasons | reason) : (power_state.reasons & ~reason);
+    gint64 now = g_get_monotonic_time();
+
+    if (reasons == power_state.reasons) {
+        return;
+    }
+
+    if (!power_state.reasons) {
+        power_state.reasons = reasons;
+        power_state.idle_since_us = now;
+        power_state.idle_since_wakeups = process_wakeups();
 
-        // 检查程序是否还在运行，如果是则等待后重连
-        if (osd && osd->initialized) {
-            printf("⏰ [OSD歌词] 3秒后重连...\n");
-            // 使用更短的睡眠间隔，以便更快响应程序退出
-            for (int i = 0; i < 30 && osd && osd->initialized; i++) {
-                g_usleep(100 * 1000); // 100ms * 30 = 3秒
+        if (timeline_state.timer_id > 0) {
+            g_source_remove(timeline_state.timer_id);
+            timeline_state.timer_id = 0;
+        }
+        if (krc_progress_state.timer_id > 0) {
+            g_source_remove(krc_progress_state.timer_id);
+            krc_progress_state.timer_id = 0;
+        }
+        for (guint i = 0; osd_windows && i < osd_windows->len; i++) {
+            OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+            if (instance->wipe) {
+                karaoke_wipe_stop(instance->wipe);
             }
         }
+        power_set_timer_slack(POWER_IDLE_TIMER_SLACK_NS);
+        printf("🌙 [省电] 进入空闲 (%s%s%s)\n",
+               (reasons & POWER_IDLE_PAUSED) ? " 暂停" : "",
+               (reasons & POWER_IDLE_HIDDEN) ? " 隐藏" : "",
+               (reasons & POWER_IDLE_LOCKED) ? " 锁屏" : "");
+        return;
+    }
+
+    power_state.reasons = reasons;
+    if (reasons) {
+        return; // 仍有其他空闲原因
+    }
+
+    gint64 idle_us = now - power_state.idle_since_us;
+    glong wakeups = process_wakeups() - power_state.idle_since_wakeups;
+    power_state.idle_us += idle_us;
+    power_state.idle_wakeups += wakeups;
+    power_set_timer_slack(power_state.normal_slack_ns);
+    printf("☀️ [省电] 退出空闲, 持续 %.1f s, 每秒唤醒: %.2f\n",
+           idle_us / 1e6, idle_us > 0 ? wakeups * 1e6 / idle_us : 0.0);
+
+    playback_resync();
+}
+
+// 输出分发延迟和进程上下文切换次数，用于比较线程模式和主循环模式
+static void print_dispatch_stats(void) {
+    struct rusage usage;
+
+    printf("📊 [分发统计] 传输: %s, 歌词: %" G_GUINT64_FORMAT ", 平均分发延迟: %.1f us, 最大: %" G_GINT64_FORMAT " us\n",
+           sse_transport == SSE_TRANSPORT_MAINLOOP ? "mainloop" : "thread",
+           dispatch_stats.count,
+           dispatch_stats.count > 0 ? (gdouble)dispatch_stats.total_us / dispatch_stats.count : 0.0,
+           dispatch_stats.max_us);
+
+    const LyricsQueueStats *queue_stats = &osd->update_queue.stats;
+    printf("📊 [队列统计] 入队: %" G_GUINT64_FORMAT ", 同歌合并: %" G_GUINT64_FORMAT ", 重复丢弃: %" G_GUINT64_FORMAT
+           ", 溢出: %" G_GUINT64_FORMAT " (丢弃 %" G_GUINT64_FORMAT "), 过时跳过: %" G_GUINT64_FORMAT
+           ", 唤醒: %" G_GUINT64_FORMAT ", 处理: %" G_GUINT64_FORMAT "\n",
+           queue_stats->pushed, queue_stats->coalesced, queue_stats->duplicates,
+           queue_stats->overflows, queue_stats->dropped, queue_stats->superseded,
+           queue_stats->wakeups, queue_stats->drains);
+
+    printf("📊 [时间轴统计] 本地换行: %" G_GUINT64_FORMAT ", 同步参考: %" G_GUINT64_FORMAT
+           ", 平均换行延迟: %.1f us\n",
+           timeline_state.local_switches, timeline_state.sync_hints,
+           timeline_state.local_switches > 0 ? (gdouble)timeline_state.total_late_us / timeline_state.local_switches : 0.0);
+
+    const LyricsTimelineCacheStats *timeline_cache_stats = &timeline_cache.stats;
+    printf("📊 [时间轴缓存] 查找: %" G_GUINT64_FORMAT ", 内存命中: %" G_GUINT64_FORMAT ", 文件命中: %" G_GUINT64_FORMAT
+           ", 解析: %" G_GUINT64_FORMAT ", 淘汰: %" G_GUINT64_FORMAT ", 无效记录: %" G_GUINT64_FORMAT "\n",
+           timeline_cache_stats->lookups, timeline_cache_stats->hits, timeline_cache_stats->disk_hits,
+           timeline_cache_stats->misses, timeline_cache_stats->evictions, timeline_cache_stats->rejected);
+
+    const KaraokeStats *karaoke_stats = &krc_progress_state.line.stats;
+    printf("📊 [逐字统计] 行: %" G_GUINT64_FORMAT ", 刷新: %" G_GUINT64_FORMAT ", 无变化跳过: %" G_GUINT64_FORMAT
+           ", 缓冲区扩容: %" G_GUINT64_FORMAT ", 定时唤醒: %" G_GUINT64_FORMAT ", 平均唤醒延迟: %.1f us\n",
+           karaoke_stats->lines, karaoke_stats->renders, karaoke_stats->unchanged, karaoke_stats->growths,
+           krc_progress_state.wakeups,
+           krc_progress_state.wakeups > 0 ? (gdouble)krc_progress_state.total_late_us / krc_progress_state.wakeups : 0.0);
+
+    if (osd->wipe) {
+        const KaraokeWipeStats *wipe_stats = &osd->wipe->stats;
+        printf("📊 [擦除统计] 行: %" G_GUINT64_FORMAT ", 字形定位: %" G_GUINT64_FORMAT ", 帧: %" G_GUINT64_FORMAT
+               ", 绘制: %" G_GUINT64_FORMAT ", 位置未变: %" G_GUINT64_FORMAT "\n",
+               wipe_stats->lines, wipe_stats->layouts, wipe_stats->ticks, wipe_stats->draws, wipe_stats->idle_ticks);
+        printf("📊 [重绘区域] 重绘像素: %" G_GUINT64_FORMAT ", 整控件重绘需要: %" G_GUINT64_FORMAT " (%.1f%%)\n",
+               wipe_stats->damage_pixels, wipe_stats->full_pixels,
+               wipe_stats->full_pixels > 0 ? 100.0 * wipe_stats->damage_pixels / wipe_stats->full_pixels : 0.0);
+        printf("📊 [预渲染] 预先栅格化: %" G_GUINT64_FORMAT ", 换行直接交换: %" G_GUINT64_FORMAT
+               ", 绘制时栅格化: %" G_GUINT64_FORMAT ", 换行到绘制平均: %.1f us, 最大: %" G_GINT64_FORMAT " us\n",
+               wipe_stats->prepared, wipe_stats->swaps, wipe_stats->rasters,
+               wipe_stats->switches > 0 ? (gdouble)wipe_stats->total_switch_us / wipe_stats->switches : 0.0,
+               wipe_stats->max_switch_us);
+
+        const LyricsLayoutCacheStats *cache_stats = &osd->wipe->layouts.stats;
+        printf("📊 [布局缓存] 查找: %" G_GUINT64_FORMAT ", 命中率: %.1f%%, 字体不符: %" G_GUINT64_FORMAT
+               ", 淘汰: %" G_GUINT64_FORMAT ", 失效: %" G_GUINT64_FORMAT "\n",
+               cache_stats->lookups,
+               cache_stats->lookups > 0 ? 100.0 * cache_stats->hits / cache_stats->lookups : 0.0,
+               cache_stats->stale, cache_stats->evictions, cache_stats->invalidations);
+    }
+
+    const KaraokeWipeStats *render_stats = osd->wipe ? &osd->wipe->stats : NULL;
+    printf("📊 [文字渲染] 样式: %s, 擦除控件每帧: %.1f us (最大 %" G_GINT64_FORMAT " us, 栅格化 %.1f us/行)"
+           ", 标签每帧: %.1f us (最大 %" G_GINT64_FORMAT " us)\n",
+           outline_text ? "outline" : "shadow",
+           render_stats && render_stats->draws > 0 ? (gdouble)render_stats->total_draw_us / render_stats->draws : 0.0,
+           render_stats ? render_stats->max_draw_us : 0,
+           render_stats && render_stats->rasters + render_stats->prepared > 0 ?
+               (gdouble)render_stats->total_raster_us / (render_stats->rasters + render_stats->prepared) : 0.0,
+           osd->label_draws > 0 ? (gdouble)osd->label_draw_us / osd->label_draws : 0.0,
+           osd->label_draw_max_us);
+
+    // 附加窗口只有绘制开销，解析和网络统计只有一份
+    for (guint i = 1; i < osd_windows->len; i++) {
+        const OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+        const KaraokeWipeStats *window_stats = instance->wipe ? &instance->wipe->stats : NULL;
+        printf("📊 [多窗口] 窗口 %u: 擦除绘制: %" G_GUINT64_FORMAT " (每帧 %.1f us), 标签绘制: %" G_GUINT64_FORMAT
+               " (每帧 %.1f us)\n", i,
+               window_stats ? window_stats->draws : 0,
+               window_stats && window_stats->draws > 0 ? (gdouble)window_stats->total_draw_us / window_stats->draws : 0.0,
+               instance->label_draws,
+               instance->label_draws > 0 ? (gdouble)instance->label_draw_us / instance->label_draws : 0.0);
+    }
+
+    printf("📊 [拖动统计] 指针事件: %" G_GUINT64_FORMAT ", 移动或调整: %" G_GUINT64_FORMAT "\n",
+           osd->pointer_motions, osd->pointer_frames);
+
+    const PlaybackClockStats *clock_stats = &playback_clock.stats;
+    guint64 slews = clock_stats->observations - clock_stats->jumps;
+    printf("📊 [时钟统计] 校准: %" G_GUINT64_FORMAT ", 跳转: %" G_GUINT64_FORMAT
+           ", 平均同步误差: %.1f ms, 最大: %.1f ms, 最近: %.1f ms\n",
+           clock_stats->observations, clock_stats->jumps,
+           slews > 0 ? clock_stats->total_error_ms / slews : 0.0,
+           clock_stats->max_error_ms, clock_stats->last_error_ms);
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        printf("📊 [分发统计] 上下文切换: 自愿 %ld, 非自愿 %ld\n", usage.ru_nvcsw, usage.ru_nivcsw);
+    }
+
+    // 当前仍在空闲时把这一段也计入
+    gint64 now = g_get_monotonic_time();
+    gint64 uptime_us = now - power_state.start_us;
+    glong wakeups = process_wakeups();
+    gint64 idle_us = power_state.idle_us;
+    glong idle_wakeups = power_state.idle_wakeups;
+    if (power_state.reasons) {
+        idle_us += now - power_state.idle_since_us;
+        idle_wakeups += wakeups - power_state.idle_since_wakeups;
+    }
+    printf("📊 [省电统计] 每秒唤醒: %.2f, 空闲: %.1f s (每秒唤醒 %.2f)\n",
+           uptime_us > 0 ? (wakeups - power_state.start_wakeups) * 1e6 / uptime_us : 0.0,
+           idle_us / 1e6, idle_us > 0 ? idle_wakeups * 1e6 / idle_us : 0.0);
+}
+
+// 启动SSE连接
+static void start_sse_connection(OSDLyrics *osd) {
+    if (!osd->sse_urls) {
+        return;
+    }
+
+    // 线程模式在后台线程中运行连接状态机，主循环模式由GTK主循环驱动
+    playback_clock_init(&playback_clock);
+    if (!lyrics_queue_init(&osd->update_queue, LYRICS_QUEUE_CAPACITY, display_sse_lyrics,
+                           apply_playback_state, osd)) {
+        return;
     }
+    osd->sse_client = sse_client_new((const gchar * const *)osd->sse_urls, &reconnect_policy, sse_transport, sse_apply_lyrics, osd);
+    sse_client_set_document_func(osd->sse_client, sse_apply_document);
+    sse_client_set_playback_func(osd->sse_client, sse_apply_playback);
+    sse_client_set_timeline_func(osd->sse_client, sse_apply_timeline);
+    sse_client_set_compact_encoding(osd->sse_client, compact_encoding);
+    sse_client_start(osd->sse_client);
+}
+
+// 设置SSE传输方式
+void osd_lyrics_set_sse_main_loop(gboolean enabled) {
+    sse_transport = enabled ? SSE_TRANSPORT_MAINLOOP : SSE_TRANSPORT_THREAD;
+}
 
-    printf("🔴 [OSD歌词] SSE连接线程退出\n");
-    return NULL;
+// 设置是否协商紧凑编码
+void osd_lyrics_set_compact_encoding(gboolean enabled) {
+    compact_encoding = enabled;
+}
+
+// 设置逐字高亮方式
+void osd_lyrics_set_wipe_render(gboolean enabled) {
+    wipe_render = enabled;
+}
+
+// 设置歌词文字样式
+void osd_lyrics_set_outline_text(gboolean enabled) {
+    outline_text = enabled;
+}
+
+// 设置重连退避策略
+void osd_lyrics_set_reconnect_policy(guint initial_ms, guint max_ms, gdouble jitter) {
+    reconnect_policy.initial_ms = MAX(initial_ms, 1);
+    reconnect_policy.max_ms = MAX(max_ms, reconnect_policy.initial_ms);
+    reconnect_policy.jitter = CLAMP(jitter, 0.0, 1.0);
 }
 
 // 获取配置目录路径
@@ -1545,9 +2435,23 @@ static gchar* get_config_file_path(void) {
     return config_file;
 }
 
+// 获取时间轴缓存文件路径
+static gchar* get_timeline_cache_path(void) {
+    gchar *config_dir = get_config_dir();
+    if (!config_dir) {
+        return NULL;
+    }
+
+    gchar *cache_file = g_build_filename(config_dir, LYRICS_TIMELINE_CACHE_FILE, NULL);
+    g_free(config_dir);
+
+    return cache_file;
+}
+
 // 保存配置到文件
 static void save_config(OSDLyrics *osd) {
-    if (!osd || !osd->initialized) {
+    // 附加窗口的设置只在内存中
+    if (!osd || !osd->initialized || !osd->persistent) {
         return;
     }
 
@@ -1754,6 +2658,7 @@ static void clear_krc_state(void) {
 
     // 先标记为非活动状态，防止定时器回调继续执行
     krc_progress_state.is_active = FALSE;
+    krc_progress_state.generation++;
 
     // 停止定时器
     if (krc_progress_state.timer_id > 0) {
@@ -1765,47 +2670,82 @@ static void clear_krc_state(void) {
         krc_progress_state.timer_id = 0;
     }
 
-    // 清理KRC相关的全局状态
-    if (krc_progress_state.current_krc_line) {
-        g_free(krc_progress_state.current_krc_line);
-        krc_progress_state.current_krc_line = NULL;
-        printf("🔄 [KRC清理] 已清理当前KRC歌词行\n");
-    }
-
     krc_progress_state.line_start_time = 0;
+    krc_progress_state.line_position_ms = -1;
+    set_wipe_visible(FALSE);
 
     printf("✅ [KRC清理] KRC状态清理完成\n");
 }
 
-// 启动KRC渐进式播放显示
-static void osd_lyrics_start_krc_progressive_display(const char *krc_line) {
-    if (!osd || !osd->initialized || !krc_line) return;
+// 开始渐进式播放当前行（krc_progress_state.line 已设置好）
+static void krc_progress_begin(gint64 line_start_time, gint64 line_position_ms) {
+    // 有行开始时间时由播放时钟驱动（支持暂停和变速）；否则以收到歌词的时间为起点
+    krc_progress_state.line_start_time = line_start_time;
+    krc_progress_state.line_position_ms = line_position_ms;
+    krc_progress_state.is_active = TRUE;
+    krc_progress_state.generation++;
 
-    printf("🎤 [KRC渐进] 启动渐进式播放: %s\n", krc_line);
+    // 立即显示当前进度，并在下一个音节开始时唤醒（擦除控件由帧时钟驱动）
+    set_wipe_visible(TRUE);
+    krc_progress_sync();
 
-    // 停止之前的定时器
-    if (krc_progress_state.timer_id > 0) {
-        g_source_remove(krc_progress_state.timer_id);
-        krc_progress_state.timer_id = 0;
+    if (!wipe_render) {
+        printf("🎤 [KRC渐进] 按音节开始时间唤醒，定时器ID: %u\n", krc_progress_state.timer_id);
     }
+}
 
-    // 清理之前的数据
-    if (krc_progress_state.current_krc_line) {
-        g_free(krc_progress_state.current_krc_line);
+// 用已解析的音节启动渐进式播放（整首歌词时间轴）
+static void start_karaoke_line(const gchar *text, gsize text_len, const LyricsSyllable *syllables,
+                               guint n_syllables, gint64 line_start_time, gint64 line_position_ms) {
+    if (!osd || !osd->initialized) return;
+
+    // 当前歌词记录为整行文本（标签方式下为转义后的文本）
+    // 音节只有一份，擦除控件各自按自己的字体计算字形位置
+    g_free(osd->current_lyrics);
+    if (wipe_render) {
+        for (guint i = 0; i < osd_windows->len; i++) {
+            OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+            karaoke_wipe_set_line(instance->wipe, text, text_len, syllables, n_syllables);
+        }
+        osd->current_lyrics = g_strndup(text, text_len);
+        if (!krc_progress_state.wipe_syllables) {
+            krc_progress_state.wipe_syllables = g_array_new(FALSE, FALSE, sizeof(LyricsSyllable));
+        }
+        g_array_set_size(krc_progress_state.wipe_syllables, 0);
+        g_array_append_vals(krc_progress_state.wipe_syllables, syllables, n_syllables);
+    } else {
+        for (guint i = 0; i < osd_windows->len; i++) {
+            OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+            instance->karaoke_played = -1;
+        }
+        if (!krc_progress_state.line.escaped) {
+            karaoke_line_init(&krc_progress_state.line);
+        }
+        karaoke_line_set(&krc_progress_state.line, text, text_len, syllables, n_syllables);
+        osd->current_lyrics = g_strndup(krc_progress_state.line.escaped->str, krc_progress_state.line.escaped->len);
     }
+    printf("🎤 [KRC渐进] 启动渐进式播放: %.*s (%u 个音节)\n", (int)text_len, text, n_syllables);
+    krc_progress_begin(line_start_time, line_position_ms);
+}
 
-    // 保存当前KRC行
-    krc_progress_state.current_krc_line = g_strdup(krc_line);
-    krc_progress_state.line_start_time = g_get_monotonic_time() / 1000; // 转换为毫秒
-    krc_progress_state.is_active = TRUE;
-
-    // 立即显示第一次（全部未播放状态）
-    osd_lyrics_update_krc_progress(NULL);
+// 启动KRC渐进式播放显示，原始KRC行只在这里解析一次
+static void osd_lyrics_start_krc_progressive_display(const char *krc_line, gint64 line_start_time,
+                                                     gint64 line_position_ms) {
+    if (!osd || !osd->initialized || !krc_line) return;
 
-    // 启动定时器，每100ms更新一次
-    krc_progress_state.timer_id = g_timeout_add(100, osd_lyrics_update_krc_progress, NULL);
+    LyricsTimeline *parsed = lyrics_timeline_parse(NULL, "krc", krc_line, strlen(krc_line));
+    if (!parsed) {
+        printf("⚠️ [KRC渐进] 无法解析KRC行，按纯文本显示\n");
+        clear_krc_state();
+        osd_lyrics_set_text_safe(krc_line);
+        return;
+    }
 
-    printf("🎤 [KRC渐进] 定时器已启动，ID: %u\n", krc_progress_state.timer_id);
+    const LyricsLine *line = &parsed->lines[0];
+    start_karaoke_line(lyrics_timeline_line_text(parsed, 0), line->text_length,
+                       parsed->syllables + line->first_syllable, line->syllable_count,
+                       line_start_time, line_position_ms);
+    lyrics_timeline_free(parsed);
 }
 
 // 处理原始KRC格式歌词行
@@ -1849,234 +2789,175 @@ static void osd_lyrics_process_krc_line(const char *krc_line) {
     g_free(text_content);
 }
 
-// KRC进度更新函数（定时器回调）
-static gboolean osd_lyrics_update_krc_progress(gpointer data) {
-    // 检查全局状态和OSD对象有效性
-    if (!krc_progress_state.is_active || !krc_progress_state.current_krc_line || !osd || !osd->initialized) {
-        printf("🔄 [KRC进度] 状态无效，停止定时器\n");
-        krc_progress_state.timer_id = 0;
-        return FALSE; // 停止定时器
+// 当前行内进度（毫秒）
+static gint64 krc_progress_position(gint64 now) {
+    if (krc_progress_state.line_position_ms >= 0 && playback_clock.valid) {
+        return playback_clock_position(&playback_clock, now) - krc_progress_state.line_position_ms;
     }
+    return now - krc_progress_state.line_start_time;
+}
 
-    // 计算当前播放进度
-    gint64 current_time = g_get_monotonic_time() / 1000; // 转换为毫秒
-    gint64 progress_ms = current_time - krc_progress_state.line_start_time;
-
-    // printf("🎤 [KRC渐进] 更新进度: %ldms\n", progress_ms);
-
-    const char *krc_line = krc_progress_state.current_krc_line;
-    const char *ptr = krc_line;
+// 擦除控件的进度回调，now 为帧时间
+static gint64 krc_wipe_progress(gint64 now, gpointer user_data) {
+    (void)user_data;
+    return krc_progress_position(now);
+}
 
-    // 跳过行时间戳 [171960,5040]
-    if (*ptr == '[') {
-        while (*ptr && *ptr != ']') ptr++;
-        if (*ptr == ']') ptr++;
+// 在一个窗口的擦除控件和歌词标签之间切换
+static void window_set_wipe_visible(OSDLyrics *instance, gboolean visible) {
+    if (!instance->wipe) {
+        return;
     }
+    if (visible) {
+        gtk_widget_hide(instance->label);
+        gtk_widget_show(instance->wipe->widget);
+    } else {
+        karaoke_wipe_stop(instance->wipe);
+        gtk_widget_hide(instance->wipe->widget);
+        gtk_widget_show(instance->label);
+    }
+}
 
-    // 构建带Pango标记的渐进式高亮文本
-    GString *result_text = g_string_new("");
-    long current_char_time = 0;
-    gboolean in_played_section = TRUE;
-    gboolean color_section_open = FALSE;
-
-    while (*ptr) {
-        if (*ptr == '<') {
-            // 解析字符时间戳 <0,240,0>
-            ptr++; // 跳过 '<'
-            const char *time_start = ptr;
-
-            // 找到第一个逗号（字符开始时间）
-            while (*ptr && *ptr != ',') ptr++;
-            if (*ptr == ',') {
-                char *time_str = g_strndup(time_start, ptr - time_start);
-                current_char_time = strtol(time_str, NULL, 10);
-                g_free(time_str);
-            }
-
-            // 跳过到 '>'
-            while (*ptr && *ptr != '>') ptr++;
-            if (*ptr == '>') ptr++;
+// 所有窗口一起切换
+static void set_wipe_visible(gboolean visible) {
+    for (guint i = 0; osd_windows && i < osd_windows->len; i++) {
+        window_set_wipe_visible(g_ptr_array_index(osd_windows, i), visible);
+    }
+}
 
-            // 检查当前字符是否应该高亮
-            gboolean should_be_played = (current_char_time <= progress_ms);
+// 按当前进度刷新显示，并把下一次唤醒安排在下一个音节的开始时间
+// 只做二分查找和拼接预先转义好的文本，分界没有变化时不更新标签，稳定状态下没有堆分配；
+// 整行唱完或暂停时不再安排唤醒，恢复播放、跳转或变速时由播放时钟更新处重新调用
+static void krc_progress_sync(void) {
+    if (krc_progress_state.timer_id > 0) {
+        g_source_remove(krc_progress_state.timer_id);
+        krc_progress_state.timer_id = 0;
+    }
+    if (!krc_progress_state.is_active || !osd || !osd->initialized) {
+        return;
+    }
 
-            // 如果播放状态发生变化，需要切换颜色标记
-            if (should_be_played != in_played_section) {
-                // 关闭之前的颜色标记
-                if (color_section_open) {
-                    g_string_append(result_text, "</span>");
-                    color_section_open = FALSE;
-                }
+    // 擦除控件每帧自己取进度，这里只更新颜色并按暂停状态启停tick；空闲时不启动tick
+    if (wipe_render) {
+        gboolean clock_driven = krc_progress_state.line_position_ms >= 0 && playback_clock.valid;
+        for (guint i = 0; i < osd_windows->len; i++) {
+            OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+            karaoke_wipe_set_played_color(instance->wipe, &instance->text_color);
+            karaoke_wipe_sync(instance->wipe, !(clock_driven && playback_clock.paused) && !power_state.reasons);
+        }
+        return;
+    }
 
-                // 开启新的颜色标记
-                if (should_be_played) {
-                    // 已播放部分：使用用户选择的颜色
-                    gchar *user_color = g_strdup_printf("#%02x%02x%02x", 
-                        (int)(osd->text_color.red * 255),
-                        (int)(osd->text_color.green * 255),
-                        (int)(osd->text_color.blue * 255));
-                    g_string_append_printf(result_text, "<span foreground=\"%s\">", user_color);
-                    g_free(user_color);
-                } else {
-                    // 未播放部分：灰色
-                    g_string_append(result_text, "<span foreground=\"#666666\">");
-                }
-                color_section_open = TRUE;
-                in_played_section = should_be_played;
-            }
+    gint64 current_time = g_get_monotonic_time() / 1000; // 转换为毫秒
+    gint64 progress_ms = krc_progress_position(current_time);
+    KaraokeLine *line = &krc_progress_state.line;
+    guint next = karaoke_line_played_count(line, progress_ms);
+
+    // 每个窗口的已唱部分使用各自的颜色，未播放部分为灰色；分界没有变化的窗口不更新标签
+    for (guint i = 0; i < osd_windows->len; i++) {
+        OSDLyrics *instance = g_ptr_array_index(osd_windows, i);
+        if (instance->karaoke_played == (gint)next) {
+            continue;
+        }
 
-            // 处理时间戳后面的字符（如果存在）
-            if (*ptr) {
-                // 如果还没有开启颜色标记，开启第一个
-                if (!color_section_open) {
-                    if (in_played_section) {
-                        // 已播放部分：使用用户选择的颜色
-                        gchar *user_color = g_strdup_printf("#%02x%02x%02x", 
-                            (int)(osd->text_color.red * 255),
-                            (int)(osd->text_color.green * 255),
-                            (int)(osd->text_color.blue * 255));
-                        g_string_append_printf(result_text, "<span foreground=\"%s\">", user_color);
-                        g_free(user_color);
-                    } else {
-                        g_string_append(result_text, "<span foreground=\"#666666\">");
-                    }
-                    color_section_open = TRUE;
-                }
+        gchar played_color[8];
+        g_snprintf(played_color, sizeof(played_color), "#%02x%02x%02x",
+                   (int)(instance->text_color.red * 255),
+                   (int)(instance->text_color.green * 255),
+                   (int)(instance->text_color.blue * 255));
 
-                // 添加字符（需要转义特殊字符）
-                if (*ptr == '<') {
-                    g_string_append(result_text, "&lt;");
-                } else if (*ptr == '>') {
-                    g_string_append(result_text, "&gt;");
-                } else if (*ptr == '&') {
-                    g_string_append(result_text, "&amp;");
-                } else {
-                    // 处理UTF-8字符：对于多字节字符，需要完整读取
-                    if ((*ptr & 0x80) == 0) {
-                        // ASCII字符（单字节）
-                        g_string_append_c(result_text, *ptr);
-                    } else {
-                        // UTF-8多字节字符，需要读取完整字符
-                        const char *char_start = ptr;
-                        int char_len = 1;
-
-                        // 计算UTF-8字符长度
-                        if ((*ptr & 0xE0) == 0xC0) char_len = 2;      // 110xxxxx
-                        else if ((*ptr & 0xF0) == 0xE0) char_len = 3; // 1110xxxx
-                        else if ((*ptr & 0xF8) == 0xF0) char_len = 4; // 11110xxx
-
-                        // 添加完整的UTF-8字符
-                        char *utf8_char = g_strndup(char_start, char_len);
-                        g_string_append(result_text, utf8_char);
-                        g_free(utf8_char);
-
-                        // 跳过多字节字符的其余字节
-                        ptr += char_len - 1;
-                    }
-                }
-                ptr++;
-            }
+        // 文本已逐段转义，无需再校验标记；与上一次输出相同（同色的另一个窗口刚渲染过）时直接复用
+        const gchar *markup = karaoke_line_render(line, progress_ms, played_color);
+        gtk_label_set_markup(GTK_LABEL(instance->label), markup ? markup : line->markup->str);
+        instance->karaoke_played = (gint)next;
+    }
 
-        } else {
-            // 如果还没有开启颜色标记，开启第一个
-            if (!color_section_open) {
-                if (in_played_section) {
-                    // 已播放部分：使用用户选择的颜色
-                    gchar *user_color = g_strdup_printf("#%02x%02x%02x", 
-                        (int)(osd->text_color.red * 255),
-                        (int)(osd->text_color.green * 255),
-                        (int)(osd->text_color.blue * 255));
-                    g_string_append_printf(result_text, "<span foreground=\"%s\">", user_color);
-                    g_free(user_color);
-                } else {
-                    g_string_append(result_text, "<span foreground=\"#666666\">");
-                }
-                color_section_open = TRUE;
-            }
+    if (next >= line->n_syllables) {
+        return; // 整行已唱完
+    }
 
-            // 添加字符（需要转义特殊字符）
-            if (*ptr == '<') {
-                g_string_append(result_text, "&lt;");
-            } else if (*ptr == '>') {
-                g_string_append(result_text, "&gt;");
-            } else if (*ptr == '&') {
-                g_string_append(result_text, "&amp;");
-            } else {
-                // 处理UTF-8字符：对于多字节字符，需要完整读取
-                if ((*ptr & 0x80) == 0) {
-                    // ASCII字符（单字节）
-                    g_string_append_c(result_text, *ptr);
-                } else {
-                    // UTF-8多字节字符，需要读取完整字符
-                    const char *char_start = ptr;
-                    int char_len = 1;
-
-                    // 计算UTF-8字符长度
-                    if ((*ptr & 0xE0) == 0xC0) char_len = 2;      // 110xxxxx
-                    else if ((*ptr & 0xF0) == 0xE0) char_len = 3; // 1110xxxx
-                    else if ((*ptr & 0xF8) == 0xF0) char_len = 4; // 11110xxx
-
-                    // 添加完整的UTF-8字符
-                    char *utf8_char = g_strndup(char_start, char_len);
-                    g_string_append(result_text, utf8_char);
-                    g_free(utf8_char);
-
-                    // 跳过多字节字符的其余字节
-                    ptr += char_len - 1;
-                }
-            }
-            ptr++;
+    gint64 next_start_ms = line->syllables[next].start_ms;
+    gint64 delay_ms = next_start_ms - progress_ms;
+    if (krc_progress_state.line_position_ms >= 0 && playback_clock.valid) {
+        delay_ms = playback_clock_time_until(&playback_clock, krc_progress_state.line_position_ms + next_start_ms,
+                                             current_time);
+        if (delay_ms < 0) {
+            return; // 暂停
         }
     }
 
-    // 关闭最后的颜色标记
-    if (color_section_open) {
-        g_string_append(result_text, "</span>");
+    if (power_state.reasons) {
+        return; // 空闲时只刷新当前进度，恢复时重新同步
     }
 
-    char *final_text = g_string_free(result_text, FALSE);
-
-    // 使用Pango标记显示文本
-    osd_lyrics_set_markup_text_safe(final_text);
+    krc_progress_state.scheduled_us = g_get_monotonic_time() + delay_ms * 1000;
+    krc_progress_state.timer_id = g_timeout_add((guint)delay_ms, osd_lyrics_update_krc_progress,
+                                                GUINT_TO_POINTER(krc_progress_state.generation));
+}
 
-    g_free(final_text);
+// 逐字唤醒定时器，data为启动时的代数
+static gboolean osd_lyrics_update_krc_progress(gpointer data) {
+    // 已被新的歌词行或清理取代
+    if (GPOINTER_TO_UINT(data) != krc_progress_state.generation) {
+        return G_SOURCE_REMOVE;
+    }
 
-    return TRUE; // 继续定时器
+    krc_progress_state.timer_id = 0;
+    krc_progress_state.wakeups++;
+    krc_progress_state.total_late_us += g_get_monotonic_time() - krc_progress_state.scheduled_us;
+    krc_progress_sync();
+    return G_SOURCE_REMOVE;
 }
 
 // 处理原始LRC格式歌词行
-static void osd_lyrics_process_lrc_line(const char *lrc_line) {
+static void osd_lyrics_process_lrc_line(const char *lrc_line, gint64 received_time, gint64 line_start_ms) {
     if (!osd || !osd->initialized || !lrc_line) return;
 
+#ifdef DEBUG
     printf("📝 [LRC处理] 原始行: %s\n", lrc_line);
+#endif
 
     // 确保清理KRC状态（防止格式切换时的状态残留）
     clear_krc_state();
 
-    // 提取文本内容（移除时间戳）
-    const char *text_start = strchr(lrc_line, ']');
-    if (text_start) {
-        text_start++; // 跳过 ']'
-        // 跳过可能的空格
+    // 与整首歌词使用同一解析器：重复的时间标签、增强LRC的逐字标签
+    LyricsTimeline *parsed = lyrics_timeline_parse(NULL, "lrc", lrc_line, strlen(lrc_line));
+    if (!parsed) {
+        // 没有时间标签，去掉 [ti:...] 等标签后显示
+        const char *text_start = lrc_line;
+        while (*text_start == '[' && strchr(text_start, ']')) {
+            text_start = strchr(text_start, ']') + 1;
+        }
         while (*text_start == ' ' || *text_start == '\t') text_start++;
+        osd_lyrics_set_text_safe(text_start);
+        return;
+    }
 
-        // 移除可能的换行符
-        char *text_content = g_strdup(text_start);
-        char *newline = strchr(text_content, '\r');
-        if (newline) *newline = '\0';
-        newline = strchr(text_content, '\n');
-        if (newline) *newline = '\0';
-
-        printf("📝 [LRC处理] 提取文本: %s\n", text_content);
-
-        // 显示文本
-        osd_lyrics_set_text_safe(text_content);
+    // 重复的时间标签解析为多行相同文本，使用同步参考选定的那一个
+    guint index = parsed->n_lines - 1;
+    for (guint i = 0; i < parsed->n_lines; i++) {
+        if (parsed->lines[i].start_ms == line_start_ms) {
+            index = i;
+            break;
+        }
+    }
 
-        g_free(text_content);
+    const LyricsLine *line = &parsed->lines[index];
+    const gchar *text = lyrics_timeline_line_text(parsed, index);
+    if (line->syllable_count > 0) {
+        // 逐字LRC与KRC使用同一套逐字高亮
+#ifdef DEBUG
+        printf("🎤 [LRC处理] 逐字LRC，启动渐进式播放\n");
+#endif
+        start_karaoke_line(text, line->text_length, parsed->syllables + line->first_syllable,
+                           line->syllable_count, received_time, line->start_ms);
     } else {
-        // 没有找到时间戳，直接显示原文
-        osd_lyrics_set_text_safe(lrc_line);
+#ifdef DEBUG
+        printf("📝 [LRC处理] 提取文本: %s\n", text);
+#endif
+        osd_lyrics_set_text_safe(text);
     }
+    lyrics_timeline_free(parsed);
 }
 
 // 清理资源
@@ -2088,45 +2969,60 @@ void osd_lyrics_cleanup(void) {
         osd->initialized = FALSE;
     }
 
-    // 清理KRC状态（包括定时器）
+    // 停止SSE连接（中断传输并唤醒退避等待）
+    if (osd && osd->sse_client) {
+        print_dispatch_stats();
+        sse_client_stop(osd->sse_client);
+        osd->sse_client = NULL;
+        lyrics_queue_clear(&osd->update_queue);
+    }
+
+    // 清理整首歌词时间轴和KRC状态（包括定时器）
+    timeline_reset();
+    g_free(timeline_state.anchor_song);
+    timeline_state.anchor_song = NULL;
+    if (!lyrics_timeline_cache_save(&timeline_cache)) {
+        printf("⚠️ [时间轴缓存] 无法写入缓存文件\n");
+    } else if (timeline_cache.stats.saved > 0) {
+        printf("💾 [时间轴缓存] 已保存 %" G_GUINT64_FORMAT " 首歌词, 超出大小限制丢弃 %" G_GUINT64_FORMAT "\n",
+               timeline_cache.stats.saved, timeline_cache.stats.dropped);
+    }
+    lyrics_timeline_cache_clear(&timeline_cache);
+    power_cleanup();
     clear_krc_state();
+    if (krc_progress_state.line.escaped) {
+        karaoke_line_clear(&krc_progress_state.line);
+    }
+    if (krc_progress_state.wipe_syllables) {
+        g_array_free(krc_progress_state.wipe_syllables, TRUE);
+        krc_progress_state.wipe_syllables = NULL;
+    }
 
     if (osd) {
         printf("🧹 [清理] 清理OSD对象资源\n");
 
-        // 清理UI定时器
-        if (osd->hide_timer_id > 0) {
-            if (g_source_remove(osd->hide_timer_id)) {
-                printf("🧹 [清理] 已停止隐藏定时器 (ID: %u)\n", osd->hide_timer_id);
-            }
-            osd->hide_timer_id = 0;
-        }
-        if (osd->unlock_timer_id > 0) {
-            if (g_source_remove(osd->unlock_timer_id)) {
-                printf("🧹 [清理] 已停止解锁定时器 (ID: %u)\n", osd->unlock_timer_id);
-            }
-            osd->unlock_timer_id = 0;
+        // 先关闭附加窗口
+        while (osd_windows->len > 1) {
+            osd_window_free(g_ptr_array_index(osd_windows, osd_windows->len - 1));
         }
 
-        // 清理字符串资源
-        if (osd->current_lyrics) {
-            g_free(osd->current_lyrics);
-            osd->current_lyrics = NULL;
-        }
-        if (osd->sse_url) {
-            g_free(osd->sse_url);
-            osd->sse_url = NULL;
+        if (osd->sse_urls) {
+            g_strfreev(osd->sse_urls);
+            osd->sse_urls = NULL;
         }
 
-        // 销毁GTK窗口
-        if (osd->window) {
-            gtk_widget_destroy(osd->window);
-            osd->window = NULL;
+        if (osd->css_provider) {
+            gtk_style_context_remove_provider_for_screen(gdk_screen_get_default(),
+                                                         GTK_STYLE_PROVIDER(osd->css_provider));
+            g_object_unref(osd->css_provider);
+            osd->css_provider = NULL;
         }
 
-        // 释放OSD结构体
-        g_free(osd);
+        // 销毁主窗口并释放OSD结构体
+        osd_window_free(osd);
         osd = NULL;
+        g_ptr_array_free(osd_windows, TRUE);
+        osd_windows = NULL;
 
         printf("🧹 [清理] OSD对象资源清理完成\n");
     }
@@ -0,0 +1,271 @@
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <glib-unix.h>
+#include "osd_lyrics_queue.h"
+
+static void lyrics_update_free(LyricsUpdate *update) {
+    if (!update) {
+        return;
+    }
+    g_free(update->song);
+    g_free(update->text);
+    g_free(update->format);
+    g_free(update);
+}
+
+// 复制字符串到可复用的缓冲区，容量足够时不重新分配
+static void copy_to_buffer(gchar **buffer, gsize *cap, const gchar *str, gsize len) {
+    if (len + 1 > *cap) {
+        *cap = MAX(len + 1, 64);
+        g_free(*buffer);
+        *buffer = g_malloc(*cap);
+    }
+    memcpy(*buffer, str, len);
+    (*buffer)[len] = '\0';
+}
+
+// 取走信箱中的内容
+static gpointer take_mailbox(gpointer *mailbox) {
+    gpointer item;
+    do {
+        item = g_atomic_pointer_get(mailbox);
+    } while (item && !g_atomic_pointer_compare_and_exchange(mailbox, item, NULL));
+    return item;
+}
+
+// 放入信箱，返回被替换的未取走内容
+static gpointer replace_mailbox(gpointer *mailbox, gpointer item) {
+    gpointer old;
+    do {
+        old = g_atomic_pointer_get(mailbox);
+    } while (!g_atomic_pointer_compare_and_exchange(mailbox, old, item));
+    return old;
+}
+
+// 交换中间槽位序号，返回原来的值
+static gint exchange_index(gint *index, gint value) {
+    gint old;
+    do {
+        old = g_atomic_int_get(index);
+    } while (!g_atomic_int_compare_and_exchange(index, old, value));
+    return old;
+}
+
+// 唤醒主循环，只有在没有未处理的唤醒时才写eventfd
+static void lyrics_queue_wakeup(LyricsQueue *queue) {
+    if (g_atomic_int_compare_and_exchange(&queue->wakeup_pending, 0, 1)) {
+        guint64 value = 1;
+        if (write(queue->wakeup_fd, &value, sizeof(value)) < 0) {
+            perror("⚠️ [歌词队列] 写入eventfd失败");
+        }
+        queue->stats.wakeups++;
+    }
+}
+
+// 唤醒fd可读：取出所有待显示行，只显示最新的一行
+static gboolean lyrics_queue_dispatch(gint fd, GIOCondition condition, gpointer data) {
+    LyricsQueue *queue = (LyricsQueue *)data;
+    guint64 value;
+    (void)condition;
+
+    // 清空eventfd计数；失败（EAGAIN）时仍然检查环形缓冲区
+    ssize_t ignored = read(fd, &value, sizeof(value));
+    (void)ignored;
+    // 先清除标记再读取，之后入队的行会重新唤醒
+    g_atomic_int_set(&queue->wakeup_pending, 0);
+
+    // 播放状态先于歌词行应用，行的显示使用最新的时钟
+    // 只有消费者会清除新状态标记，检查之后交换出来的一定是生产者最新写完的槽位
+    if (g_atomic_int_get(&queue->playback_middle) & LYRICS_QUEUE_PLAYBACK_FRESH) {
+        gint fresh = exchange_index(&queue->playback_middle, (gint)queue->playback_front);
+        queue->playback_front = (guint)(fresh & ~LYRICS_QUEUE_PLAYBACK_FRESH);
+        if (!g_atomic_int_get(&queue->closed)) {
+            queue->playback_func(&queue->playback_slots[queue->playback_front], queue->user_data);
+        }
+    }
+
+    guint tail = (guint)g_atomic_int_get(&queue->tail);
+    guint head = (guint)g_atomic_int_get(&queue->head);
+    LyricsUpdate *mailbox = take_mailbox(&queue->mailbox);
+
+    const LyricsUpdate *latest = mailbox;
+    for (guint i = tail; i != head; i++) {
+        const LyricsUpdate *update = &queue->slots[i & (queue->capacity - 1)].update;
+        if (!latest || update->seq > latest->seq) {
+            latest = update;
+        }
+    }
+
+    if (latest) {
+        queue->stats.drains++;
+
+        // 统计被取代的行（只比较指针和歌曲名，不做渲染）
+        for (guint i = tail; i != head; i++) {
+            const LyricsUpdate *update = &queue->slots[i & (queue->capacity - 1)].update;
+            if (update == latest) {
+                continue;
+            }
+            if (strcmp(update->song, latest->song) == 0) {
+                queue->stats.coalesced++;
+            } else {
+                queue->stats.superseded++;
+            }
+        }
+        if (mailbox && mailbox != latest) {
+            queue->stats.superseded++;
+        }
+
+        if (!g_atomic_int_get(&queue->closed)) {
+            queue->func(latest, queue->user_data);
+        }
+    }
+
+    // 显示完成后才释放槽位，生产者此前不会覆盖它们
+    g_atomic_int_set(&queue->tail, (gint)head);
+    lyrics_update_free(mailbox);
+
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean lyrics_queue_init(LyricsQueue *queue, guint capacity, LyricsQueueFunc func,
+                           LyricsPlaybackFunc playback_func, gpointer user_data) {
+    memset(queue, 0, sizeof(LyricsQueue));
+    queue->playback.position_ms = -1;
+    queue->playback.paused = -1;
+    queue->playback_back = 0;
+    queue->playback_middle = 1;
+    queue->playback_front = 2;
+
+    queue->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (queue->wakeup_fd < 0) {
+        perror("❌ [歌词队列] 创建eventfd失败");
+        g_atomic_int_set(&queue->closed, 1);
+        return FALSE;
+    }
+
+    queue->capacity = 1;
+    while (queue->capacity < capacity) {
+        queue->capacity <<= 1;
+    }
+    queue->slots = g_malloc0(sizeof(LyricsQueueSlot) * queue->capacity);
+    queue->func = func;
+    queue->playback_func = playback_func;
+    queue->user_data = user_data;
+    queue->watch_id = g_unix_fd_add(queue->wakeup_fd, G_IO_IN, lyrics_queue_dispatch, queue);
+
+    return TRUE;
+}
+
+void lyrics_queue_clear(LyricsQueue *queue) {
+    g_atomic_int_set(&queue->closed, 1);
+
+    if (queue->watch_id > 0) {
+        g_source_remove(queue->watch_id);
+        queue->watch_id = 0;
+    }
+    if (queue->wakeup_fd >= 0) {
+        close(queue->wakeup_fd);
+        queue->wakeup_fd = -1;
+    }
+
+    for (guint i = 0; i < queue->capacity; i++) {
+        LyricsUpdate *update = &queue->slots[i].update;
+        g_free(update->song);
+        g_free(update->text);
+        g_free(update->format);
+    }
+    g_free(queue->slots);
+    queue->slots = NULL;
+    queue->capacity = 0;
+
+    lyrics_update_free(take_mailbox(&queue->mailbox));
+    g_free(queue->last_song);
+    queue->last_song = NULL;
+    g_free(queue->last_text);
+    queue->last_text = NULL;
+}
+
+gboolean lyrics_queue_push(LyricsQueue *queue, const gchar *song, const gchar *text, gsize text_len,
+                           const gchar *format, gint64 received_time, gboolean force) {
+    if (g_atomic_int_get(&queue->closed)) {
+        return FALSE;
+    }
+
+    queue->stats.pushed++;
+
+    if (!song) {
+        song = "";
+    }
+
+    // 同一首歌的同一行（例如重连后服务器重发的最后一行）；收到时间每次都不同，不参与比较
+    if (!force && queue->last_text && strcmp(queue->last_song, song) == 0 &&
+        queue->last_text_len == text_len && memcmp(queue->last_text, text, text_len) == 0) {
+        queue->stats.duplicates++;
+        return FALSE;
+    }
+
+    copy_to_buffer(&queue->last_song, &queue->last_song_cap, song, strlen(song));
+    copy_to_buffer(&queue->last_text, &queue->last_text_cap, text, text_len);
+    queue->last_text_len = text_len;
+
+    guint head = (guint)g_atomic_int_get(&queue->head);
+    guint tail = (guint)g_atomic_int_get(&queue->tail);
+
+    if (head - tail < queue->capacity) {
+        // 写入槽位后再发布head，消费者只会看到完整的行
+        LyricsQueueSlot *slot = &queue->slots[head & (queue->capacity - 1)];
+        copy_to_buffer(&slot->update.song, &slot->song_cap, song, strlen(song));
+        copy_to_buffer(&slot->update.text, &slot->text_cap, text, text_len);
+        copy_to_buffer(&slot->update.format, &slot->format_cap, format, strlen(format));
+        slot->update.received_time = received_time;
+        slot->update.queued_us = g_get_monotonic_time();
+        slot->update.seq = queue->next_seq++;
+        g_atomic_int_set(&queue->head, (gint)(head + 1));
+    } else {
+        // 主线程繁忙，环形缓冲区已满：最新的行放进溢出信箱，替换其中未取走的行
+        LyricsUpdate *update = g_malloc0(sizeof(LyricsUpdate));
+        update->song = g_strdup(song);
+        update->text = g_strndup(text, text_len);
+        update->format = g_strdup(format);
+        update->received_time = received_time;
+        update->queued_us = g_get_monotonic_time();
+        update->seq = queue->next_seq++;
+        queue->stats.overflows++;
+
+        LyricsUpdate *old = replace_mailbox(&queue->mailbox, update);
+        if (old) {
+            queue->stats.dropped++;
+            lyrics_update_free(old);
+        }
+    }
+
+    lyrics_queue_wakeup(queue);
+    return TRUE;
+}
+
+void lyrics_queue_push_playback(LyricsQueue *queue, gint64 position_ms, gint paused, gdouble rate, gint64 time) {
+    if (g_atomic_int_get(&queue->closed)) {
+        return;
+    }
+
+    // 累积成完整状态，中间槽位中未取走的旧快照可以直接覆盖
+    if (position_ms >= 0) {
+        queue->playback.position_ms = position_ms;
+        queue->playback.position_time = time;
+    }
+    if (paused >= 0) {
+        queue->playback.paused = paused;
+    }
+    if (rate > 0) {
+        queue->playback.rate = rate;
+    }
+
+    // 写入后槽位再与中间槽位交换，换回的槽位消费者已不再读取
+    queue->playback_slots[queue->playback_back] = queue->playback;
+    gint old = exchange_index(&queue->playback_middle,
+                              (gint)queue->playback_back | LYRICS_QUEUE_PLAYBACK_FRESH);
+    queue->playback_back = (guint)(old & ~LYRICS_QUEUE_PLAYBACK_FRESH);
+    lyrics_queue_wakeup(queue);
+}
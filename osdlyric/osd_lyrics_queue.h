@@ -0,0 +1,135 @@
+#ifndef OSD_LYRICS_QUEUE_H
+#define OSD_LYRICS_QUEUE_H
+
+#include <glib.h>
+
+// 网络与界面之间的有界合并队列
+// 单生产者（SSE客户端）/单消费者（主线程）无锁环形缓冲区，通过eventfd唤醒主循环。
+// 同一首歌中完全相同的重复行（KRC/LRC文本本身带有行时间戳）在生产者端丢弃；一次唤醒取出所有待显示行，
+// 只显示最新的一行，突发时界面只做一次渲染
+
+typedef struct {
+    gchar *song;             // 歌曲名，未提供时为空字符串
+    gchar *text;
+    gchar *format;
+    gint64 received_time;    // 收到时间（单调时钟，毫秒）
+    gint64 queued_us;        // 入队时间（微秒），用于分发延迟统计
+    guint64 seq;             // 入队序号，越大越新
+} LyricsUpdate;
+
+// 播放状态快照：生产者累积最新的完整状态，消费者按观测时间忽略已应用过的位置
+typedef struct {
+    gint64 position_ms;      // 最近一次位置观测，没有时为-1
+    gint64 position_time;    // 位置的观测时间（单调时钟，毫秒）
+    gint paused;             // 1暂停，0播放，未知为-1
+    gdouble rate;            // 播放速率，未知为0
+} LyricsPlayback;
+
+// 环形缓冲区的槽位，字符串缓冲区跨轮次复用
+typedef struct {
+    LyricsUpdate update;
+    gsize song_cap;
+    gsize text_cap;
+    gsize format_cap;
+} LyricsQueueSlot;
+
+/**
+ * 在主线程中显示最新的一行，update 只在回调期间有效
+ */
+typedef void (*LyricsQueueFunc)(const LyricsUpdate *update, gpointer user_data);
+
+/**
+ * 在主线程中应用最新的播放状态，先于同一批歌词行调用
+ */
+typedef void (*LyricsPlaybackFunc)(const LyricsPlayback *playback, gpointer user_data);
+
+// 队列统计（生产者和消费者各自只写自己的计数）
+typedef struct {
+    // 生产者
+    guint64 pushed;          // 入队请求次数
+    guint64 duplicates;      // 完全重复而丢弃
+    guint64 overflows;       // 环形缓冲区已满，改放溢出信箱
+    guint64 dropped;         // 信箱中未取走的行被更新的行替换
+    guint64 wakeups;         // eventfd写入次数
+    // 消费者
+    guint64 coalesced;       // 被同一首歌更新的行取代
+    guint64 superseded;      // 被其他歌曲更新的行取代
+    guint64 drains;          // 主线程处理次数
+} LyricsQueueStats;
+
+#define LYRICS_QUEUE_PLAYBACK_FRESH 0x4
+
+typedef struct {
+    LyricsQueueSlot *slots;
+    guint capacity;          // 2的幂
+    gint head;               // 生产者写入位置，原子访问
+    gint tail;               // 消费者读取位置，原子访问
+    gpointer mailbox;        // 溢出信箱（LyricsUpdate*），原子访问
+    // 播放状态三缓冲：生产者写后槽位，消费者读前槽位，两者通过中间槽位交换，不分配内存
+    LyricsPlayback playback_slots[3];
+    gint playback_middle;    // 中间槽位序号，LYRICS_QUEUE_PLAYBACK_FRESH 表示尚未取走，原子访问
+    guint playback_back;     // 只由生产者访问
+    guint playback_front;    // 只由消费者访问
+
+    gint wakeup_fd;          // eventfd
+    gint wakeup_pending;     // 已写入eventfd且尚未被处理，原子访问
+    guint watch_id;
+    gint closed;             // 原子访问
+
+    // 只由生产者访问
+    gchar *last_song;        // 最近一次入队的歌曲和行，用于识别重复
+    gsize last_song_cap;
+    gchar *last_text;
+    gsize last_text_len;
+    gsize last_text_cap;
+    guint64 next_seq;
+    LyricsPlayback playback; // 累积的播放状态
+
+    LyricsQueueFunc func;
+    LyricsPlaybackFunc playback_func;
+    gpointer user_data;
+
+    LyricsQueueStats stats;
+} LyricsQueue;
+
+/**
+ * 初始化队列并在默认主循环中监视唤醒fd，必须在主线程中调用
+ * @param queue 队列
+ * @param capacity 环形缓冲区大小（向上取整到2的幂）
+ * @param func 在主线程中显示最新一行的回调
+ * @param playback_func 在主线程中应用播放状态的回调
+ * @param user_data 回调用户数据
+ * @return 成功返回TRUE
+ */
+gboolean lyrics_queue_init(LyricsQueue *queue, guint capacity, LyricsQueueFunc func,
+                           LyricsPlaybackFunc playback_func, gpointer user_data);
+
+/**
+ * 关闭队列并释放所有资源，必须在主线程中、生产者停止之后调用
+ * @param queue 队列
+ */
+void lyrics_queue_clear(LyricsQueue *queue);
+
+/**
+ * 加入一行歌词，只能由同一个生产者线程调用
+ * @param song 歌曲名，可以为NULL
+ * @param text 歌词文本
+ * @param text_len 文本长度
+ * @param format 歌词格式
+ * @param received_time 收到时间（毫秒）
+ * @param force 跳过重复检查（重连后恢复显示时使用）
+ * @return 加入队列返回TRUE，重复或队列已关闭返回FALSE
+ */
+gboolean lyrics_queue_push(LyricsQueue *queue, const gchar *song, const gchar *text, gsize text_len,
+                           const gchar *format, gint64 received_time, gboolean force);
+
+/**
+ * 更新播放状态（与 lyrics_queue_push 同一个生产者线程调用）
+ * @param position_ms 播放位置，未提供时为-1
+ * @param paused 1暂停，0播放，未提供时为-1
+ * @param rate 播放速率，未提供时为0
+ * @param time 观测时间（单调时钟，毫秒）
+ */
+void lyrics_queue_push_playback(LyricsQueue *queue, gint64 position_ms, gint paused, gdouble rate, gint64 time);
+
+#endif // OSD_LYRICS_QUEUE_H
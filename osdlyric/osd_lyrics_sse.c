@@ -0,0 +1,216 @@
+#include <string.h>
+#include "osd_lyrics_sse.h"
+
+// 确保缓冲区至少能容纳 needed 字节（含结尾'\0'），按倍数增长以摊薄分配
+static void sse_buffer_reserve(SSEParser *parser, SSEBuffer *buffer, gsize needed) {
+    if (needed <= buffer->cap) {
+        return;
+    }
+
+    gsize new_cap = buffer->cap ? buffer->cap : 256;
+    while (new_cap < needed) {
+        new_cap *= 2;
+    }
+
+    buffer->str = g_realloc(buffer->str, new_cap);
+    buffer->cap = new_cap;
+    parser->stats.allocations++;
+}
+
+static void sse_buffer_set(SSEParser *parser, SSEBuffer *buffer, const gchar *str, gsize len) {
+    sse_buffer_reserve(parser, buffer, len + 1);
+    memcpy(buffer->str, str, len);
+    buffer->str[len] = '\0';
+    buffer->len = len;
+}
+
+static void sse_buffer_append(SSEParser *parser, SSEBuffer *buffer, const gchar *str, gsize len) {
+    sse_buffer_reserve(parser, buffer, buffer->len + len + 1);
+    memcpy(buffer->str + buffer->len, str, len);
+    buffer->len += len;
+    buffer->str[buffer->len] = '\0';
+}
+
+static void sse_buffer_free(SSEBuffer *buffer) {
+    g_free(buffer->str);
+    buffer->str = NULL;
+    buffer->len = 0;
+    buffer->cap = 0;
+}
+
+void sse_parser_init(SSEParser *parser, SSEEventFunc callback, gpointer user_data) {
+    memset(parser, 0, sizeof(SSEParser));
+    parser->retry_ms = -1;
+    parser->callback = callback;
+    parser->user_data = user_data;
+}
+
+void sse_parser_reset(SSEParser *parser) {
+    parser->line.len = 0;
+    parser->data.len = 0;
+    parser->event.len = 0;
+    parser->skip_lf = FALSE;
+    parser->bom_checked = FALSE;
+}
+
+void sse_parser_clear(SSEParser *parser) {
+    sse_buffer_free(&parser->line);
+    sse_buffer_free(&parser->data);
+    sse_buffer_free(&parser->event);
+    sse_buffer_free(&parser->last_id);
+}
+
+const gchar* sse_parser_get_last_id(const SSEParser *parser) {
+    return parser->last_id.len > 0 ? parser->last_id.str : NULL;
+}
+
+// 空行：分发当前事件
+static void sse_dispatch_event(SSEParser *parser) {
+    if (parser->data.len == 0) {
+        // 没有data字段，按规范丢弃事件类型
+        parser->event.len = 0;
+        return;
+    }
+
+    // 去掉最后一个data行追加的'\n'
+    parser->data.len--;
+    parser->data.str[parser->data.len] = '\0';
+
+    SSEEvent event;
+    event.event = parser->event.len > 0 ? parser->event.str : "message";
+    event.data = parser->data.str;
+    event.data_len = parser->data.len;
+    event.id = parser->last_id.len > 0 ? parser->last_id.str : "";
+
+    parser->stats.events++;
+    if (parser->callback) {
+        parser->callback(&event, parser->user_data);
+    }
+
+    parser->data.len = 0;
+    parser->event.len = 0;
+}
+
+// 处理一个完整的行（不含行结束符）
+static void sse_process_line(SSEParser *parser, const gchar *line, gsize len) {
+    parser->stats.lines++;
+
+    // 流开头的UTF-8 BOM需要去掉
+    if (!parser->bom_checked) {
+        parser->bom_checked = TRUE;
+        if (len >= 3 && (guchar)line[0] == 0xEF && (guchar)line[1] == 0xBB && (guchar)line[2] == 0xBF) {
+            line += 3;
+            len -= 3;
+        }
+    }
+
+    if (len == 0) {
+        sse_dispatch_event(parser);
+        return;
+    }
+
+    // 以冒号开头的是注释（常用于保活）
+    if (line[0] == ':') {
+        return;
+    }
+
+    const gchar *colon = memchr(line, ':', len);
+    gsize field_len = colon ? (gsize)(colon - line) : len;
+    const gchar *value = "";
+    gsize value_len = 0;
+
+    if (colon) {
+        value = colon + 1;
+        value_len = len - field_len - 1;
+        // 冒号后的第一个空格不属于值
+        if (value_len > 0 && value[0] == ' ') {
+            value++;
+            value_len--;
+        }
+    }
+
+    if (field_len == 4 && memcmp(line, "data", 4) == 0) {
+        sse_buffer_append(parser, &parser->data, value, value_len);
+        sse_buffer_append(parser, &parser->data, "\n", 1);
+    } else if (field_len == 5 && memcmp(line, "event", 5) == 0) {
+        sse_buffer_set(parser, &parser->event, value, value_len);
+    } else if (field_len == 2 && memcmp(line, "id", 2) == 0) {
+        // 包含NUL的ID按规范忽略
+        if (!memchr(value, '\0', value_len)) {
+            sse_buffer_set(parser, &parser->last_id, value, value_len);
+        }
+    } else if (field_len == 5 && memcmp(line, "retry", 5) == 0) {
+        gint retry = 0;
+        gsize i;
+        for (i = 0; i < value_len; i++) {
+            if (value[i] < '0' || value[i] > '9') {
+                break;
+            }
+            retry = retry * 10 + (value[i] - '0');
+            if (retry > 24 * 3600 * 1000) {
+                break;
+            }
+        }
+        if (value_len > 0 && i == value_len) {
+            parser->retry_ms = retry;
+        }
+    }
+    // 其他字段按规范忽略
+}
+
+void sse_parser_feed(SSEParser *parser, const gchar *chunk, gsize len) {
+    if (!parser || !chunk || len == 0) {
+        return;
+    }
+
+    gint64 start_time = g_get_monotonic_time();
+    parser->stats.bytes += len;
+
+    const gchar *ptr = chunk;
+    const gchar *end = chunk + len;
+
+    // 上一块以'\r'结尾时，'\r\n'被拆开了
+    if (parser->skip_lf) {
+        parser->skip_lf = FALSE;
+        if (*ptr == '\n') {
+            ptr++;
+        }
+    }
+
+    while (ptr < end) {
+        // 只扫描新字节，寻找行结束符
+        const gchar *eol = ptr;
+        while (eol < end && *eol != '\n' && *eol != '\r') {
+            eol++;
+        }
+
+        if (eol == end) {
+            // 不完整的行，保留到下一块
+            sse_buffer_append(parser, &parser->line, ptr, end - ptr);
+            break;
+        }
+
+        if (parser->line.len > 0) {
+            // 行跨越了数据块，拼接后处理
+            sse_buffer_append(parser, &parser->line, ptr, eol - ptr);
+            sse_process_line(parser, parser->line.str, parser->line.len);
+            parser->line.len = 0;
+        } else {
+            // 常见情况：整行都在当前块中，直接处理，无需复制
+            sse_process_line(parser, ptr, eol - ptr);
+        }
+
+        if (*eol == '\r') {
+            if (eol + 1 < end) {
+                if (eol[1] == '\n') {
+                    eol++;
+                }
+            } else {
+                parser->skip_lf = TRUE;
+            }
+        }
+        ptr = eol + 1;
+    }
+
+    parser->stats.parse_time_us += g_get_monotonic_time() - start_time;
+}
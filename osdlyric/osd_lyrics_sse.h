@@ -0,0 +1,88 @@
+#ifndef OSD_LYRICS_SSE_H
+#define OSD_LYRICS_SSE_H
+
+#include <glib.h>
+
+// 增量式SSE (Server-Sent Events) 帧解析器
+// 只扫描新到达的字节，跨数据块保留不完整的行，
+// 支持 event:/id:/retry:/多行data: 以及空行分发
+
+/**
+ * 一个已分发的SSE事件，所有字段均借用解析器内部缓冲区，
+ * 只在回调期间有效
+ */
+typedef struct {
+    const gchar *event;   // 事件类型，未指定时为 "message"
+    gchar *data;          // 多行data以'\n'连接，以'\0'结尾（回调可原地修改）
+    gsize data_len;
+    const gchar *id;      // 最近一次收到的事件ID，没有时为空字符串
+} SSEEvent;
+
+typedef void (*SSEEventFunc)(SSEEvent *event, gpointer user_data);
+
+// 可复用的增长式缓冲区，只在容量不足时重新分配
+typedef struct {
+    gchar *str;
+    gsize len;
+    gsize cap;
+} SSEBuffer;
+
+// 解析统计，用于评估吞吐和分配次数
+typedef struct {
+    guint64 bytes;          // 输入字节数
+    guint64 lines;          // 解析的行数
+    guint64 events;         // 分发的事件数
+    guint64 allocations;    // 缓冲区（重新）分配次数
+    guint64 parse_time_us;  // 解析耗时（包括回调）
+} SSEParserStats;
+
+typedef struct {
+    SSEBuffer line;         // 跨数据块的不完整行
+    SSEBuffer data;         // 当前事件的data字段
+    SSEBuffer event;        // 当前事件的event字段
+    SSEBuffer last_id;      // 最近的事件ID，跨事件保留
+    gint retry_ms;          // 服务器建议的重连间隔，未设置时为-1
+    gboolean skip_lf;       // 上一个数据块以'\r'结尾，需要跳过紧随的'\n'
+    gboolean bom_checked;   // 是否已检查过流开头的UTF-8 BOM
+
+    SSEEventFunc callback;
+    gpointer user_data;
+
+    SSEParserStats stats;
+} SSEParser;
+
+/**
+ * 初始化解析器
+ * @param parser 解析器
+ * @param callback 事件分发回调
+ * @param user_data 回调用户数据
+ */
+void sse_parser_init(SSEParser *parser, SSEEventFunc callback, gpointer user_data);
+
+/**
+ * 重置流状态（新连接时调用），保留last_id、retry和统计信息
+ * @param parser 解析器
+ */
+void sse_parser_reset(SSEParser *parser);
+
+/**
+ * 释放解析器内部缓冲区
+ * @param parser 解析器
+ */
+void sse_parser_clear(SSEParser *parser);
+
+/**
+ * 输入一块网络数据，完整的事件会同步分发给回调
+ * @param parser 解析器
+ * @param chunk 数据
+ * @param len 数据长度
+ */
+void sse_parser_feed(SSEParser *parser, const gchar *chunk, gsize len);
+
+/**
+ * 获取最近的事件ID
+ * @return 事件ID，没有时返回NULL
+ */
+const gchar* sse_parser_get_last_id(const SSEParser *parser);
+
+#endif // OSD_LYRICS_SSE_H
@@ -0,0 +1,575 @@
+#include <string.h>
+#include <stdlib.h>
+#include "osd_lyrics_timeline.h"
+
+// 构建过程中使用的可增长数组
+struct _LyricsTimelineBuilder {
+    GArray *lines;
+    GArray *syllables;
+    GString *text;
+    gint64 offset_ms;        // LRC的 [offset:]，正数表示歌词提前
+    // 以下只用于逐行构建
+    GString *source;         // 由行数据生成的文档
+    gchar *song;
+    gboolean is_krc;
+};
+typedef struct _LyricsTimelineBuilder TimelineBuilder;
+
+// 同一行文本的时间标签数上限，超出的忽略
+#define LRC_MAX_LINE_TIMES 32
+
+// 行时长未知时（最后一行、单行解析），没有结束标签的最后一个音节的默认时长
+#define LRC_OPEN_SYLLABLE_MS 500
+
+// 解析无符号整数，返回数字位数
+static gint parse_digits(const gchar **p, const gchar *end, gint64 *value) {
+    gint digits = 0;
+    *value = 0;
+    while (*p < end && **p >= '0' && **p <= '9') {
+        *value = *value * 10 + (**p - '0');
+        (*p)++;
+        digits++;
+    }
+    return digits;
+}
+
+// KRC行头 [start,duration]
+static gboolean parse_krc_header(const gchar **p, const gchar *end, gint64 *start, gint64 *duration) {
+    const gchar *ptr = *p;
+    if (ptr >= end || *ptr != '[') return FALSE;
+    ptr++;
+    if (parse_digits(&ptr, end, start) == 0) return FALSE;
+    if (ptr >= end || *ptr != ',') return FALSE;
+    ptr++;
+    if (parse_digits(&ptr, end, duration) == 0) return FALSE;
+    if (ptr >= end || *ptr != ']') return FALSE;
+    *p = ptr + 1;
+    return TRUE;
+}
+
+// LRC时间 mm:ss、mm:ss.xx、mm:ss.xxx 或 mm:ss:xx，行标签用 [] 包围，逐字标签用 <> 包围
+static gboolean parse_lrc_time(const gchar **p, const gchar *end, gchar open, gchar close, gint64 *time_ms) {
+    const gchar *ptr = *p;
+    gint64 minutes, seconds, fraction = 0;
+
+    if (ptr >= end || *ptr != open) return FALSE;
+    ptr++;
+    if (parse_digits(&ptr, end, &minutes) == 0) return FALSE;
+    if (ptr >= end || *ptr != ':') return FALSE;
+    ptr++;
+    if (parse_digits(&ptr, end, &seconds) == 0) return FALSE;
+    if (ptr < end && (*ptr == '.' || *ptr == ':')) {
+        ptr++;
+        gint digits = parse_digits(&ptr, end, &fraction);
+        if (digits == 0 || digits > 3) return FALSE;
+        for (; digits < 3; digits++) {
+            fraction *= 10;
+        }
+    }
+    if (ptr >= end || *ptr != close) return FALSE;
+
+    *time_ms = (minutes * 60 + seconds) * 1000 + fraction;
+    *p = ptr + 1;
+    return TRUE;
+}
+
+// LRC行时间标签 [mm:ss.xx]
+static gboolean parse_lrc_timestamp(const gchar **p, const gchar *end, gint64 *time_ms) {
+    return parse_lrc_time(p, end, '[', ']', time_ms);
+}
+
+// LRC时间偏移 [offset:+500]（毫秒）
+static gboolean parse_lrc_offset(const gchar **p, const gchar *end, gint64 *offset_ms) {
+    static const gchar tag[] = "[offset:";
+    const gsize tag_len = sizeof(tag) - 1;
+    const gchar *ptr = *p;
+    gboolean negative = FALSE;
+    gint64 value;
+
+    if ((gsize)(end - ptr) < tag_len || g_ascii_strncasecmp(ptr, tag, tag_len) != 0) return FALSE;
+    ptr += tag_len;
+    while (ptr < end && *ptr == ' ') ptr++;
+    if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+        negative = *ptr == '-';
+        ptr++;
+    }
+    if (parse_digits(&ptr, end, &value) == 0) return FALSE;
+    while (ptr < end && *ptr == ' ') ptr++;
+    if (ptr >= end || *ptr != ']') return FALSE;
+
+    *offset_ms = negative ? -value : value;
+    *p = ptr + 1;
+    return TRUE;
+}
+
+// KRC音节标签 <offset,duration,0>
+static gboolean parse_krc_syllable_tag(const gchar **p, const gchar *end, gint64 *offset, gint64 *duration) {
+    const gchar *ptr = *p;
+    if (ptr >= end || *ptr != '<') return FALSE;
+    ptr++;
+    if (parse_digits(&ptr, end, offset) == 0) return FALSE;
+    if (ptr >= end || *ptr != ',') return FALSE;
+    ptr++;
+    if (parse_digits(&ptr, end, duration) == 0) return FALSE;
+    // 第三个字段未使用
+    while (ptr < end && *ptr != '>') ptr++;
+    if (ptr >= end) return FALSE;
+    *p = ptr + 1;
+    return TRUE;
+}
+
+static void builder_init(TimelineBuilder *builder, gsize size_hint) {
+    memset(builder, 0, sizeof(TimelineBuilder));
+    builder->lines = g_array_new(FALSE, FALSE, sizeof(LyricsLine));
+    builder->syllables = g_array_new(FALSE, FALSE, sizeof(LyricsSyllable));
+    builder->text = g_string_sized_new(size_hint);
+}
+
+static void builder_add_line(TimelineBuilder *builder, LyricsLine *line, gsize source_offset, gsize source_length) {
+    line->source_offset = source_offset;
+    line->source_length = source_length;
+    line->text_length = builder->text->len - line->text_offset;
+    g_string_append_c(builder->text, '\0');
+    g_array_append_val(builder->lines, *line);
+}
+
+static void parse_krc_line(TimelineBuilder *builder, const gchar *source, const gchar *line_start,
+                           const gchar *line_end) {
+    const gchar *p = line_start;
+    LyricsLine line;
+    memset(&line, 0, sizeof(line));
+
+    if (!parse_krc_header(&p, line_end, &line.start_ms, &line.duration_ms)) {
+        return; // [ar:...] 等元数据行
+    }
+
+    line.text_offset = builder->text->len;
+    line.first_syllable = builder->syllables->len;
+
+    while (p < line_end) {
+        LyricsSyllable syllable;
+        if (parse_krc_syllable_tag(&p, line_end, &syllable.start_ms, &syllable.duration_ms)) {
+            const gchar *text_start = p;
+            while (p < line_end && *p != '<') p++;
+            syllable.byte_offset = builder->text->len - line.text_offset;
+            syllable.byte_length = p - text_start;
+            g_string_append_len(builder->text, text_start, p - text_start);
+            g_array_append_val(builder->syllables, syllable);
+            line.syllable_count++;
+        } else {
+            // 没有时间标签的文本
+            const gchar *text_start = p++;
+            while (p < line_end && *p != '<') p++;
+            g_string_append_len(builder->text, text_start, p - text_start);
+        }
+    }
+
+    builder_add_line(builder, &line, line_start - source, line_end - line_start);
+}
+
+// 增强LRC（A2扩展）：[mm:ss.xx]前缀<mm:ss.xx>字<mm:ss.xx>字...<mm:ss.xx>
+// 逐字标签是歌曲中的绝对时间，标签后直到下一个标签的文本为一个音节，下一个标签即其结束；
+// 行尾没有文本的标签只表示最后一个音节的结束。同一行文本可以有多个行时间标签
+static void parse_lrc_line(TimelineBuilder *builder, const gchar *source, const gchar *line_start,
+                           const gchar *line_end) {
+    const gchar *p = line_start;
+    gint64 times[LRC_MAX_LINE_TIMES];
+    guint n_times = 0;
+    gint64 time_ms;
+
+    while (parse_lrc_timestamp(&p, line_end, &time_ms)) {
+        if (n_times < LRC_MAX_LINE_TIMES) {
+            times[n_times++] = time_ms;
+        }
+    }
+    if (n_times == 0) {
+        parse_lrc_offset(&p, line_end, &builder->offset_ms);
+        return; // [ti:...] 等元数据行
+    }
+    while (p < line_end && (*p == ' ' || *p == '\t')) p++;
+
+    LyricsLine line;
+    memset(&line, 0, sizeof(line));
+    line.start_ms = times[0];
+    line.text_offset = builder->text->len;
+    line.first_syllable = builder->syllables->len;
+
+    gint open_syllable = -1; // 等待结束标签的音节
+    while (p < line_end) {
+        if (parse_lrc_time(&p, line_end, '<', '>', &time_ms)) {
+            if (open_syllable >= 0) {
+                LyricsSyllable *previous = &g_array_index(builder->syllables, LyricsSyllable, open_syllable);
+                previous->duration_ms = MAX(time_ms - line.start_ms - previous->start_ms, 0);
+                open_syllable = -1;
+            }
+
+            const gchar *text_start = p;
+            while (p < line_end && *p != '<') p++;
+            if (p == text_start) {
+                continue; // 结束标签
+            }
+
+            LyricsSyllable syllable;
+            syllable.start_ms = MAX(time_ms - line.start_ms, 0);
+            syllable.duration_ms = -1; // 由下一个标签或行结束确定
+            syllable.byte_offset = builder->text->len - line.text_offset;
+            syllable.byte_length = p - text_start;
+            g_string_append_len(builder->text, text_start, p - text_start);
+            open_syllable = builder->syllables->len;
+            g_array_append_val(builder->syllables, syllable);
+            line.syllable_count++;
+        } else {
+            // 没有时间标签的文本
+            const gchar *text_start = p++;
+            while (p < line_end && *p != '<') p++;
+            g_string_append_len(builder->text, text_start, p - text_start);
+        }
+    }
+
+    builder_add_line(builder, &line, line_start - source, line_end - line_start);
+
+    // 重复的时间标签共用同一份文本和音节
+    for (guint i = 1; i < n_times; i++) {
+        LyricsLine repeat = line;
+        repeat.start_ms = times[i];
+        g_array_append_val(builder->lines, repeat);
+    }
+}
+
+static gint compare_lines(const void *a, const void *b) {
+    const LyricsLine *line_a = (const LyricsLine *)a;
+    const LyricsLine *line_b = (const LyricsLine *)b;
+    if (line_a->start_ms != line_b->start_ms) {
+        return line_a->start_ms < line_b->start_ms ? -1 : 1;
+    }
+    // 同一时间的行保持文档中的顺序
+    return line_a->text_offset < line_b->text_offset ? -1 : (line_a->text_offset > line_b->text_offset);
+}
+
+// 生成时间轴，source 的所有权转移给时间轴；没有任何行时返回NULL
+static LyricsTimeline* builder_finish(TimelineBuilder *builder, const gchar *song, gboolean is_krc,
+                                      gchar *source, gsize source_len) {
+    if (builder->lines->len == 0) {
+        g_array_free(builder->lines, TRUE);
+        g_array_free(builder->syllables, TRUE);
+        g_string_free(builder->text, TRUE);
+        g_free(source);
+        return NULL;
+    }
+
+    // [offset:] 对整首歌词生效
+    if (builder->offset_ms != 0) {
+        for (guint i = 0; i < builder->lines->len; i++) {
+            LyricsLine *line = &g_array_index(builder->lines, LyricsLine, i);
+            line->start_ms = MAX(line->start_ms - builder->offset_ms, 0);
+        }
+    }
+
+    LyricsTimeline *timeline = g_malloc0(sizeof(LyricsTimeline));
+    timeline->song = g_strdup(song ? song : "");
+    timeline->format = g_strdup(is_krc ? "krc" : "lrc");
+    timeline->n_lines = builder->lines->len;
+    timeline->lines = (LyricsLine *)g_array_free(builder->lines, FALSE);
+    timeline->n_syllables = builder->syllables->len;
+    timeline->syllables = (LyricsSyllable *)g_array_free(builder->syllables, FALSE);
+    timeline->text_len = builder->text->len;
+    timeline->text = g_string_free(builder->text, FALSE);
+    timeline->source = source;
+    timeline->source_len = source_len;
+    timeline->ref_count = 1;
+
+    qsort(timeline->lines, timeline->n_lines, sizeof(LyricsLine), compare_lines);
+
+    // LRC没有行时长，持续到下一行开始；最后一行为0表示一直显示
+    // 没有结束标签的最后一个音节唱到行结束；行时长未知时沿用前一个音节的时长，
+    // 不能记为0，否则擦除会直接跳到行尾
+    if (!is_krc) {
+        for (guint i = 0; i < timeline->n_lines; i++) {
+            LyricsLine *line = &timeline->lines[i];
+            line->duration_ms = i + 1 < timeline->n_lines ? timeline->lines[i + 1].start_ms - line->start_ms : 0;
+
+            for (guint j = 0; j < line->syllable_count; j++) {
+                LyricsSyllable *syllable = &timeline->syllables[line->first_syllable + j];
+                if (syllable->duration_ms >= 0) {
+                    continue;
+                }
+                if (line->duration_ms > 0) {
+                    syllable->duration_ms = MAX(line->duration_ms - syllable->start_ms, 0);
+                } else if (j > 0 && syllable[-1].duration_ms > 0) {
+                    syllable->duration_ms = syllable[-1].duration_ms;
+                } else {
+                    syllable->duration_ms = LRC_OPEN_SYLLABLE_MS;
+                }
+            }
+        }
+    }
+
+    return timeline;
+}
+
+LyricsTimeline* lyrics_timeline_parse(const gchar *song, const gchar *format, const gchar *document, gsize len) {
+    if (!document || len == 0) {
+        return NULL;
+    }
+
+    gboolean is_krc = format && strcmp(format, "krc") == 0;
+    gchar *source = g_strndup(document, len);
+    const gchar *end = source + len;
+
+    TimelineBuilder builder;
+    builder_init(&builder, len);
+
+    const gchar *line_start = source;
+    while (line_start < end) {
+        const gchar *line_end = line_start;
+        while (line_end < end && *line_end != '\n' && *line_end != '\r') line_end++;
+
+        if (is_krc) {
+            parse_krc_line(&builder, source, line_start, line_end);
+        } else {
+            parse_lrc_line(&builder, source, line_start, line_end);
+        }
+
+        line_start = line_end;
+        while (line_start < end && (*line_start == '\n' || *line_start == '\r')) line_start++;
+    }
+
+    return builder_finish(&builder, song, is_krc, source, len);
+}
+
+LyricsTimelineBuilder* lyrics_timeline_builder_new(const gchar *song, const gchar *format, gsize size_hint) {
+    TimelineBuilder *builder = g_malloc(sizeof(TimelineBuilder));
+    builder_init(builder, size_hint);
+    builder->source = g_string_sized_new(size_hint * 2);
+    builder->song = g_strdup(song);
+    builder->is_krc = format && strcmp(format, "krc") == 0;
+    return builder;
+}
+
+void lyrics_timeline_builder_add_line(LyricsTimelineBuilder *builder, gint64 start_ms, gint64 duration_ms,
+                                      const LyricsSyllable *syllables, guint n_syllables,
+                                      const gchar *text, gsize text_len) {
+    LyricsLine line;
+    memset(&line, 0, sizeof(line));
+    line.start_ms = start_ms;
+    line.duration_ms = duration_ms;
+    line.text_offset = builder->text->len;
+    line.first_syllable = builder->syllables->len;
+    line.syllable_count = n_syllables;
+
+    gsize source_offset = builder->source->len;
+    lyrics_timeline_format_line(builder->source, builder->is_krc, start_ms, duration_ms,
+                                syllables, line.syllable_count, text, text_len);
+    gsize source_length = builder->source->len - source_offset;
+    g_string_append_c(builder->source, '\n');
+
+    if (line.syllable_count > 0) {
+        g_array_append_vals(builder->syllables, syllables, line.syllable_count);
+    }
+    g_string_append_len(builder->text, text, text_len);
+    builder_add_line(builder, &line, source_offset, source_length);
+}
+
+LyricsTimeline* lyrics_timeline_builder_finish(LyricsTimelineBuilder *builder) {
+    gsize source_len = builder->source->len;
+    gchar *source = g_string_free(builder->source, FALSE);
+    LyricsTimeline *timeline = builder_finish(builder, builder->song, builder->is_krc, source, source_len);
+    g_free(builder->song);
+    g_free(builder);
+    return timeline;
+}
+
+// 64位整数的十进制位数上限（含负号）
+#define FORMAT_NUMBER_MAX 20
+// 每个时间标签的长度上限：两个数字加上括号、分隔符和KRC的",0"
+#define FORMAT_TAG_MAX (2 * FORMAT_NUMBER_MAX + 6)
+
+// 十进制整数，至少 min_digits 位（前面补0），返回写入后的位置
+static gchar* put_number(gchar *p, gint64 value, guint min_digits) {
+    gchar digits[FORMAT_NUMBER_MAX];
+    guint n = 0;
+    guint64 magnitude = value < 0 ? -(guint64)value : (guint64)value;
+
+    do {
+        digits[n++] = (gchar)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    while (n < min_digits && n < sizeof(digits)) {
+        digits[n++] = '0';
+    }
+    if (value < 0) {
+        *p++ = '-';
+    }
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+// LRC时间 mm:ss.xx
+static gchar* put_lrc_time(gchar *p, gchar open, gchar close, gint64 time_ms) {
+    *p++ = open;
+    p = put_number(p, time_ms / 60000, 2);
+    *p++ = ':';
+    p = put_number(p, time_ms / 1000 % 60, 2);
+    *p++ = '.';
+    p = put_number(p, time_ms % 1000 / 10, 2);
+    *p++ = close;
+    return p;
+}
+
+// KRC时间 [开始,时长] 或 <偏移,时长,0>
+static gchar* put_krc_time(gchar *p, gboolean syllable, gint64 start_ms, gint64 duration_ms) {
+    *p++ = syllable ? '<' : '[';
+    p = put_number(p, start_ms, 1);
+    *p++ = ',';
+    p = put_number(p, duration_ms, 1);
+    if (syllable) {
+        *p++ = ',';
+        *p++ = '0';
+    }
+    *p++ = syllable ? '>' : ']';
+    return p;
+}
+
+// 每个音节都要格式化：先按上限一次性扩容，再直接写入，
+// 避免逐段 g_string_append_printf 的临时字符串和逐字符追加的边界检查
+void lyrics_timeline_format_line(GString *out, gboolean krc, gint64 start_ms, gint64 duration_ms,
+                                 const LyricsSyllable *syllables, guint n_syllables,
+                                 const gchar *text, gsize text_len) {
+    // 行标签、每个音节的标签和增强LRC的结束标签按上限计算，文本按与下面相同的方式精确计算
+    gsize max_len = ((gsize)n_syllables + 2) * FORMAT_TAG_MAX;
+    gsize consumed = 0;
+    for (guint i = 0; i < n_syllables; i++) {
+        if (syllables[i].byte_offset > consumed) {
+            max_len += syllables[i].byte_offset - consumed;
+        }
+        max_len += syllables[i].byte_length;
+        consumed = syllables[i].byte_offset + syllables[i].byte_length;
+    }
+    if (consumed < text_len) {
+        max_len += text_len - consumed;
+    }
+    gsize start_len = out->len;
+    g_string_set_size(out, start_len + max_len);
+    gchar *p = out->str + start_len;
+
+    if (krc) {
+        p = put_krc_time(p, FALSE, start_ms, duration_ms);
+    } else {
+        p = put_lrc_time(p, '[', ']', start_ms);
+    }
+
+    consumed = 0;
+    for (guint i = 0; i < n_syllables; i++) {
+        const LyricsSyllable *syllable = &syllables[i];
+        if (syllable->byte_offset > consumed) {
+            // 没有时间标签的文本
+            memcpy(p, text + consumed, syllable->byte_offset - consumed);
+            p += syllable->byte_offset - consumed;
+        }
+        if (krc) {
+            p = put_krc_time(p, TRUE, syllable->start_ms, syllable->duration_ms);
+        } else {
+            p = put_lrc_time(p, '<', '>', start_ms + syllable->start_ms);
+        }
+        memcpy(p, text + syllable->byte_offset, syllable->byte_length);
+        p += syllable->byte_length;
+        consumed = syllable->byte_offset + syllable->byte_length;
+    }
+
+    // 增强LRC用行尾的结束标签表示最后一个音节的时长（后面还有文本时会被当作新的音节）
+    if (!krc && n_syllables > 0 && consumed >= text_len) {
+        const LyricsSyllable *last = &syllables[n_syllables - 1];
+        p = put_lrc_time(p, '<', '>', start_ms + last->start_ms + last->duration_ms);
+    }
+    if (consumed < text_len) {
+        memcpy(p, text + consumed, text_len - consumed);
+        p += text_len - consumed;
+    }
+    g_string_truncate(out, p - out->str);
+}
+
+LyricsTimeline* lyrics_timeline_ref(LyricsTimeline *timeline) {
+    g_atomic_int_inc(&timeline->ref_count);
+    return timeline;
+}
+
+void lyrics_timeline_free(LyricsTimeline *timeline) {
+    if (!timeline || !g_atomic_int_dec_and_test(&timeline->ref_count)) {
+        return;
+    }
+    if (timeline->mapping) {
+        g_mapped_file_unref(timeline->mapping);
+        g_free(timeline);
+        return;
+    }
+    g_free(timeline->song);
+    g_free(timeline->format);
+    g_free(timeline->lines);
+    g_free(timeline->syllables);
+    g_free(timeline->text);
+    g_free(timeline->source);
+    g_free(timeline);
+}
+
+gint lyrics_timeline_find_line(const LyricsTimeline *timeline, gint64 position_ms) {
+    gint low = 0;
+    gint high = (gint)timeline->n_lines - 1;
+    gint found = -1;
+
+    while (low <= high) {
+        gint mid = low + (high - low) / 2;
+        if (timeline->lines[mid].start_ms <= position_ms) {
+            found = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return found;
+}
+
+gint lyrics_timeline_find_syllable(const LyricsTimeline *timeline, guint line_index, gint64 position_ms) {
+    const LyricsLine *line = &timeline->lines[line_index];
+    const LyricsSyllable *syllables = timeline->syllables + line->first_syllable;
+    gint64 offset_ms = position_ms - line->start_ms;
+    gint low = 0;
+    gint high = (gint)line->syllable_count - 1;
+    gint found = -1;
+
+    while (low <= high) {
+        gint mid = low + (high - low) / 2;
+        if (syllables[mid].start_ms <= offset_ms) {
+            found = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return found;
+}
+
+const gchar* lyrics_timeline_line_text(const LyricsTimeline *timeline, guint index) {
+    return timeline->text + timeline->lines[index].text_offset;
+}
+
+gint64 lyrics_timeline_line_start(const gchar *line, gint64 position_ms) {
+    const gchar *end = line + strlen(line);
+    const gchar *p = line;
+    gint64 start_ms, duration_ms;
+
+    if (parse_krc_header(&p, end, &start_ms, &duration_ms)) {
+        return start_ms;
+    }
+
+    // 重复的时间标签（副歌）：取离当前位置最近的一个，位置未知时取最后一个
+    gint64 best_ms = -1;
+    p = line;
+    while (parse_lrc_timestamp(&p, end, &start_ms)) {
+        if (best_ms < 0 || position_ms < 0 || ABS(start_ms - position_ms) < ABS(best_ms - position_ms)) {
+            best_ms = start_ms;
+        }
+    }
+    return best_ms;
+}
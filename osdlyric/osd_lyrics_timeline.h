@@ -0,0 +1,137 @@
+#ifndef OSD_LYRICS_TIMELINE_H
+#define OSD_LYRICS_TIMELINE_H
+
+#include <glib.h>
+
+// 整首歌词的时间轴
+// 整首LRC/KRC文档只解析一次，得到按开始时间排序的行数组和逐字（音节）子数组，
+// 数组中只保存偏移量不保存指针，换行时只需二分查找
+// LRC支持重复的行时间标签、[offset:] 和增强LRC的 <mm:ss.xx> 逐字标签，逐字时间与KRC使用同一表示
+
+// 逐字时间，KRC的 <offset,duration,0> 或增强LRC的 <mm:ss.xx>
+typedef struct {
+    gint64 start_ms;         // 相对于行开始的时间
+    gint64 duration_ms;
+    guint byte_offset;       // 在行文本中的字节偏移
+    guint byte_length;
+} LyricsSyllable;
+
+typedef struct {
+    gint64 start_ms;         // 在歌曲中的开始时间
+    gint64 duration_ms;
+    guint text_offset;       // 在文本池中的偏移，文本以'\0'结尾
+    guint text_length;
+    guint source_offset;     // 原始行在文档中的偏移（KRC渐进显示使用）
+    guint source_length;
+    guint first_syllable;    // 在音节数组中的下标
+    guint syllable_count;    // 0表示没有逐字时间
+} LyricsLine;
+
+typedef struct {
+    gchar *song;             // 歌曲名
+    gchar *format;           // "krc" 或 "lrc"
+    LyricsLine *lines;       // 按 start_ms 排序
+    guint n_lines;
+    LyricsSyllable *syllables;
+    guint n_syllables;
+    gchar *text;             // 文本池：每行的纯文本，依次排列
+    gsize text_len;
+    gchar *source;           // 原始文档
+    gsize source_len;
+
+    gint ref_count;          // 时间轴缓存和当前播放状态可以同时持有
+    GMappedFile *mapping;    // 非NULL时以上数组和字符串都指向只读映射的缓存文件，不单独释放
+} LyricsTimeline;
+
+/**
+ * 解析整首歌词文档
+ * @param song 歌曲名，可以为NULL
+ * @param format 歌词格式，"krc" 或 "lrc"
+ * @param document 文档内容，每行一条歌词
+ * @param len 文档长度
+ * @return 时间轴，没有任何带时间的行时返回NULL
+ */
+LyricsTimeline* lyrics_timeline_parse(const gchar *song, const gchar *format, const gchar *document, gsize len);
+
+// 逐行构建时间轴（例如紧凑二进制编码的整首歌词，不经过文本解析）
+typedef struct _LyricsTimelineBuilder LyricsTimelineBuilder;
+
+/**
+ * 开始逐行构建时间轴
+ * @param song 歌曲名，可以为NULL
+ * @param format 歌词格式，"krc" 或 "lrc"
+ * @param size_hint 预计的文本总长度
+ */
+LyricsTimelineBuilder* lyrics_timeline_builder_new(const gchar *song, const gchar *format, gsize size_hint);
+
+/**
+ * 添加一行，行可以乱序添加
+ * @param start_ms 行开始时间
+ * @param duration_ms 行时长
+ * @param syllables 逐字时间（byte_offset 相对于 text，按顺序且不重叠）
+ * @param n_syllables 音节数
+ * @param text 行的纯文本
+ * @param text_len 文本长度
+ */
+void lyrics_timeline_builder_add_line(LyricsTimelineBuilder *builder, gint64 start_ms, gint64 duration_ms,
+                                      const LyricsSyllable *syllables, guint n_syllables,
+                                      const gchar *text, gsize text_len);
+
+/**
+ * 完成构建并释放构建器，同时生成等价的LRC/KRC文档作为 source
+ * @return 时间轴，没有任何行时返回NULL
+ */
+LyricsTimeline* lyrics_timeline_builder_finish(LyricsTimelineBuilder *builder);
+
+/**
+ * 把一行格式化为LRC的 [mm:ss.xx]文本（有逐字时间时为增强LRC）或KRC的 [start,duration]<offset,duration,0>字...
+ * @param out 追加到的字符串
+ * @param krc 是否为KRC
+ */
+void lyrics_timeline_format_line(GString *out, gboolean krc, gint64 start_ms, gint64 duration_ms,
+                                 const LyricsSyllable *syllables, guint n_syllables,
+                                 const gchar *text, gsize text_len);
+
+/**
+ * 增加一个引用
+ * @return timeline
+ */
+LyricsTimeline* lyrics_timeline_ref(LyricsTimeline *timeline);
+
+/**
+ * 释放一个引用，最后一个引用释放时才释放时间轴
+ */
+void lyrics_timeline_free(LyricsTimeline *timeline);
+
+/**
+ * 查找在指定位置正在显示的行（最后一个 start_ms <= position_ms 的行）
+ * @param timeline 时间轴
+ * @param position_ms 播放位置（毫秒）
+ * @return 行下标，位置早于第一行时返回-1
+ */
+gint lyrics_timeline_find_line(const LyricsTimeline *timeline, gint64 position_ms);
+
+/**
+ * 在一行中查找指定位置正在唱的字（最后一个开始时间 <= position_ms 的音节）
+ * @param timeline 时间轴
+ * @param line_index 行下标
+ * @param position_ms 播放位置（毫秒，歌曲时间）
+ * @return 行内音节下标，没有逐字时间或位置早于第一个字时返回-1
+ */
+gint lyrics_timeline_find_syllable(const LyricsTimeline *timeline, guint line_index, gint64 position_ms);
+
+/**
+ * 获取某一行的纯文本
+ */
+const gchar* lyrics_timeline_line_text(const LyricsTimeline *timeline, guint index);
+
+/**
+ * 从单行歌词中取出开始时间，用作同步参考
+ * 支持KRC的 [171960,5040] 和LRC的 [02:51.96]，LRC有多个时间标签时取离 position_ms 最近的一个
+ * @param line 单行歌词
+ * @param position_ms 当前播放位置，未知时传-1（取最后一个时间标签）
+ * @return 开始时间（毫秒），无法识别时返回-1
+ */
+gint64 lyrics_timeline_line_start(const gchar *line, gint64 position_ms);
+
+#endif // OSD_LYRICS_TIMELINE_H
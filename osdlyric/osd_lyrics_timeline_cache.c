@@ -0,0 +1,474 @@
+#include <string.h>
+#include "osd_lyrics_timeline_cache.h"
+
+#define CACHE_MAGIC 0x4C544C4FU      // "OLTL"
+#define CACHE_VERSION 1
+#define CACHE_BYTE_ORDER 0x01020304U // 按本机字节序写入，读回不一致说明来自其他架构
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// 文件头，之后依次是记录索引和数据块，都按8字节对齐
+typedef struct {
+    guint32 magic;
+    guint32 version;
+    guint32 byte_order;
+    guint16 line_size;       // sizeof(LyricsLine)
+    guint16 syllable_size;   // sizeof(LyricsSyllable)
+    guint32 n_records;
+    guint32 reserved;
+} CacheFileHeader;
+
+// 索引中的一条记录，按最近使用顺序排列
+struct _LyricsTimelineCacheRecord {
+    guint64 hash;            // 身份键的哈希
+    guint64 offset;          // 数据块在文件中的偏移
+    guint64 size;            // 数据块大小（含对齐）
+};
+
+// 数据块：块头、行数组、音节数组，然后是以'\0'结尾的身份键、歌曲名、格式、文本池和原始文档
+typedef struct {
+    guint32 n_lines;
+    guint32 n_syllables;
+    guint32 key_len;
+    guint32 song_len;
+    guint32 format_len;
+    guint32 reserved;
+    guint64 text_len;
+    guint64 source_len;
+} CacheBlockHeader;
+
+struct _LyricsTimelineCacheEntry {
+    gchar *key;              // 哈希表的键
+    guint64 hash;
+    LyricsTimeline *timeline; // 持有一个引用
+    GList link;              // 在LRU队列中的节点
+};
+
+static guint64 fnv1a(guint64 hash, const gchar *data, gsize len) {
+    for (gsize i = 0; i < len; i++) {
+        hash ^= (guint8)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// 在 cache->key 中生成身份键：歌曲名\x1f歌手\x1f格式\x1f文档哈希，返回身份哈希
+static guint64 build_key(LyricsTimelineCache *cache, const gchar *song, const gchar *artist,
+                         const gchar *format, const gchar *document, gsize len) {
+    GString *key = g_string_truncate(cache->key, 0);
+    g_string_append(key, song ? song : "");
+    g_string_append_c(key, '\x1f');
+    g_string_append(key, artist ? artist : "");
+    g_string_append_c(key, '\x1f');
+    g_string_append(key, format ? format : "lrc");
+    g_string_append_printf(key, "\x1f%016" G_GINT64_MODIFIER "x", fnv1a(FNV_OFFSET, document, len));
+    return fnv1a(FNV_OFFSET, key->str, key->len);
+}
+
+// 时间轴是否由同一文档解析而来，防止哈希碰撞
+static gboolean same_document(const LyricsTimeline *timeline, const gchar *document, gsize len) {
+    return timeline->source && timeline->source_len == len && memcmp(timeline->source, document, len) == 0;
+}
+
+static void entry_free(gpointer data) {
+    LyricsTimelineCacheEntry *entry = (LyricsTimelineCacheEntry *)data;
+
+    g_free(entry->key);
+    lyrics_timeline_free(entry->timeline);
+    g_free(entry);
+}
+
+// 从LRU队列和哈希表中移除并释放
+static void entry_remove(LyricsTimelineCache *cache, LyricsTimelineCacheEntry *entry) {
+    g_queue_unlink(&cache->lru, &entry->link);
+    g_hash_table_remove(cache->entries, entry->key);
+}
+
+static void keep_pending(LyricsTimelineCache *cache, const LyricsTimelineCacheEntry *entry);
+
+// 以 cache->key 为键加入内存，接管时间轴的引用
+static void entry_add(LyricsTimelineCache *cache, guint64 hash, LyricsTimeline *timeline) {
+    LyricsTimelineCacheEntry *entry = g_new0(LyricsTimelineCacheEntry, 1);
+    entry->key = g_strndup(cache->key->str, cache->key->len);
+    entry->hash = hash;
+    entry->timeline = timeline;
+    entry->link.data = entry;
+
+    // 替换同一首歌同一文档的旧条目
+    LyricsTimelineCacheEntry *old = g_hash_table_lookup(cache->entries, entry->key);
+    if (old) {
+        entry_remove(cache, old);
+    }
+
+    g_hash_table_insert(cache->entries, entry->key, entry);
+    g_queue_push_head_link(&cache->lru, &entry->link);
+
+    while (cache->lru.length > cache->capacity) {
+        LyricsTimelineCacheEntry *oldest = (LyricsTimelineCacheEntry *)g_queue_peek_tail(&cache->lru);
+        keep_pending(cache, oldest);
+        entry_remove(cache, oldest);
+        cache->stats.evictions++;
+    }
+}
+
+static gsize align8(gsize size) {
+    return (size + 7) & ~(gsize)7;
+}
+
+// 数据块的实际大小，块头中的字段无效时返回0
+static guint64 block_size(const CacheBlockHeader *header) {
+    guint64 size = sizeof(CacheBlockHeader);
+    size += (guint64)header->n_lines * sizeof(LyricsLine);
+    size += (guint64)header->n_syllables * sizeof(LyricsSyllable);
+    size += (guint64)header->key_len + 1 + header->song_len + 1 + header->format_len + 1;
+    if (header->text_len > G_MAXUINT32 || header->source_len > G_MAXUINT32) {
+        return 0;
+    }
+    size += header->text_len + 1 + header->source_len + 1;
+    return align8(size);
+}
+
+// 记录指向的数据块，越界或未对齐时返回NULL
+static const CacheBlockHeader* record_block(const LyricsTimelineCache *cache, const LyricsTimelineCacheRecord *record) {
+    gsize length = g_mapped_file_get_length(cache->mapping);
+    if ((record->offset & 7) != 0 || record->size < sizeof(CacheBlockHeader) ||
+        record->offset > length || record->size > length - record->offset) {
+        return NULL;
+    }
+    const CacheBlockHeader *header =
+        (const CacheBlockHeader *)(g_mapped_file_get_contents(cache->mapping) + record->offset);
+    guint64 size = block_size(header);
+    return size > 0 && size <= record->size ? header : NULL;
+}
+
+// 检查数据块中的行和音节：范围都在各自的数组和文本内，行按开始时间排序（二分查找依赖这一点）
+static gboolean check_lines(const CacheBlockHeader *header, const LyricsLine *lines, const LyricsSyllable *syllables) {
+    for (guint i = 0; i < header->n_lines; i++) {
+        const LyricsLine *line = &lines[i];
+        if ((guint64)line->text_offset + line->text_length > header->text_len ||
+            (guint64)line->first_syllable + line->syllable_count > header->n_syllables ||
+            (guint64)line->source_offset + line->source_length > header->source_len) {
+            return FALSE;
+        }
+        if (i > 0 && line->start_ms < lines[i - 1].start_ms) {
+            return FALSE;
+        }
+        for (guint j = 0; j < line->syllable_count; j++) {
+            const LyricsSyllable *syllable = &syllables[line->first_syllable + j];
+            if ((guint64)syllable->byte_offset + syllable->byte_length > line->text_length) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+// 用映射中的数据块构建时间轴，数组和字符串都直接指向映射；
+// 身份键与 cache->key 不符时返回NULL，数据无效时同时记为 rejected
+static LyricsTimeline* map_block(LyricsTimelineCache *cache, const LyricsTimelineCacheRecord *record) {
+    const CacheBlockHeader *header = record_block(cache, record);
+    if (!header) {
+        cache->stats.rejected++;
+        return NULL;
+    }
+
+    const gchar *p = (const gchar *)(header + 1);
+    const LyricsLine *lines = (const LyricsLine *)p;
+    p += (gsize)header->n_lines * sizeof(LyricsLine);
+    const LyricsSyllable *syllables = (const LyricsSyllable *)p;
+    p += (gsize)header->n_syllables * sizeof(LyricsSyllable);
+    const gchar *key = p;
+    p += header->key_len + 1;
+    const gchar *song = p;
+    p += header->song_len + 1;
+    const gchar *format = p;
+    p += header->format_len + 1;
+    const gchar *text = p;
+    p += header->text_len + 1;
+    const gchar *source = p;
+
+    if (header->key_len != cache->key->len || memcmp(key, cache->key->str, cache->key->len + 1) != 0) {
+        return NULL;
+    }
+    if (song[header->song_len] != '\0' || format[header->format_len] != '\0' ||
+        text[header->text_len] != '\0' || source[header->source_len] != '\0') {
+        cache->stats.rejected++;
+        return NULL;
+    }
+    if (!check_lines(header, lines, syllables)) {
+        cache->stats.rejected++;
+        return NULL;
+    }
+
+    LyricsTimeline *timeline = g_new0(LyricsTimeline, 1);
+    timeline->song = (gchar *)song;
+    timeline->format = (gchar *)format;
+    timeline->lines = (LyricsLine *)lines;
+    timeline->n_lines = header->n_lines;
+    timeline->syllables = (LyricsSyllable *)syllables;
+    timeline->n_syllables = header->n_syllables;
+    timeline->text = (gchar *)text;
+    timeline->text_len = header->text_len;
+    timeline->source = (gchar *)source;
+    timeline->source_len = header->source_len;
+    timeline->ref_count = 1;
+    timeline->mapping = g_mapped_file_ref(cache->mapping);
+    return timeline;
+}
+
+// 映射缓存文件并检查文件头，文件不存在或无效时只使用内存
+static void map_file(LyricsTimelineCache *cache) {
+    GMappedFile *mapping = g_mapped_file_new(cache->path, FALSE, NULL);
+    if (!mapping) {
+        return;
+    }
+
+    gsize length = g_mapped_file_get_length(mapping);
+    const CacheFileHeader *header = (const CacheFileHeader *)g_mapped_file_get_contents(mapping);
+    if (length < sizeof(CacheFileHeader) || header->magic != CACHE_MAGIC || header->version != CACHE_VERSION ||
+        header->byte_order != CACHE_BYTE_ORDER || header->line_size != sizeof(LyricsLine) ||
+        header->syllable_size != sizeof(LyricsSyllable) ||
+        header->n_records > (length - sizeof(CacheFileHeader)) / sizeof(LyricsTimelineCacheRecord)) {
+        cache->stats.rejected++;
+        g_mapped_file_unref(mapping);
+        return;
+    }
+
+    cache->mapping = mapping;
+    cache->records = (const LyricsTimelineCacheRecord *)(header + 1);
+    cache->n_records = header->n_records;
+}
+
+void lyrics_timeline_cache_init(LyricsTimelineCache *cache, guint capacity, const gchar *path) {
+    memset(cache, 0, sizeof(LyricsTimelineCache));
+    cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, entry_free);
+    g_queue_init(&cache->lru);
+    cache->capacity = MAX(capacity, 1);
+    cache->key = g_string_sized_new(256);
+    cache->path = g_strdup(path);
+    cache->pending = g_byte_array_new();
+    cache->pending_records = g_array_new(FALSE, FALSE, sizeof(LyricsTimelineCacheRecord));
+    if (cache->path) {
+        map_file(cache);
+    }
+}
+
+void lyrics_timeline_cache_clear(LyricsTimelineCache *cache) {
+    if (!cache->entries) {
+        return;
+    }
+    g_queue_init(&cache->lru);
+    g_hash_table_destroy(cache->entries);
+    g_string_free(cache->key, TRUE);
+    g_free(cache->path);
+    g_byte_array_free(cache->pending, TRUE);
+    g_array_free(cache->pending_records, TRUE);
+    // 仍在使用的映射时间轴各自持有映射的引用
+    if (cache->mapping) {
+        g_mapped_file_unref(cache->mapping);
+    }
+    cache->entries = NULL;
+    cache->key = NULL;
+    cache->path = NULL;
+    cache->pending = NULL;
+    cache->pending_records = NULL;
+    cache->mapping = NULL;
+    cache->records = NULL;
+    cache->n_records = 0;
+}
+
+LyricsTimeline* lyrics_timeline_cache_lookup(LyricsTimelineCache *cache, const gchar *song, const gchar *artist,
+                                             const gchar *format, const gchar *document, gsize len) {
+    if (!cache->entries || !document || len == 0) {
+        return NULL;
+    }
+    cache->stats.lookups++;
+
+    guint64 hash = build_key(cache, song, artist, format, document, len);
+    LyricsTimelineCacheEntry *entry = g_hash_table_lookup(cache->entries, cache->key->str);
+    if (entry && same_document(entry->timeline, document, len)) {
+        g_queue_unlink(&cache->lru, &entry->link);
+        g_queue_push_head_link(&cache->lru, &entry->link);
+        cache->stats.hits++;
+        return lyrics_timeline_ref(entry->timeline);
+    }
+
+    for (guint i = 0; i < cache->n_records; i++) {
+        if (cache->records[i].hash != hash) {
+            continue;
+        }
+        LyricsTimeline *timeline = map_block(cache, &cache->records[i]);
+        if (!timeline) {
+            continue;
+        }
+        if (!same_document(timeline, document, len)) {
+            lyrics_timeline_free(timeline);
+            continue;
+        }
+
+        // 移到内存中，文件中的使用顺序随之改变
+        entry_add(cache, hash, timeline);
+        cache->dirty = TRUE;
+        cache->stats.disk_hits++;
+        return lyrics_timeline_ref(timeline);
+    }
+
+    cache->stats.misses++;
+    return NULL;
+}
+
+void lyrics_timeline_cache_insert(LyricsTimelineCache *cache, const gchar *song, const gchar *artist,
+                                  const gchar *format, LyricsTimeline *timeline) {
+    if (!cache->entries || !timeline || !timeline->source) {
+        return;
+    }
+    guint64 hash = build_key(cache, song, artist, format, timeline->source, timeline->source_len);
+    entry_add(cache, hash, lyrics_timeline_ref(timeline));
+    cache->dirty = TRUE;
+}
+
+// 序列化一个时间轴，追加到 blocks
+static void append_block(GByteArray *blocks, const gchar *key, const LyricsTimeline *timeline) {
+    CacheBlockHeader header = {0};
+    header.n_lines = timeline->n_lines;
+    header.n_syllables = timeline->n_syllables;
+    header.key_len = strlen(key);
+    header.song_len = strlen(timeline->song);
+    header.format_len = strlen(timeline->format);
+    header.text_len = timeline->text_len;
+    header.source_len = timeline->source_len;
+
+    static const guint8 padding[8] = {0};
+    gsize start = blocks->len;
+    g_byte_array_append(blocks, (const guint8 *)&header, sizeof(header));
+    g_byte_array_append(blocks, (const guint8 *)timeline->lines, timeline->n_lines * sizeof(LyricsLine));
+    g_byte_array_append(blocks, (const guint8 *)timeline->syllables, timeline->n_syllables * sizeof(LyricsSyllable));
+    g_byte_array_append(blocks, (const guint8 *)key, header.key_len + 1);
+    g_byte_array_append(blocks, (const guint8 *)timeline->song, header.song_len + 1);
+    g_byte_array_append(blocks, (const guint8 *)timeline->format, header.format_len + 1);
+    g_byte_array_append(blocks, (const guint8 *)timeline->text, timeline->text_len);
+    g_byte_array_append(blocks, padding, 1);
+    g_byte_array_append(blocks, (const guint8 *)timeline->source, timeline->source_len);
+    g_byte_array_append(blocks, padding, 1);
+    g_byte_array_append(blocks, padding, align8(blocks->len - start) - (blocks->len - start));
+}
+
+// 淘汰出内存的时间轴序列化后留到写回时，超出文件大小限制时丢弃最早淘汰的
+static void keep_pending(LyricsTimelineCache *cache, const LyricsTimelineCacheEntry *entry) {
+    if (!cache->path) {
+        return;
+    }
+
+    gsize start = cache->pending->len;
+    append_block(cache->pending, entry->key, entry->timeline);
+    LyricsTimelineCacheRecord record = {entry->hash, start, cache->pending->len - start};
+    g_array_append_val(cache->pending_records, record);
+
+    while (cache->pending_records->len > 1 &&
+           (cache->pending_records->len > LYRICS_TIMELINE_CACHE_DISK_ENTRIES ||
+            cache->pending->len > LYRICS_TIMELINE_CACHE_DISK_BYTES)) {
+        guint64 size = g_array_index(cache->pending_records, LyricsTimelineCacheRecord, 0).size;
+        g_byte_array_remove_range(cache->pending, 0, size);
+        g_array_remove_index(cache->pending_records, 0);
+        for (guint i = 0; i < cache->pending_records->len; i++) {
+            g_array_index(cache->pending_records, LyricsTimelineCacheRecord, i).offset -= size;
+        }
+        cache->stats.dropped++;
+    }
+}
+
+// 在大小限制内加入一条记录，超出时返回FALSE
+static gboolean add_record(GArray *records, GByteArray *blocks, guint64 hash, gsize start) {
+    if (records->len >= LYRICS_TIMELINE_CACHE_DISK_ENTRIES || blocks->len > LYRICS_TIMELINE_CACHE_DISK_BYTES) {
+        g_byte_array_set_size(blocks, start);
+        return FALSE;
+    }
+    LyricsTimelineCacheRecord record = {hash, start, blocks->len - start};
+    g_array_append_val(records, record);
+    return TRUE;
+}
+
+static gboolean has_record(GArray *records, guint64 hash) {
+    for (guint i = 0; i < records->len; i++) {
+        if (g_array_index(records, LyricsTimelineCacheRecord, i).hash == hash) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+gboolean lyrics_timeline_cache_save(LyricsTimelineCache *cache) {
+    if (!cache->entries || !cache->path || !cache->dirty) {
+        return TRUE;
+    }
+
+    GArray *records = g_array_new(FALSE, FALSE, sizeof(LyricsTimelineCacheRecord));
+    GByteArray *blocks = g_byte_array_new();
+    guint64 dropped = 0;
+
+    // 先是内存中的时间轴（最近使用在前），然后是淘汰出内存的（最近淘汰在前），
+    // 最后是文件中本次没有用到的记录，保持原来的顺序
+    for (GList *link = cache->lru.head; link; link = link->next) {
+        LyricsTimelineCacheEntry *entry = (LyricsTimelineCacheEntry *)link->data;
+        gsize start = blocks->len;
+        append_block(blocks, entry->key, entry->timeline);
+        if (!add_record(records, blocks, entry->hash, start)) {
+            dropped++;
+        }
+    }
+    for (guint i = cache->pending_records->len; i-- > 0;) {
+        const LyricsTimelineCacheRecord *record = &g_array_index(cache->pending_records, LyricsTimelineCacheRecord, i);
+        if (has_record(records, record->hash)) {
+            continue;
+        }
+        gsize start = blocks->len;
+        g_byte_array_append(blocks, cache->pending->data + record->offset, record->size);
+        if (!add_record(records, blocks, record->hash, start)) {
+            dropped++;
+        }
+    }
+    for (guint i = 0; i < cache->n_records; i++) {
+        const LyricsTimelineCacheRecord *record = &cache->records[i];
+        const CacheBlockHeader *header = record_block(cache, record);
+        if (!header || has_record(records, record->hash)) {
+            continue;
+        }
+        gsize start = blocks->len;
+        g_byte_array_append(blocks, (const guint8 *)header, block_size(header));
+        if (!add_record(records, blocks, record->hash, start)) {
+            dropped++;
+        }
+    }
+
+    CacheFileHeader header = {0};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.line_size = sizeof(LyricsLine);
+    header.syllable_size = sizeof(LyricsSyllable);
+    header.n_records = records->len;
+
+    // 数据块偏移改为相对文件开头
+    gsize data_start = sizeof(CacheFileHeader) + records->len * sizeof(LyricsTimelineCacheRecord);
+    for (guint i = 0; i < records->len; i++) {
+        g_array_index(records, LyricsTimelineCacheRecord, i).offset += data_start;
+    }
+
+    GByteArray *file = g_byte_array_new();
+    g_byte_array_append(file, (const guint8 *)&header, sizeof(header));
+    g_byte_array_append(file, (const guint8 *)records->data, records->len * sizeof(LyricsTimelineCacheRecord));
+    g_byte_array_append(file, blocks->data, blocks->len);
+
+    gboolean ok = g_file_set_contents(cache->path, (const gchar *)file->data, file->len, NULL);
+    if (ok) {
+        cache->dirty = FALSE;
+        cache->stats.saved = records->len;
+        cache->stats.dropped += dropped;
+    }
+
+    g_byte_array_free(file, TRUE);
+    g_byte_array_free(blocks, TRUE);
+    g_array_free(records, TRUE);
+    return ok;
+}
@@ -0,0 +1,93 @@
+#ifndef OSD_LYRICS_TIMELINE_CACHE_H
+#define OSD_LYRICS_TIMELINE_CACHE_H
+
+#include <glib.h>
+#include "osd_lyrics_timeline.h"
+
+// 解析好的整首歌词时间轴缓存
+// 按歌曲身份（歌曲名、歌手、格式和文档内容的哈希）缓存，分两级：
+// 内存中是LRU，重复播放同一首歌直接取回时间轴；
+// 退出时按最近使用顺序写入配置目录下的二进制文件，下次启动只读映射，
+// 命中时时间轴的行、音节和文本直接指向映射的数据，不需要解析和复制
+//
+// 文件使用本机字节序，文件头记录版本号、字节序标记和结构体大小，不一致时整个文件作废
+
+// 缓存文件名（在配置目录中）
+#define LYRICS_TIMELINE_CACHE_FILE "timeline_cache.bin"
+// 内存中保留的时间轴数
+#define LYRICS_TIMELINE_CACHE_MEMORY_SIZE 16
+// 缓存文件最多保存的歌曲数和字节数，超出时丢弃最久未使用的
+#define LYRICS_TIMELINE_CACHE_DISK_ENTRIES 256
+#define LYRICS_TIMELINE_CACHE_DISK_BYTES (8 * 1024 * 1024)
+
+typedef struct _LyricsTimelineCacheEntry LyricsTimelineCacheEntry;
+typedef struct _LyricsTimelineCacheRecord LyricsTimelineCacheRecord;
+
+// 缓存统计
+typedef struct {
+    guint64 lookups;         // 查找次数
+    guint64 hits;            // 内存命中
+    guint64 disk_hits;       // 缓存文件命中
+    guint64 misses;          // 需要解析
+    guint64 evictions;       // 超出内存容量淘汰的条目（转为等待写回）
+    guint64 saved;           // 最近一次写入文件的歌曲数
+    guint64 dropped;         // 超出文件大小限制丢弃的歌曲数
+    guint64 rejected;        // 文件或记录无效
+} LyricsTimelineCacheStats;
+
+typedef struct {
+    GHashTable *entries;     // 身份键 -> 条目
+    GQueue lru;              // 表头为最近使用
+    guint capacity;
+    GString *key;            // 复用的查找键
+
+    gchar *path;             // 缓存文件路径，NULL表示只使用内存
+    GMappedFile *mapping;    // 启动时映射的缓存文件
+    const LyricsTimelineCacheRecord *records; // 映射中的索引
+    guint n_records;
+    GByteArray *pending;     // 淘汰出内存、等待写回文件的时间轴（已序列化，按淘汰顺序）
+    GArray *pending_records; // pending 中的记录，偏移相对于 pending
+    gboolean dirty;          // 有新解析的时间轴或使用顺序变化，需要写回
+
+    LyricsTimelineCacheStats stats;
+} LyricsTimelineCache;
+
+/**
+ * 初始化缓存，映射已有的缓存文件
+ * @param capacity 内存中最多保留的时间轴数
+ * @param path 缓存文件路径，NULL表示不读写文件
+ */
+void lyrics_timeline_cache_init(LyricsTimelineCache *cache, guint capacity, const gchar *path);
+
+/**
+ * 释放所有时间轴和映射（不写回文件）
+ */
+void lyrics_timeline_cache_clear(LyricsTimelineCache *cache);
+
+/**
+ * 查找整首歌词文档对应的时间轴，先查内存再查缓存文件
+ * @param song 歌曲名
+ * @param artist 歌手，可以为NULL
+ * @param format 歌词格式
+ * @param document 文档内容
+ * @param len 文档长度
+ * @return 时间轴（新增的引用，用 lyrics_timeline_free 释放），未命中返回NULL
+ */
+LyricsTimeline* lyrics_timeline_cache_lookup(LyricsTimelineCache *cache, const gchar *song, const gchar *artist,
+                                             const gchar *format, const gchar *document, gsize len);
+
+/**
+ * 加入刚从文档解析出的时间轴（增加引用），超出容量时淘汰最久未使用的条目
+ * 时间轴的 source 必须是解析时的原始文档
+ */
+void lyrics_timeline_cache_insert(LyricsTimelineCache *cache, const gchar *song, const gchar *artist,
+                                  const gchar *format, LyricsTimeline *timeline);
+
+/**
+ * 有变化时把内存中的时间轴、淘汰出内存的时间轴和文件中其余的记录按最近使用顺序写回缓存文件
+ * 写入临时文件后替换，已映射的旧文件在最后一个引用释放前保持有效
+ * @return 写入成功或无需写入时返回TRUE
+ */
+gboolean lyrics_timeline_cache_save(LyricsTimelineCache *cache);
+
+#endif // OSD_LYRICS_TIMELINE_CACHE_H
@@ -0,0 +1,162 @@
+#ifndef OSD_LYRICS_WIPE_H
+#define OSD_LYRICS_WIPE_H
+
+#include <gtk/gtk.h>
+#include "osd_lyrics_timeline.h"
+#include "osd_lyrics_layout_cache.h"
+
+// 卡拉OK擦除效果
+// 自绘控件：每行只创建一次PangoLayout（纯文本，不解析标记，反复出现的行从LRU缓存取回），
+// 绘制时同一布局画两遍，已唱颜色裁剪到按音节开始时间和时长插值出的x坐标，可以停在字形中间。
+// 由帧时钟的tick回调驱动，每帧只改变裁剪位置，只重绘裁剪位置移过的一段字形；整行唱完或暂停时停止tick
+// 没有逐字时间的行按整行已唱显示
+//
+// 每行按当前大小、颜色和文字样式（阴影或描边）栅格化为已唱、未唱两张离屏图，每帧只是两次裁剪贴图；
+// 已知下一行时在空闲时提前排版和栅格化，到换行时直接交换，换行的关键路径上不再有排版和字形绘制
+
+// 缓存的布局数，足够覆盖一首歌中反复出现的行
+#define KARAOKE_WIPE_LAYOUT_CACHE_SIZE 64
+
+// 描边样式的描边宽度（像素，一半在字形外）
+#define KARAOKE_WIPE_OUTLINE_WIDTH 3.0
+
+// 文字样式
+typedef enum {
+    KARAOKE_WIPE_STYLE_SHADOW,   // 与标签相同的浅色阴影（向下偏移1像素，不模糊）
+    KARAOKE_WIPE_STYLE_OUTLINE   // 深色描边加填充，在任意桌面背景上都清晰
+} KaraokeWipeTextStyle;
+
+// 行内进度，now 为单调时钟毫秒
+typedef gint64 (*KaraokeWipeProgressFunc)(gint64 now, gpointer user_data);
+
+// 一个音节在布局中的水平范围
+typedef struct {
+    gint64 start_ms;         // 相对于行开始的时间
+    gint64 duration_ms;
+    guint byte_offset;       // 在纯文本中的偏移
+    gdouble x_start;         // 布局坐标，像素
+    gdouble x_end;
+} KaraokeWipeSyllable;
+
+// 一行的离屏栅格
+typedef struct {
+    PangoLayout *layout;     // 栅格化的布局（持有引用），NULL表示无效
+    cairo_surface_t *played; // 整行以已唱颜色绘制
+    cairo_surface_t *unplayed;
+    gint width;              // 栅格化时的控件大小
+    gint height;
+    GdkRGBA played_color;
+} KaraokeWipeRaster;
+
+// 绘制统计
+typedef struct {
+    guint64 lines;           // 开始显示的行数
+    guint64 layouts;         // 计算字形位置的次数（换行、字体或宽度变化）
+    guint64 ticks;           // tick回调次数
+    guint64 draws;           // 绘制次数
+    guint64 idle_ticks;      // 裁剪位置没变而没有重绘的tick
+    guint64 rasters;         // 在绘制时栅格化的次数
+    guint64 prepared;        // 空闲时预先栅格化的下一行
+    guint64 swaps;           // 换行时直接使用预先栅格化的结果
+    guint64 switches;        // 计时的换行次数
+    gint64 total_switch_us;  // 从计划换行时间到绘制完成的累计延迟
+    gint64 max_switch_us;
+    guint64 damage_pixels;   // 实际重绘的像素数
+    guint64 full_pixels;     // 每次绘制都重绘整个控件时的像素数
+    gint64 total_draw_us;    // 绘制回调的累计耗时（含绘制时的栅格化）
+    gint64 max_draw_us;
+    gint64 total_raster_us;  // 栅格化的累计耗时（含空闲时预先栅格化）
+} KaraokeWipeStats;
+
+typedef struct {
+    GtkWidget *widget;       // GtkDrawingArea，由所在容器负责销毁
+    PangoLayout *layout;     // 当前行，跨帧复用（持有引用）
+    LyricsLayoutCache layouts; // 按行文本缓存的布局，字体变化时失效
+    KaraokeWipeSyllable *syllables;
+    guint n_syllables;
+    guint syllables_cap;
+    gboolean positions_valid; // 字形位置是否与当前布局宽度和字体一致
+    gint layout_width;       // 上次计算位置时的控件宽度
+    gint text_height;        // 布局的逻辑高度，栅格中文本垂直居中
+    gdouble ink_top;         // 字形（含阴影）相对布局顶部的垂直范围，用于限制重绘区域
+    gdouble ink_bottom;
+
+    KaraokeWipeRaster raster; // 当前行
+    KaraokeWipeRaster next;  // 预先栅格化的下一行
+    GString *next_text;      // 等待预先栅格化的下一行文本
+    guint prepare_id;        // 空闲回调
+    gint64 switch_scheduled_us; // 等待绘制的换行的计划时间，0表示没有
+
+    gdouble wipe_x;          // 当前裁剪位置（布局坐标，像素）
+    gdouble drawn_x;         // 上次绘制时的裁剪位置，<0表示还没有绘制
+    guint tick_id;
+    GdkRGBA played_color;
+    GdkRGBA unplayed_color;
+    KaraokeWipeTextStyle style;
+
+    KaraokeWipeProgressFunc progress_func;
+    gpointer user_data;
+
+    KaraokeWipeStats stats;
+} KaraokeWipe;
+
+/**
+ * 创建擦除控件
+ * @param progress_func 行内进度回调，在tick和同步时调用
+ * @param user_data 回调用户数据
+ * @return 新控件，用 karaoke_wipe_free 释放
+ */
+KaraokeWipe* karaoke_wipe_new(KaraokeWipeProgressFunc progress_func, gpointer user_data);
+
+/**
+ * 停止tick并释放资源（控件本身随窗口销毁）
+ */
+void karaoke_wipe_free(KaraokeWipe *wipe);
+
+/**
+ * 设置当前行，从缓存取回布局，未命中时才排版
+ * @param text 行的纯文本
+ * @param text_len 文本长度
+ * @param syllables 逐字时间（byte_offset 相对于 text，按顺序且不重叠）
+ * @param n_syllables 音节数，0表示整行已唱
+ */
+void karaoke_wipe_set_line(KaraokeWipe *wipe, const gchar *text, gsize text_len,
+                           const LyricsSyllable *syllables, guint n_syllables);
+
+/**
+ * 预告下一行，在空闲时提前排版和栅格化；之后 karaoke_wipe_set_line 设置同一文本时直接交换
+ * @param text 下一行的纯文本
+ * @param text_len 文本长度
+ */
+void karaoke_wipe_prepare(KaraokeWipe *wipe, const gchar *text, gsize text_len);
+
+/**
+ * 记录刚发生的换行的计划时间，下一次绘制完成时统计换行延迟
+ * @param scheduled_us 计划换行时间（单调时钟，微秒）
+ */
+void karaoke_wipe_note_switch(KaraokeWipe *wipe, gint64 scheduled_us);
+
+/**
+ * 设置文字样式，已栅格化的行按新样式重新栅格化
+ * 描边样式每行只用 pango_cairo_layout_path 生成一次字形轮廓，已唱、未唱两张栅格共用
+ */
+void karaoke_wipe_set_style(KaraokeWipe *wipe, KaraokeWipeTextStyle style);
+
+/**
+ * 设置已唱部分的颜色
+ */
+void karaoke_wipe_set_played_color(KaraokeWipe *wipe, const GdkRGBA *color);
+
+/**
+ * 按当前进度更新裁剪位置，并启动或停止tick
+ * 播放时钟暂停、跳转或变速后调用
+ * @param playing 是否在播放；暂停时只重绘当前位置
+ */
+void karaoke_wipe_sync(KaraokeWipe *wipe, gboolean playing);
+
+/**
+ * 停止tick（切换到非逐字显示时调用）
+ */
+void karaoke_wipe_stop(KaraokeWipe *wipe);
+
+#endif // OSD_LYRICS_WIPE_H
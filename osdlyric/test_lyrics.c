@@ -0,0 +1,1785 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+#include <gtk/gtk.h>
+#include <pango/pangocairo.h>
+#include "osd_lyrics.h"
+#include "osd_lyrics_sse.h"
+#include "osd_lyrics_event.h"
+#include "osd_lyrics_timeline.h"
+#include "osd_lyrics_compact.h"
+#include "osd_lyrics_clock.h"
+#include "osd_lyrics_karaoke.h"
+#include "osd_lyrics_timeline_cache.h"
+#include "osd_lyrics_layout_cache.h"
+#include "osd_lyrics_wipe.h"
+#include "osd_lyrics_client.h"
+#include "osd_lyrics_queue.h"
+#include "test_sse_server.h"
+
+// OSD歌词单元测试（GLib测试框架），运行：make run-test
+
+// ---- 堆分配计数 ----
+
+#ifdef __GLIBC__
+// 覆盖malloc/calloc/realloc并转发给glibc的实现（g_malloc等也经过这里），
+// 只统计测试线程在计数期间的分配，GTK等其他线程不受影响
+#define HAVE_ALLOCATION_COUNTER 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static __thread gboolean counting_allocations;
+static guint64 allocation_count;
+
+void *malloc(size_t size) {
+    if (counting_allocations) {
+        allocation_count++;
+    }
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    if (counting_allocations) {
+        allocation_count++;
+    }
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (counting_allocations) {
+        allocation_count++;
+    }
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+// 开始统计本线程的堆分配
+static void allocations_begin(void) {
+#ifdef HAVE_ALLOCATION_COUNTER
+    allocation_count = 0;
+    counting_allocations = TRUE;
+#endif
+}
+
+// 结束统计，返回期间的分配次数；不支持统计时返回0
+static guint64 allocations_end(void) {
+#ifdef HAVE_ALLOCATION_COUNTER
+    counting_allocations = FALSE;
+    return allocation_count;
+#else
+    return 0;
+#endif
+}
+
+// ---- KRC逐字高亮 ----
+
+// 测试行：第一个音节之前有不计时的文本，音节中包含需要转义的字符
+#define KARAOKE_PREFIX "♪ "
+#define KARAOKE_SYLLABLE_MS 300
+
+static const gchar *karaoke_pieces[] = {"<你>", "好 ", "& ", "世", "界"};
+
+// 拼出整行文本和逐字时间，每个音节 KARAOKE_SYLLABLE_MS
+static GString* build_karaoke_line(LyricsSyllable *syllables) {
+    GString *text = g_string_new(KARAOKE_PREFIX);
+    for (guint i = 0; i < G_N_ELEMENTS(karaoke_pieces); i++) {
+        syllables[i].start_ms = (gint64)i * KARAOKE_SYLLABLE_MS;
+        syllables[i].duration_ms = KARAOKE_SYLLABLE_MS;
+        syllables[i].byte_offset = text->len;
+        syllables[i].byte_length = strlen(karaoke_pieces[i]);
+        g_string_append(text, karaoke_pieces[i]);
+    }
+    return text;
+}
+
+// 在每个音节边界前后刷新：分界移动时输出标记，没移动时返回NULL；
+// 第一轮之后缓冲区不再扩容，设置新行和刷新都没有堆分配
+static void test_karaoke_steady_state(void) {
+    LyricsSyllable syllables[G_N_ELEMENTS(karaoke_pieces)];
+    GString *text = build_karaoke_line(syllables);
+    guint n = G_N_ELEMENTS(karaoke_pieces);
+    KaraokeLine line;
+    guint64 warm_growths = 0;
+
+    karaoke_line_init(&line);
+    for (guint round = 0; round < 100; round++) {
+        if (round > 0) {
+            allocations_begin();
+        }
+        karaoke_line_set(&line, text->str, text->len, syllables, n);
+
+        // 新的一行总是输出，之后进度还在第一个音节之前时分界不变
+        g_assert_nonnull(karaoke_line_render(&line, -1, "#ff0000"));
+        g_assert_null(karaoke_line_render(&line, -1, "#ff0000"));
+
+        for (guint i = 0; i < n; i++) {
+            gint64 start = syllables[i].start_ms;
+            g_assert_cmpuint(karaoke_line_played_count(&line, start - 1), ==, i);
+            g_assert_cmpuint(karaoke_line_played_count(&line, start), ==, i + 1);
+
+            g_assert_nonnull(karaoke_line_render(&line, start, "#ff0000"));
+            g_assert_null(karaoke_line_render(&line, start + KARAOKE_SYLLABLE_MS / 2, "#ff0000"));
+            g_assert_null(karaoke_line_render(&line, start + KARAOKE_SYLLABLE_MS - 1, "#ff0000"));
+        }
+
+        // 唱完后继续刷新不再输出，只有颜色变化才重新生成
+        g_assert_null(karaoke_line_render(&line, (gint64)n * KARAOKE_SYLLABLE_MS * 2, "#ff0000"));
+        g_assert_nonnull(karaoke_line_render(&line, (gint64)n * KARAOKE_SYLLABLE_MS * 2, "#00ff00"));
+
+        if (round == 0) {
+            warm_growths = line.stats.growths;
+        } else {
+            g_assert_cmpuint(allocations_end(), ==, 0);
+            g_assert_cmpuint(line.stats.growths, ==, warm_growths);
+        }
+    }
+
+    g_assert_cmpuint(line.stats.lines, ==, 100);
+    karaoke_line_clear(&line);
+    g_string_free(text, TRUE);
+}
+
+// 标记内容：已唱部分使用指定颜色，文本按Pango标记转义
+static void test_karaoke_markup(void) {
+    LyricsSyllable syllables[G_N_ELEMENTS(karaoke_pieces)];
+    GString *text = build_karaoke_line(syllables);
+    KaraokeLine line;
+
+    karaoke_line_init(&line);
+    karaoke_line_set(&line, text->str, text->len, syllables, G_N_ELEMENTS(karaoke_pieces));
+
+    // 第一个音节之前的文本视为已唱
+    g_assert_cmpstr(karaoke_line_render(&line, -1, "#ff0000"), ==,
+                    "<span foreground=\"#ff0000\">♪ </span>"
+                    "<span foreground=\"#666666\">&lt;你&gt;好 &amp; 世界</span>");
+    g_assert_cmpstr(karaoke_line_render(&line, KARAOKE_SYLLABLE_MS, "#ff0000"), ==,
+                    "<span foreground=\"#ff0000\">♪ &lt;你&gt;好 </span>"
+                    "<span foreground=\"#666666\">&amp; 世界</span>");
+    g_assert_cmpstr(karaoke_line_render(&line, 10 * KARAOKE_SYLLABLE_MS, "#ff0000"), ==,
+                    "<span foreground=\"#ff0000\">♪ &lt;你&gt;好 &amp; 世界</span>");
+
+    // 没有逐字时间的行整行视为已唱
+    karaoke_line_set(&line, "a&b", 3, NULL, 0);
+    g_assert_cmpstr(karaoke_line_render(&line, 0, "#ff0000"), ==, "<span foreground=\"#ff0000\">a&amp;b</span>");
+
+    karaoke_line_clear(&line);
+    g_string_free(text, TRUE);
+}
+
+// ---- SSE帧解析 ----
+
+// 每个事件记为 "事件类型|数据|ID"，多个事件以'\n'分隔（数据中的换行显示为'/'）
+static void collect_sse_event(SSEEvent *event, gpointer user_data) {
+    GString *log = (GString *)user_data;
+    if (log->len > 0) {
+        g_string_append_c(log, '\n');
+    }
+    g_string_append_printf(log, "%s|", event->event);
+    for (gsize i = 0; i < event->data_len; i++) {
+        g_string_append_c(log, event->data[i] == '\n' ? '/' : event->data[i]);
+    }
+    g_string_append_printf(log, "|%s", event->id);
+}
+
+typedef struct {
+    const gchar *name;
+    const gchar *chunks[6];  // 依次输入的数据块，以NULL结束
+    const gchar *expected;
+} SSECase;
+
+static const SSECase sse_cases[] = {
+    {"simple", {"data: a\n\n", NULL}, "message|a|"},
+    {"split-mid-line", {"da", "ta: hel", "lo\n", "\n", NULL}, "message|hello|"},
+    {"split-field-name", {"ev", "ent: x\nda", "ta: 1\n\n", NULL}, "x|1|"},
+    {"multi-line-data", {"data: 1\ndata: 2\n\n", NULL}, "message|1/2|"},
+    {"crlf", {"event: x\r\ndata: 1\r\ndata: 2\r\n\r\n", NULL}, "x|1/2|"},
+    {"cr", {"data: a\r\rdata: b\r\r", NULL}, "message|a|\nmessage|b|"},
+    // 跨块的"\r\n"只是一个行结束符，不能当作空行提前分发
+    {"crlf-split", {"data: a\r", "\ndata: b\r", "\n\r", "\n", NULL}, "message|a/b|"},
+    {"mixed-endings", {"data: a\n", "data: b\r\n", "data: c\r", "\r\n", NULL}, "message|a/b/c|"},
+    {"bom", {"\xEF\xBB\xBF" "data: a\n\n", NULL}, "message|a|"},
+    {"bom-split", {"\xEF", "\xBB\xBF" "da", "ta: a\n\n", NULL}, "message|a|"},
+    // 只有流开头的BOM会被去掉
+    {"bom-not-first-line", {"data: a\n\n\xEF\xBB\xBF" "data: b\n\n", NULL}, "message|a|"},
+    {"no-space", {"data:a\n\n", NULL}, "message|a|"},
+    {"two-spaces", {"data:  a\n\n", NULL}, "message| a|"},
+    {"comment", {": keepalive\n\ndata: a\n\n", NULL}, "message|a|"},
+    {"event-without-data", {"event: x\n\ndata: a\n\n", NULL}, "message|a|"},
+    {"event-name-reset", {"event: x\ndata: 1\n\ndata: 2\n\n", NULL}, "x|1|\nmessage|2|"},
+    {"empty-data-field", {"data\n\n", NULL}, "message||"},
+    {"id", {"id: 7\ndata: a\n\ndata: b\n\n", NULL}, "message|a|7\nmessage|b|7"},
+    {"unknown-field", {"foo: bar\ndata: a\n\n", NULL}, "message|a|"},
+    {"incomplete", {"data: a\n", "data: b", NULL}, ""},
+};
+
+static void test_sse_cases(void) {
+    for (guint i = 0; i < G_N_ELEMENTS(sse_cases); i++) {
+        const SSECase *test_case = &sse_cases[i];
+        GString *log = g_string_new(NULL);
+        SSEParser parser;
+
+        g_test_message("SSE: %s", test_case->name);
+        sse_parser_init(&parser, collect_sse_event, log);
+        for (guint j = 0; test_case->chunks[j]; j++) {
+            sse_parser_feed(&parser, test_case->chunks[j], strlen(test_case->chunks[j]));
+        }
+        g_assert_cmpstr(log->str, ==, test_case->expected);
+
+        sse_parser_clear(&parser);
+        g_string_free(log, TRUE);
+    }
+}
+
+// 同一段数据以任意位置切分，结果都与整块输入相同
+static void test_sse_every_split(void) {
+    static const gchar stream[] = "\xEF\xBB\xBF" "id: 1\r\nevent: lyrics\r\ndata: {\"a\":1}\r\n\r\n"
+                                  ": ping\n\ndata: x\rdata: y\r\r";
+    gsize len = sizeof(stream) - 1;
+    GString *whole = g_string_new(NULL);
+    SSEParser parser;
+
+    sse_parser_init(&parser, collect_sse_event, whole);
+    sse_parser_feed(&parser, stream, len);
+    sse_parser_clear(&parser);
+    g_assert_cmpstr(whole->str, ==, "lyrics|{\"a\":1}|1\nmessage|x/y|1");
+
+    for (gsize split = 1; split < len; split++) {
+        GString *log = g_string_new(NULL);
+        sse_parser_init(&parser, collect_sse_event, log);
+        sse_parser_feed(&parser, stream, split);
+        sse_parser_feed(&parser, stream + split, len - split);
+        g_assert_cmpstr(log->str, ==, whole->str);
+        sse_parser_clear(&parser);
+        g_string_free(log, TRUE);
+    }
+    g_string_free(whole, TRUE);
+}
+
+// retry: 只接受纯数字；reset 保留ID和retry，丢弃不完整的行
+static void test_sse_retry_and_reset(void) {
+    GString *log = g_string_new(NULL);
+    SSEParser parser;
+
+    sse_parser_init(&parser, collect_sse_event, log);
+    g_assert_cmpint(parser.retry_ms, ==, -1);
+    g_assert_null(sse_parser_get_last_id(&parser));
+
+    static const gchar input[] = "retry: 1500\nretry: 1x\nretry:\nid: 9\ndata: partial";
+    sse_parser_feed(&parser, input, sizeof(input) - 1);
+    g_assert_cmpint(parser.retry_ms, ==, 1500);
+    g_assert_cmpstr(sse_parser_get_last_id(&parser), ==, "9");
+
+    sse_parser_reset(&parser);
+    sse_parser_feed(&parser, "\n\ndata: b\n\n", 11);
+    g_assert_cmpstr(log->str, ==, "message|b|9");
+    g_assert_cmpint(parser.retry_ms, ==, 1500);
+
+    sse_parser_clear(&parser);
+    g_string_free(log, TRUE);
+}
+
+// ---- 事件JSON解码 ----
+
+typedef enum {
+    DECODE_FAST,       // 快速路径解码成功
+    DECODE_FALLBACK,   // 快速路径拒绝，json-c解码成功
+    DECODE_ERROR,      // 两条路径都拒绝
+    DECODE_NOT_FAST    // 快速路径拒绝，json-c对这类输入较宽松，不检查其结果
+} DecodeResult;
+
+typedef struct {
+    const gchar *json;
+    DecodeResult result;
+    LyricsEventType type;
+    const gchar *text;       // NULL表示不检查
+    gint64 position_ms;
+    gint paused;
+    gdouble rate;
+} DecodeCase;
+
+static const DecodeCase decode_cases[] = {
+    {"{\"type\":\"lyrics_update\",\"text\":\"[1000,500]<0,500,0>a\",\"songName\":\"s\",\"artist\":\"x\",\"format\":\"krc\"}",
+     DECODE_FAST, LYRICS_EVENT_LYRICS_UPDATE, "[1000,500]<0,500,0>a", -1, -1, 0},
+    {" { \"type\" : \"heartbeat\" } ", DECODE_FAST, LYRICS_EVENT_HEARTBEAT, "", -1, -1, 0},
+    {"{}", DECODE_FAST, LYRICS_EVENT_UNKNOWN, "", -1, -1, 0},
+    // 转义：\n、\"、\/、BMP字符和代理对
+    {"{\"type\":\"lyrics_update\",\"text\":\"a\\n\\\"q\\\"\\/\\u4f60\\ud83c\\udfb5\"}",
+     DECODE_FAST, LYRICS_EVENT_LYRICS_UPDATE, "a\n\"q\"/你🎵", -1, -1, 0},
+    // 播放状态
+    {"{\"type\":\"heartbeat\",\"position\":1234,\"paused\":false,\"rate\":1.5}",
+     DECODE_FAST, LYRICS_EVENT_HEARTBEAT, NULL, 1234, 0, 1.5},
+    {"{\"type\":\"heartbeat\",\"position\":1.5e3,\"paused\":true,\"rate\":2E0}",
+     DECODE_FAST, LYRICS_EVENT_HEARTBEAT, NULL, 1500, 1, 2.0},
+    {"{\"type\":\"heartbeat\",\"position\":0,\"extra\":-0.25e-1,\"flag\":null}",
+     DECODE_FAST, LYRICS_EVENT_HEARTBEAT, NULL, 0, -1, 0},
+    // 不合JSON语法的数字不能走快速路径
+    {"{\"type\":\"heartbeat\",\"position\":1-2}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":--1}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":1.}", DECODE_NOT_FAST, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":1e}", DECODE_NOT_FAST, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"extra\":-}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"rate\":1.5.5}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    // 超出整数范围或非有限的播放状态
+    {"{\"type\":\"heartbeat\",\"position\":1e18}", DECODE_FAST, LYRICS_EVENT_HEARTBEAT, NULL, 1000000000000000000LL, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":1e400}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":-1e400}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":-5}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":9223372036854775807}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"rate\":1e400}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    // 非法转义和控制字符
+    {"{\"type\":\"lyrics_update\",\"text\":\"a\\x\"}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"lyrics_update\",\"text\":\"a\\u12\"}", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"lyrics_update\",\"text\":\"a\tb\"}", DECODE_NOT_FAST, 0, NULL, -1, -1, 0},
+    // 结构错误
+    {"{\"type\":\"heartbeat\"} x", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",}", DECODE_NOT_FAST, 0, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\"", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"[1,2]", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    {"", DECODE_ERROR, 0, NULL, -1, -1, 0},
+    // 快速路径不支持的合法结构交给json-c
+    {"{\"type\":\"connected\",\"meta\":{\"a\":[1,2]}}", DECODE_FALLBACK, LYRICS_EVENT_CONNECTED, "", -1, -1, 0},
+    {"{\"type\":\"lyrics_update\",\"text\":\"a\\u0000b\"}", DECODE_FALLBACK, LYRICS_EVENT_LYRICS_UPDATE, "a", -1, -1, 0},
+    {"{\"ty\\u0070e\":\"heartbeat\"}", DECODE_FALLBACK, LYRICS_EVENT_HEARTBEAT, "", -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"position\":\"12\"}", DECODE_FALLBACK, LYRICS_EVENT_HEARTBEAT, NULL, -1, -1, 0},
+    {"{\"type\":\"heartbeat\",\"paused\":1}", DECODE_FALLBACK, LYRICS_EVENT_HEARTBEAT, NULL, -1, -1, 0},
+};
+
+static void test_event_decode_cases(void) {
+    LyricsEventDecoder decoder;
+    lyrics_event_decoder_init(&decoder);
+
+    for (guint i = 0; i < G_N_ELEMENTS(decode_cases); i++) {
+        const DecodeCase *test_case = &decode_cases[i];
+        // 快速路径会原地修改输入
+        gchar *data = g_strdup(test_case->json);
+        LyricsEventDecoderStats before = decoder.stats;
+        LyricsEvent event;
+
+        g_test_message("JSON: %s", test_case->json);
+        gboolean ok = lyrics_event_decode(&decoder, data, strlen(data), &event);
+
+        switch (test_case->result) {
+        case DECODE_FAST:
+            g_assert_true(ok);
+            g_assert_cmpuint(decoder.stats.fast_path, ==, before.fast_path + 1);
+            break;
+        case DECODE_FALLBACK:
+            g_assert_true(ok);
+            g_assert_cmpuint(decoder.stats.fallback, ==, before.fallback + 1);
+            break;
+        case DECODE_ERROR:
+            g_assert_false(ok);
+            g_assert_cmpuint(decoder.stats.fast_path, ==, before.fast_path);
+            g_assert_cmpuint(decoder.stats.errors, ==, before.errors + 1);
+            break;
+        case DECODE_NOT_FAST:
+            g_assert_cmpuint(decoder.stats.fast_path, ==, before.fast_path);
+            break;
+        }
+
+        if (ok && test_case->result != DECODE_NOT_FAST) {
+            g_assert_cmpint(event.type, ==, test_case->type);
+            if (test_case->text) {
+                g_assert_cmpstr(event.text.str, ==, test_case->text);
+                g_assert_cmpuint(event.text.len, ==, strlen(test_case->text));
+            }
+            g_assert_cmpint(event.position_ms, ==, test_case->position_ms);
+            g_assert_cmpint(event.paused, ==, test_case->paused);
+            g_assert_cmpfloat(event.rate, ==, test_case->rate);
+        }
+        g_free(data);
+    }
+
+    lyrics_event_decoder_clear(&decoder);
+}
+
+// ---- LRC/KRC时间轴 ----
+
+typedef struct {
+    gint64 start_ms;
+    gint64 duration_ms;
+    const gchar *text;
+    const gchar *syllables;  // 每个音节 "开始+时长:文本"，以空格分隔；NULL表示没有逐字时间
+} TimelineLine;
+
+typedef struct {
+    const gchar *name;
+    const gchar *format;
+    const gchar *document;
+    TimelineLine lines[4];
+    guint n_lines;
+} TimelineCase;
+
+static const TimelineCase timeline_cases[] = {
+    {"stamp-formats", "lrc", "[01:02]a\n[01:02.5]b\n[01:02.123]c\n[01:03:50]d",
+     {{62000, 123, "a", NULL}, {62123, 377, "c", NULL}, {62500, 1000, "b", NULL}, {63500, 0, "d", NULL}}, 4},
+    {"metadata", "lrc", "[ti:Song]\n[ar:Artist]\n\n[00:01.00] a b \n[bad]x\n[00:02.00]",
+     {{1000, 1000, "a b ", NULL}, {2000, 0, "", NULL}}, 2},
+    // 重复的时间标签共用同一行文本，按时间排序
+    {"repeated-stamps", "lrc", "[00:05.00][00:01.00]la\n[00:03.00]mid",
+     {{1000, 2000, "la", NULL}, {3000, 2000, "mid", NULL}, {5000, 0, "la", NULL}}, 3},
+    {"same-time-keeps-order", "lrc", "[00:01.00]first\n[00:01.00]second",
+     {{1000, 0, "first", NULL}, {1000, 0, "second", NULL}}, 2},
+    // [offset:] 作用于整首歌词，正数表示歌词提前，不早于0
+    {"offset-positive", "lrc", "[00:01.00]a\n[offset:+500]\n[00:02.00]b",
+     {{500, 1000, "a", NULL}, {1500, 0, "b", NULL}}, 2},
+    {"offset-negative", "lrc", "[offset: -250 ]\n[00:01.00]a\n[00:02.00]b",
+     {{1250, 1000, "a", NULL}, {2250, 0, "b", NULL}}, 2},
+    {"offset-clamped", "lrc", "[offset:2000]\n[00:01.00]a\n[00:03.00]b",
+     {{0, 1000, "a", NULL}, {1000, 0, "b", NULL}}, 2},
+    // 增强LRC：逐字标签为绝对时间，下一个标签即上一个字的结束
+    {"word-tags", "lrc", "[00:10.00]<00:10.00>你<00:10.50>好<00:11.20>\n[00:12.00]x",
+     {{10000, 2000, "你好", "0+500:你 500+700:好"}, {12000, 0, "x", NULL}}, 2},
+    {"word-tags-prefix", "lrc", "[00:01.00]x <00:01.20>y<00:01.50>",
+     {{1000, 0, "x y", "200+300:y"}}, 1},
+    // 没有结束标签的最后一个字：有下一行时唱到行结束，行时长未知时沿用前一个字的时长
+    {"open-last-word", "lrc", "[00:10.00]<00:10.00>a<00:10.40>b\n[00:12.00]c",
+     {{10000, 2000, "ab", "0+400:a 400+1600:b"}, {12000, 0, "c", NULL}}, 2},
+    {"open-last-word-last-line", "lrc", "[00:10.00]<00:10.00>a<00:10.40>b",
+     {{10000, 0, "ab", "0+400:a 400+400:b"}}, 1},
+    {"open-single-word", "lrc", "[00:10.00]<00:10.00>a",
+     {{10000, 0, "a", "0+500:a"}}, 1},
+    {"krc", "krc", "[id:1]\n[1000,2000]<0,500,0>a<500,1500,0>bc\n[3000,1000]plain",
+     {{1000, 2000, "abc", "0+500:a 500+1500:bc"}, {3000, 1000, "plain", NULL}}, 2},
+};
+
+// 把一行的音节格式化为 "开始+时长:文本 ..."
+static gchar* format_syllables(const LyricsTimeline *timeline, guint index) {
+    const LyricsLine *line = &timeline->lines[index];
+    const gchar *text = lyrics_timeline_line_text(timeline, index);
+    GString *out = g_string_new(NULL);
+
+    for (guint i = 0; i < line->syllable_count; i++) {
+        const LyricsSyllable *syllable = &timeline->syllables[line->first_syllable + i];
+        g_assert_cmpuint((guint64)syllable->byte_offset + syllable->byte_length, <=, line->text_length);
+        g_string_append_printf(out, "%s%" G_GINT64_FORMAT "+%" G_GINT64_FORMAT ":", i > 0 ? " " : "",
+                               syllable->start_ms, syllable->duration_ms);
+        g_string_append_len(out, text + syllable->byte_offset, syllable->byte_length);
+    }
+    return g_string_free(out, FALSE);
+}
+
+static void check_timeline(const LyricsTimeline *timeline, const TimelineLine *lines, guint n_lines) {
+    g_assert_nonnull(timeline);
+    g_assert_cmpuint(timeline->n_lines, ==, n_lines);
+
+    for (guint i = 0; i < n_lines; i++) {
+        const LyricsLine *line = &timeline->lines[i];
+        g_assert_cmpint(line->start_ms, ==, lines[i].start_ms);
+        g_assert_cmpint(line->duration_ms, ==, lines[i].duration_ms);
+        g_assert_cmpstr(lyrics_timeline_line_text(timeline, i), ==, lines[i].text);
+        g_assert_cmpuint(line->text_length, ==, strlen(lines[i].text));
+        if (lines[i].syllables) {
+            gchar *syllables = format_syllables(timeline, i);
+            g_assert_cmpstr(syllables, ==, lines[i].syllables);
+            g_free(syllables);
+        } else {
+            g_assert_cmpuint(line->syllable_count, ==, 0);
+        }
+    }
+}
+
+static void test_timeline_cases(void) {
+    for (guint i = 0; i < G_N_ELEMENTS(timeline_cases); i++) {
+        const TimelineCase *test_case = &timeline_cases[i];
+        g_test_message("时间轴: %s", test_case->name);
+
+        LyricsTimeline *timeline = lyrics_timeline_parse("song", test_case->format, test_case->document,
+                                                         strlen(test_case->document));
+        check_timeline(timeline, test_case->lines, test_case->n_lines);
+        lyrics_timeline_free(timeline);
+    }
+}
+
+// 没有任何带时间的行；按位置查找行
+static void test_timeline_lookup(void) {
+    static const gchar empty[] = "[ti:Song]\nplain text";
+    g_assert_null(lyrics_timeline_parse(NULL, "lrc", empty, sizeof(empty) - 1));
+
+    static const gchar document[] = "[00:01.00]a\n[00:02.00]b\n[00:03.00]c";
+    LyricsTimeline *timeline = lyrics_timeline_parse(NULL, "lrc", document, sizeof(document) - 1);
+    g_assert_cmpint(lyrics_timeline_find_line(timeline, 999), ==, -1);
+    g_assert_cmpint(lyrics_timeline_find_line(timeline, 1000), ==, 0);
+    g_assert_cmpint(lyrics_timeline_find_line(timeline, 2999), ==, 1);
+    g_assert_cmpint(lyrics_timeline_find_line(timeline, 100000), ==, 2);
+    lyrics_timeline_free(timeline);
+
+    g_assert_cmpint(lyrics_timeline_line_start("[171960,5040]<0,100,0>a", -1), ==, 171960);
+    g_assert_cmpint(lyrics_timeline_line_start("[02:51.96]a", -1), ==, 171960);
+    g_assert_cmpint(lyrics_timeline_line_start("plain", 1000), ==, -1);
+
+    // 重复的时间标签：取离当前位置最近的一个，位置未知时取最后一个
+    static const gchar chorus[] = "[00:12.00][01:30.00][02:40.00]chorus";
+    g_assert_cmpint(lyrics_timeline_line_start(chorus, -1), ==, 160000);
+    g_assert_cmpint(lyrics_timeline_line_start(chorus, 0), ==, 12000);
+    g_assert_cmpint(lyrics_timeline_line_start(chorus, 89500), ==, 90000);
+    g_assert_cmpint(lyrics_timeline_line_start(chorus, 91000), ==, 90000);
+    g_assert_cmpint(lyrics_timeline_line_start(chorus, 150000), ==, 160000);
+}
+
+// ---- 紧凑二进制编码 ----
+
+static void put_varint(GByteArray *out, guint64 value) {
+    do {
+        guint8 byte = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            byte |= 0x80;
+        }
+        g_byte_array_append(out, &byte, 1);
+    } while (value);
+}
+
+static void put_string(GByteArray *out, const gchar *str) {
+    put_varint(out, strlen(str));
+    g_byte_array_append(out, (const guint8 *)str, strlen(str));
+}
+
+// 帧：varint(类型 + 载荷长度) + u8(类型) + 载荷
+static void put_frame(GByteArray *stream, guint8 type, const GByteArray *payload) {
+    put_varint(stream, (payload ? payload->len : 0) + 1);
+    g_byte_array_append(stream, &type, 1);
+    if (payload) {
+        g_byte_array_append(stream, payload->data, payload->len);
+    }
+}
+
+static void put_song_frame(GByteArray *stream, guint64 song_id, gboolean krc) {
+    GByteArray *payload = g_byte_array_new();
+    guint8 format = krc ? 1 : 0;
+    put_varint(payload, song_id);
+    put_string(payload, "song");
+    put_string(payload, "artist");
+    g_byte_array_append(payload, &format, 1);
+    put_frame(stream, LYRICS_COMPACT_SONG, payload);
+    g_byte_array_free(payload, TRUE);
+}
+
+// 一行：开始时间, 时长, 音节数, 音节(开始差值, 时长, 字节数)..., 文本
+static void put_line(GByteArray *out, guint64 start, guint64 duration, const guint64 *syllables,
+                     guint n_syllables, const gchar *text) {
+    put_varint(out, start);
+    put_varint(out, duration);
+    put_varint(out, n_syllables);
+    for (guint i = 0; i < n_syllables * 3; i++) {
+        put_varint(out, syllables[i]);
+    }
+    put_string(out, text);
+}
+
+static void put_line_frame(GByteArray *stream, guint64 song_id, const guint64 *syllables, guint n_syllables,
+                           const gchar *text) {
+    GByteArray *payload = g_byte_array_new();
+    put_varint(payload, song_id);
+    put_line(payload, 1000, 2000, syllables, n_syllables, text);
+    put_frame(stream, LYRICS_COMPACT_LINE, payload);
+    g_byte_array_free(payload, TRUE);
+}
+
+// 解码出的事件：歌词行记录文本，整首歌词记录行数，播放状态记录位置
+static void collect_compact_event(LyricsEvent *event, gpointer user_data) {
+    GString *log = (GString *)user_data;
+    if (log->len > 0) {
+        g_string_append_c(log, '\n');
+    }
+    switch (event->type) {
+    case LYRICS_EVENT_LYRICS_UPDATE:
+        g_string_append_printf(log, "line:%s:%s", event->song_name.str, event->text.str);
+        break;
+    case LYRICS_EVENT_LYRICS_DOCUMENT:
+        g_string_append_printf(log, "document:%u", event->timeline->n_lines);
+        for (guint i = 0; i < event->timeline->n_lines; i++) {
+            g_string_append_printf(log, ":%" G_GINT64_FORMAT, event->timeline->lines[i].start_ms);
+        }
+        break;
+    case LYRICS_EVENT_HEARTBEAT:
+        g_string_append(log, "heartbeat");
+        break;
+    default:
+        g_string_append_printf(log, "playback:%" G_GINT64_FORMAT ":%d", event->position_ms, event->paused);
+        break;
+    }
+}
+
+// 整块输入和逐字节输入的结果相同
+static void feed_compact(GByteArray *stream, gboolean expected_ok, const gchar *expected_log) {
+    for (guint pass = 0; pass < 2; pass++) {
+        GString *log = g_string_new(NULL);
+        LyricsCompactDecoder decoder;
+        gboolean ok = TRUE;
+
+        lyrics_compact_decoder_init(&decoder, collect_compact_event, log);
+        if (pass == 0) {
+            ok = lyrics_compact_decoder_feed(&decoder, (const gchar *)stream->data, stream->len);
+        } else {
+            for (guint i = 0; i < stream->len && ok; i++) {
+                ok = lyrics_compact_decoder_feed(&decoder, (const gchar *)stream->data + i, 1);
+            }
+        }
+        g_assert_cmpint(ok, ==, expected_ok);
+        g_assert_cmpstr(log->str, ==, expected_log);
+
+        lyrics_compact_decoder_clear(&decoder);
+        g_string_free(log, TRUE);
+    }
+}
+
+static void test_compact_valid(void) {
+    GByteArray *stream = g_byte_array_new();
+    static const guint64 syllables[] = {0, 500, 3, 500, 1500, 3};
+    guint8 playback[] = {0x01 | 0x02 | 0x04, 0x2a};
+    GByteArray *payload = g_byte_array_new();
+
+    put_frame(stream, LYRICS_COMPACT_HEARTBEAT, NULL);
+    put_song_frame(stream, 7, TRUE);
+    put_line_frame(stream, 7, syllables, 2, "你好!");
+    // 未知类型的帧跳过
+    put_frame(stream, 99, NULL);
+    g_byte_array_append(payload, playback, sizeof(playback));
+    put_frame(stream, LYRICS_COMPACT_PLAYBACK, payload);
+
+    // 整首歌词（未压缩）：行的开始时间为与上一行的差值
+    GByteArray *document = g_byte_array_new();
+    put_varint(document, 2);
+    put_line(document, 1000, 2000, syllables, 2, "你好");
+    put_line(document, 2500, 1000, NULL, 0, "b");
+    g_byte_array_set_size(payload, 0);
+    put_varint(payload, 7);
+    guint8 flags = 0;
+    g_byte_array_append(payload, &flags, 1);
+    put_varint(payload, document->len);
+    g_byte_array_append(payload, document->data, document->len);
+    put_frame(stream, LYRICS_COMPACT_DOCUMENT, payload);
+
+    feed_compact(stream, TRUE,
+                 "heartbeat\n"
+                 "line:song:[1000,2000]<0,500,0>你<500,1500,0>好!\n"
+                 "playback:42:1\n"
+                 "document:2:1000:3500");
+
+    g_byte_array_free(document, TRUE);
+    g_byte_array_free(payload, TRUE);
+    g_byte_array_free(stream, TRUE);
+}
+
+typedef struct {
+    const gchar *name;
+    guint64 syllables[6];
+    guint n_syllables;
+    const gchar *text;
+} CompactLineCase;
+
+// 音节超出文本范围的行必须整帧拒绝，不能分发任何内容
+static const CompactLineCase compact_bad_lines[] = {
+    // 32位累加会回绕到1，通过最终检查
+    {"wrapping-lengths", {0, 100, 0xFFFFFFFFULL, 0, 100, 2}, 2, "ab"},
+    {"length-above-guint", {0, 100, 0x100000001ULL}, 1, "ab"},
+    {"huge-length", {0, 100, G_MAXUINT64}, 1, "ab"},
+    {"past-text", {0, 100, 2, 0, 100, 1}, 2, "ab"},
+    // 时间超出 G_MAXINT32 毫秒：转换为有符号数会溢出或得到负的时长
+    {"huge-delta", {G_MAXUINT64, 100, 1}, 1, "ab"},
+    {"huge-duration", {0, G_MAXUINT64, 1}, 1, "ab"},
+    {"duration-above-int32", {0, 0x80000000ULL, 1}, 1, "ab"},
+    {"start-sum-above-int32", {0x7fffffffULL, 100, 1, 0x7fffffffULL, 100, 1}, 2, "ab"},
+};
+
+static void test_compact_overflow(void) {
+    for (guint i = 0; i < G_N_ELEMENTS(compact_bad_lines); i++) {
+        const CompactLineCase *test_case = &compact_bad_lines[i];
+        GByteArray *stream = g_byte_array_new();
+
+        g_test_message("紧凑编码: %s", test_case->name);
+        put_song_frame(stream, 1, TRUE);
+        put_line_frame(stream, 1, test_case->syllables, test_case->n_syllables, test_case->text);
+        feed_compact(stream, FALSE, "");
+
+        // 整首歌词中的同一行
+        g_byte_array_set_size(stream, 0);
+        put_song_frame(stream, 1, TRUE);
+        GByteArray *document = g_byte_array_new();
+        GByteArray *payload = g_byte_array_new();
+        guint8 flags = 0;
+        put_varint(document, 1);
+        put_line(document, 0, 100, test_case->syllables, test_case->n_syllables, test_case->text);
+        put_varint(payload, 1);
+        g_byte_array_append(payload, &flags, 1);
+        put_varint(payload, document->len);
+        g_byte_array_append(payload, document->data, document->len);
+        put_frame(stream, LYRICS_COMPACT_DOCUMENT, payload);
+        feed_compact(stream, FALSE, "");
+
+        g_byte_array_free(payload, TRUE);
+        g_byte_array_free(document, TRUE);
+        g_byte_array_free(stream, TRUE);
+    }
+}
+
+// 行的开始时间和时长同样有上限；整首歌词中逐行累加的开始时间也不能超出
+static void test_compact_line_times(void) {
+    static const guint64 line_times[][2] = {
+        {G_MAXUINT64, 100},
+        {0x80000000ULL, 100},
+        {0, G_MAXUINT64},
+        {0, 0x80000000ULL},
+    };
+    GByteArray *stream = g_byte_array_new();
+    GByteArray *payload = g_byte_array_new();
+    GByteArray *document = g_byte_array_new();
+    guint8 flags = 0;
+
+    for (guint i = 0; i < G_N_ELEMENTS(line_times); i++) {
+        g_byte_array_set_size(stream, 0);
+        g_byte_array_set_size(payload, 0);
+        put_song_frame(stream, 1, FALSE);
+        put_varint(payload, 1);
+        put_line(payload, line_times[i][0], line_times[i][1], NULL, 0, "a");
+        put_frame(stream, LYRICS_COMPACT_LINE, payload);
+        feed_compact(stream, FALSE, "");
+    }
+
+    // 每行都在范围内，累加后超出
+    g_byte_array_set_size(stream, 0);
+    g_byte_array_set_size(payload, 0);
+    put_song_frame(stream, 1, FALSE);
+    put_varint(document, 2);
+    put_line(document, 0x7fffffffULL, 100, NULL, 0, "a");
+    put_line(document, 1, 100, NULL, 0, "b");
+    put_varint(payload, 1);
+    g_byte_array_append(payload, &flags, 1);
+    put_varint(payload, document->len);
+    g_byte_array_append(payload, document->data, document->len);
+    put_frame(stream, LYRICS_COMPACT_DOCUMENT, payload);
+    feed_compact(stream, FALSE, "");
+
+    g_byte_array_free(document, TRUE);
+    g_byte_array_free(payload, TRUE);
+    g_byte_array_free(stream, TRUE);
+}
+
+static void test_compact_truncated(void) {
+    static const guint64 syllables[] = {0, 500, 1, 500, 500, 1};
+    GByteArray *stream = g_byte_array_new();
+    GByteArray *payload = g_byte_array_new();
+
+    // 帧长度声明的载荷中缺少文本
+    put_song_frame(stream, 1, FALSE);
+    put_varint(payload, 1);
+    put_varint(payload, 1000);
+    put_varint(payload, 0);
+    put_varint(payload, 2);
+    for (guint i = 0; i < G_N_ELEMENTS(syllables); i++) {
+        put_varint(payload, syllables[i]);
+    }
+    put_frame(stream, LYRICS_COMPACT_LINE, payload);
+    feed_compact(stream, FALSE, "");
+
+    // 文本长度超出帧
+    g_byte_array_set_size(stream, 0);
+    put_song_frame(stream, 1, FALSE);
+    put_varint(payload, 10);
+    g_byte_array_append(payload, (const guint8 *)"ab", 2);
+    put_frame(stream, LYRICS_COMPACT_LINE, payload);
+    feed_compact(stream, FALSE, "");
+
+    // 没有SONG帧的行
+    g_byte_array_set_size(stream, 0);
+    put_line_frame(stream, 1, syllables, 2, "ab");
+    feed_compact(stream, FALSE, "");
+
+    // 长度为0的帧
+    g_byte_array_set_size(stream, 0);
+    put_varint(stream, 0);
+    feed_compact(stream, FALSE, "");
+
+    // 声明的行数多于数据
+    g_byte_array_set_size(stream, 0);
+    put_song_frame(stream, 1, FALSE);
+    GByteArray *document = g_byte_array_new();
+    guint8 flags = 0;
+    put_varint(document, 3);
+    put_line(document, 0, 100, NULL, 0, "a");
+    g_byte_array_set_size(payload, 0);
+    put_varint(payload, 1);
+    g_byte_array_append(payload, &flags, 1);
+    put_varint(payload, document->len);
+    g_byte_array_append(payload, document->data, document->len);
+    put_frame(stream, LYRICS_COMPACT_DOCUMENT, payload);
+    feed_compact(stream, FALSE, "");
+
+    // 不完整的帧只是等待更多数据
+    g_byte_array_set_size(stream, 0);
+    put_song_frame(stream, 1, FALSE);
+    put_line_frame(stream, 1, syllables, 2, "ab");
+    g_byte_array_set_size(stream, stream->len - 1);
+    feed_compact(stream, TRUE, "");
+
+    g_byte_array_free(document, TRUE);
+    g_byte_array_free(payload, TRUE);
+    g_byte_array_free(stream, TRUE);
+}
+
+// ---- 播放时钟 ----
+
+// 平滑修正期间位置不倒退，修正完成后与观测一致
+static void test_clock_slew_monotonic(void) {
+    static const gint64 errors[] = {-999, -500, -100, -1, 1, 100, 500, 999};
+    static const gdouble rates[] = {0.5, 1.0, 1.5, 2.0};
+
+    for (guint r = 0; r < G_N_ELEMENTS(rates); r++) {
+        for (guint e = 0; e < G_N_ELEMENTS(errors); e++) {
+            PlaybackClock clock;
+            playback_clock_init(&clock);
+            playback_clock_set_rate(&clock, rates[r], 0);
+            g_assert_cmpint(playback_clock_observe(&clock, 10000, 0), ==, PLAYBACK_CLOCK_JUMP);
+
+            // 1秒后的观测与预测相差 errors[e]
+            gint64 observed = 10000 + (gint64)(1000 * rates[r]) + errors[e];
+            g_assert_cmpint(playback_clock_observe(&clock, observed, 1000), ==, PLAYBACK_CLOCK_SLEW);
+
+            gint64 previous = playback_clock_position(&clock, 1000);
+            for (gint64 now = 1001; now <= 5000; now++) {
+                gint64 position = playback_clock_position(&clock, now);
+                g_assert_cmpint(position, >=, previous);
+                previous = position;
+            }
+            gint64 expected = observed + (gint64)(4000 * rates[r]);
+            g_assert_cmpint(ABS(playback_clock_position(&clock, 5000) - expected), <=, 1);
+        }
+    }
+}
+
+// 修正尚未完成时又来新的观测（例如频繁的心跳），位置仍然不倒退
+static void test_clock_repeated_observations(void) {
+    static const gint64 errors[] = {-900, 800, -700, -900, 600, -50, -900, -900, 300, -999};
+    PlaybackClock clock;
+
+    playback_clock_init(&clock);
+    playback_clock_observe(&clock, 0, 0);
+
+    gint64 previous = 0;
+    gint64 now = 0;
+    for (guint i = 0; i < G_N_ELEMENTS(errors); i++) {
+        for (gint64 end = now + 100; now < end; now++) {
+            gint64 position = playback_clock_position(&clock, now);
+            g_assert_cmpint(position, >=, previous);
+            previous = position;
+        }
+        gint64 predicted = playback_clock_position(&clock, now);
+        g_assert_cmpint(playback_clock_observe(&clock, predicted + errors[i], now), ==, PLAYBACK_CLOCK_SLEW);
+    }
+    g_assert_cmpuint(clock.stats.observations, ==, G_N_ELEMENTS(errors) + 1);
+    g_assert_cmpuint(clock.stats.jumps, ==, 1);
+}
+
+// 大偏差立即跳转（可以向后）；暂停时位置不变；速率变化不改变当前位置
+static void test_clock_jump_pause_rate(void) {
+    PlaybackClock clock;
+    playback_clock_init(&clock);
+    g_assert_cmpint(playback_clock_position(&clock, 0), ==, -1);
+    g_assert_cmpint(playback_clock_time_until(&clock, 1000, 0), ==, -1);
+
+    playback_clock_observe(&clock, 60000, 0);
+    g_assert_cmpint(playback_clock_observe(&clock, 5000, 1000), ==, PLAYBACK_CLOCK_JUMP);
+    g_assert_cmpint(playback_clock_position(&clock, 1000), ==, 5000);
+    g_assert_cmpint(playback_clock_time_until(&clock, 6000, 1000), ==, 1000);
+
+    g_assert_true(playback_clock_set_paused(&clock, TRUE, 2000));
+    g_assert_false(playback_clock_set_paused(&clock, TRUE, 2500));
+    g_assert_cmpint(playback_clock_position(&clock, 2000), ==, 6000);
+    g_assert_cmpint(playback_clock_position(&clock, 9000), ==, 6000);
+    g_assert_cmpint(playback_clock_time_until(&clock, 7000, 9000), ==, -1);
+
+    g_assert_true(playback_clock_set_paused(&clock, FALSE, 9000));
+    g_assert_true(playback_clock_set_rate(&clock, 2.0, 10000));
+    g_assert_cmpint(playback_clock_position(&clock, 10000), ==, 7000);
+    g_assert_cmpint(playback_clock_position(&clock, 10500), ==, 8000);
+    g_assert_cmpint(playback_clock_time_until(&clock, 9000, 10500), ==, 500);
+    g_assert_false(playback_clock_set_rate(&clock, 0, 10500));
+}
+
+// ---- 性能基准 ----
+
+// 性能基准只在 -m perf 时运行：make run-bench
+static gboolean bench_enabled(void) {
+    if (!g_test_perf()) {
+        g_test_skip("性能基准，使用 -m perf 运行");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// 基准歌词：每行 BENCH_LINE_SYLLABLES 个字，每个字一个音节
+#define BENCH_LINE_SYLLABLES 12
+#define BENCH_SYLLABLE_MS 250
+// 一个TCP报文段的载荷，网络数据按这个大小分块输入
+#define BENCH_CHUNK_SIZE 1460
+
+static const gchar *bench_chars[] = {"你", "走", "之", "后", "我", "又", "再", "为", "谁",
+                                     "等", "候", "月", "光", "下", "的", "影", "子"};
+
+// 第 index 行的开始时间、纯文本和音节
+static void bench_line(guint index, gint64 *start_ms, GString *text, LyricsSyllable *syllables) {
+    *start_ms = (gint64)index * BENCH_LINE_SYLLABLES * BENCH_SYLLABLE_MS;
+    g_string_truncate(text, 0);
+    for (guint i = 0; i < BENCH_LINE_SYLLABLES; i++) {
+        const gchar *ch = bench_chars[(index * 7 + i) % G_N_ELEMENTS(bench_chars)];
+        syllables[i].start_ms = (gint64)i * BENCH_SYLLABLE_MS;
+        syllables[i].duration_ms = BENCH_SYLLABLE_MS;
+        syllables[i].byte_offset = (guint)text->len;
+        syllables[i].byte_length = (guint)strlen(ch);
+        g_string_append(text, ch);
+    }
+}
+
+// 按KRC格式追加第 index 行：[开始,时长]<偏移,时长,0>字...
+static void append_bench_krc(GString *out, guint index) {
+    LyricsSyllable syllables[BENCH_LINE_SYLLABLES];
+    GString *text = g_string_new(NULL);
+    gint64 start_ms;
+
+    bench_line(index, &start_ms, text, syllables);
+    g_string_append_printf(out, "[%" G_GINT64_FORMAT ",%d]", start_ms, BENCH_LINE_SYLLABLES * BENCH_SYLLABLE_MS);
+    for (guint i = 0; i < BENCH_LINE_SYLLABLES; i++) {
+        g_string_append_printf(out, "<%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",0>",
+                               syllables[i].start_ms, syllables[i].duration_ms);
+        g_string_append_len(out, text->str + syllables[i].byte_offset, syllables[i].byte_length);
+    }
+    g_string_free(text, TRUE);
+}
+
+// 一行歌词的 lyrics_update 事件JSON
+static void append_bench_json(GString *out, guint index) {
+    g_string_append(out, "{\"type\":\"lyrics_update\",\"text\":\"");
+    append_bench_krc(out, index);
+    g_string_append(out, "\",\"songName\":\"月光下的影子\",\"artist\":\"歌手\",\"format\":\"krc\"}");
+}
+
+// n_events 行歌词的SSE事件流
+static GString* build_bench_sse_stream(guint n_events) {
+    GString *stream = g_string_new(NULL);
+    for (guint i = 0; i < n_events; i++) {
+        g_string_append_printf(stream, "id: %u\ndata: ", i);
+        append_bench_json(stream, i);
+        g_string_append(stream, "\n\n");
+    }
+    return stream;
+}
+
+// ---- 性能基准：SSE帧解析 ----
+
+#define BENCH_SSE_EVENTS 500
+#define BENCH_SSE_ROUNDS 20
+
+static void count_sse_event(SSEEvent *event, gpointer user_data) {
+    (void)event;
+    (*(guint64 *)user_data)++;
+}
+
+// 原来的处理方式（对照）：每块数据都重新分配整个缓冲区并用 g_strsplit 切分，处理后清空缓冲区，
+// 跨数据块的半行被丢弃。返回完整收到的data行数
+static guint64 split_feed(gchar **buffer, gsize *buffer_size, const gchar *chunk, gsize len) {
+    guint64 events = 0;
+
+    *buffer = g_realloc(*buffer, *buffer_size + len + 1);
+    memcpy(*buffer + *buffer_size, chunk, len);
+    *buffer_size += len;
+    (*buffer)[*buffer_size] = 0;
+
+    // 最后一段没有换行结尾，是被截断的半行
+    gchar **lines = g_strsplit(*buffer, "\n", -1);
+    for (guint i = 0; lines[i] && lines[i + 1]; i++) {
+        if (g_str_has_prefix(lines[i], "data: ")) {
+            events++;
+        }
+    }
+    g_strfreev(lines);
+    *buffer_size = 0;
+    return events;
+}
+
+// 吞吐（MB/s）和每个事件的堆分配次数，与原来按行切分的方式对比
+static void test_bench_sse_parse(void) {
+    if (!bench_enabled()) {
+        return;
+    }
+
+    GString *stream = build_bench_sse_stream(BENCH_SSE_EVENTS);
+    guint64 total_events = (guint64)BENCH_SSE_EVENTS * BENCH_SSE_ROUNDS;
+    gdouble total_bytes = (gdouble)stream->len * BENCH_SSE_ROUNDS;
+
+    // 增量解析：先跑一轮让缓冲区长到稳定大小
+    guint64 events = 0;
+    SSEParser parser;
+    sse_parser_init(&parser, count_sse_event, &events);
+    for (gsize offset = 0; offset < stream->len; offset += BENCH_CHUNK_SIZE) {
+        sse_parser_feed(&parser, stream->str + offset, MIN(BENCH_CHUNK_SIZE, stream->len - offset));
+    }
+    events = 0;
+
+    allocations_begin();
+    gint64 start = g_get_monotonic_time();
+    for (guint round = 0; round < BENCH_SSE_ROUNDS; round++) {
+        for (gsize offset = 0; offset < stream->len; offset += BENCH_CHUNK_SIZE) {
+            sse_parser_feed(&parser, stream->str + offset, MIN(BENCH_CHUNK_SIZE, stream->len - offset));
+        }
+    }
+    gint64 parse_us = MAX(g_get_monotonic_time() - start, 1);
+    guint64 parse_allocations = allocations_end();
+    sse_parser_clear(&parser);
+
+    // 对照
+    gchar *buffer = NULL;
+    gsize buffer_size = 0;
+    guint64 split_events = 0;
+    allocations_begin();
+    start = g_get_monotonic_time();
+    for (guint round = 0; round < BENCH_SSE_ROUNDS; round++) {
+        for (gsize offset = 0; offset < stream->len; offset += BENCH_CHUNK_SIZE) {
+            split_events += split_feed(&buffer, &buffer_size, stream->str + offset,
+                                       MIN(BENCH_CHUNK_SIZE, stream->len - offset));
+        }
+    }
+    gint64 split_us = MAX(g_get_monotonic_time() - start, 1);
+    guint64 split_allocations = allocations_end();
+    g_free(buffer);
+
+    g_test_message("SSE帧解析: %" G_GUINT64_FORMAT " 个事件, 每个约 %" G_GSIZE_FORMAT " 字节, 按 %d 字节分块",
+                   total_events, stream->len / BENCH_SSE_EVENTS, BENCH_CHUNK_SIZE);
+    g_test_message("  增量解析: %.1f MB/s, 每事件分配 %.3f 次, 完整收到 %" G_GUINT64_FORMAT " 个事件",
+                   total_bytes / parse_us, (gdouble)parse_allocations / total_events, events);
+    g_test_message("  按行切分(原方式): %.1f MB/s, 每事件分配 %.3f 次, 完整收到 %" G_GUINT64_FORMAT " 个事件",
+                   total_bytes / split_us, (gdouble)split_allocations / total_events, split_events);
+    g_test_maximized_result(total_bytes / parse_us, "增量解析 %.1f MB/s", total_bytes / parse_us);
+
+    // 跨数据块的行不再丢失
+    g_assert_cmpuint(events, ==, total_events);
+    g_string_free(stream, TRUE);
+}
+
+// ---- 性能基准：事件JSON解码 ----
+
+#define BENCH_DECODE_EVENTS 200
+#define BENCH_DECODE_ROUNDS 50
+
+// 原来的处理方式（对照）：每个事件完整解析成json_object树，再逐个取字段
+static gboolean json_decode_event(const gchar *data, gsize *text_len) {
+    json_object *root = json_tokener_parse(data);
+    if (!root) {
+        return FALSE;
+    }
+
+    json_object *type_obj, *text_obj, *song_obj, *artist_obj, *format_obj;
+    gboolean ok = FALSE;
+    if (json_object_object_get_ex(root, "type", &type_obj) &&
+        strcmp(json_object_get_string(type_obj), "lyrics_update") == 0 &&
+        json_object_object_get_ex(root, "text", &text_obj)) {
+        json_object_object_get_ex(root, "songName", &song_obj);
+        json_object_object_get_ex(root, "artist", &artist_obj);
+        json_object_object_get_ex(root, "format", &format_obj);
+        *text_len = (gsize)json_object_get_string_len(text_obj);
+        ok = TRUE;
+    }
+    json_object_put(root);
+    return ok;
+}
+
+// 每个事件的解码耗时和堆分配次数，与完整解析成json_object树对比
+static void test_bench_event_decode(void) {
+    if (!bench_enabled()) {
+        return;
+    }
+
+    GPtrArray *events = g_ptr_array_new_with_free_func(g_free);
+    gsize max_len = 0;
+    for (guint i = 0; i < BENCH_DECODE_EVENTS; i++) {
+        GString *json = g_string_new(NULL);
+        append_bench_json(json, i);
+        max_len = MAX(max_len, json->len);
+        g_ptr_array_add(events, g_string_free(json, FALSE));
+    }
+    // 快速路径原地反转义，每次解码前复制到工作缓冲区，两种方式都计入这次复制
+    gchar *scratch = g_malloc(max_len + 1);
+    guint64 total = (guint64)BENCH_DECODE_EVENTS * BENCH_DECODE_ROUNDS;
+
+    LyricsEventDecoder decoder;
+    lyrics_event_decoder_init(&decoder);
+    LyricsEvent event;
+    gsize decoded_bytes = 0;
+
+    allocations_begin();
+    gint64 start = g_get_monotonic_time();
+    for (guint round = 0; round < BENCH_DECODE_ROUNDS; round++) {
+        for (guint i = 0; i < events->len; i++) {
+            const gchar *json = g_ptr_array_index(events, i);
+            gsize len = strlen(json);
+            memcpy(scratch, json, len + 1);
+            g_assert_true(lyrics_event_decode(&decoder, scratch, len, &event));
+            decoded_bytes += event.text.len;
+        }
+    }
+    gint64 fast_us = MAX(g_get_monotonic_time() - start, 1);
+    guint64 fast_allocations = allocations_end();
+    guint64 fast_path = decoder.stats.fast_path;
+    lyrics_event_decoder_clear(&decoder);
+
+    gsize json_bytes = 0;
+    allocations_begin();
+    start = g_get_monotonic_time();
+    for (guint round = 0; round < BENCH_DECODE_ROUNDS; round++) {
+        for (guint i = 0; i < events->len; i++) {
+            const gchar *json = g_ptr_array_index(events, i);
+            gsize len = strlen(json), text_len = 0;
+            memcpy(scratch, json, len + 1);
+            g_assert_true(json_decode_event(scratch, &text_len));
+            json_bytes += text_len;
+        }
+    }
+    gint64 json_us = MAX(g_get_monotonic_time() - start, 1);
+    guint64 json_allocations = allocations_end();
+
+    g_test_message("事件JSON解码: %" G_GUINT64_FORMAT " 个lyrics_update事件", total);
+    g_test_message("  快速路径: 每事件 %.0f ns, 分配 %.3f 次, 走快速路径 %" G_GUINT64_FORMAT " 次",
+                   fast_us * 1000.0 / total, (gdouble)fast_allocations / total, fast_path);
+    g_test_message("  json_tokener_parse(原方式): 每事件 %.0f ns, 分配 %.3f 次",
+                   json_us * 1000.0 / total, (gdouble)json_allocations / total);
+    g_test_minimized_result(fast_us * 1000.0 / total, "快速路径每事件 %.0f ns", fast_us * 1000.0 / total);
+
+    // 两种方式解出的歌词文本一致，且全部走快速路径
+    g_assert_cmpuint(decoded_bytes, ==, json_bytes);
+    g_assert_cmpuint(fast_path, ==, total);
+
+    g_free(scratch);
+    g_ptr_array_free(events, TRUE);
+}
+
+// ---- 性能基准：紧凑编码与JSON ----
+
+#define BENCH_COMPACT_LINES 500
+#define BENCH_COMPACT_ROUNDS 20
+#define BENCH_DOCUMENT_LINES 60
+#define BENCH_DOCUMENT_ROUNDS 200
+
+typedef struct {
+    LyricsEventDecoder decoder;
+    guint64 events;
+    guint64 text_bytes;
+    guint64 lines;           // 整首歌词解析出的行数
+} BenchDecodeState;
+
+// SSE+JSON路径：与客户端相同，先解码事件，整首歌词再解析成时间轴
+static void bench_json_event(SSEEvent *sse_event, gpointer user_data) {
+    BenchDecodeState *state = (BenchDecodeState *)user_data;
+    LyricsEvent event;
+    g_assert_true(lyrics_event_decode(&state->decoder, sse_event->data, sse_event->data_len, &event));
+    state->events++;
+    if (event.type == LYRICS_EVENT_LYRICS_DOCUMENT) {
+        LyricsTimeline *timeline = lyrics_timeline_parse(event.song_name.str, event.format.str,
+                                                         event.text.str, event.text.len);
+        state->lines += timeline->n_lines;
+        lyrics_timeline_free(timeline);
+    } else {
+        state->text_bytes += event.text.len;
+    }
+}
+
+static void bench_compact_event(LyricsEvent *event, gpointer user_data) {
+    BenchDecodeState *state = (BenchDecodeState *)user_data;
+    state->events++;
+    if (event->type == LYRICS_EVENT_LYRICS_DOCUMENT) {
+        state->lines += event->timeline->n_lines;
+    } else {
+        state->text_bytes += event->text.len;
+    }
+}
+
+// 按紧凑格式写第 index 行，开始时间为与 previous_start 的差值
+static void put_bench_line(GByteArray *out, guint index, gint64 previous_start, gint64 *start_ms) {
+    LyricsSyllable syllables[BENCH_LINE_SYLLABLES];
+    GString *text = g_string_new(NULL);
+
+    bench_line(index, start_ms, text, syllables);
+    put_varint(out, (guint64)(*start_ms - previous_start));
+    put_varint(out, BENCH_LINE_SYLLABLES * BENCH_SYLLABLE_MS);
+    put_varint(out, BENCH_LINE_SYLLABLES);
+    gint64 syllable_start = 0;
+    for (guint i = 0; i < BENCH_LINE_SYLLABLES; i++) {
+        put_varint(out, (guint64)(syllables[i].start_ms - syllable_start));
+        put_varint(out, (guint64)syllables[i].duration_ms);
+        put_varint(out, syllables[i].byte_length);
+        syllable_start = syllables[i].start_ms;
+    }
+    put_string(out, text->str);
+    g_string_free(text, TRUE);
+}
+
+// 整首歌词的 lyrics_document 事件，文本中的换行按JSON转义
+static GString* build_bench_document_sse(void) {
+    GString *stream = g_string_new("data: {\"type\":\"lyrics_document\",\"text\":\"");
+    for (guint i = 0; i < BENCH_DOCUMENT_LINES; i++) {
+        append_bench_krc(stream, i);
+        g_string_append(stream, "\\n");
+    }
+    g_string_append(stream, "\",\"songName\":\"月光下的影子\",\"artist\":\"歌手\",\"format\":\"krc\"}\n\n");
+    return stream;
+}
+
+// SONG帧 + zlib压缩的DOCUMENT帧
+static GByteArray* build_bench_document_compact(void) {
+    GByteArray *stream = g_byte_array_new();
+    GByteArray *raw = g_byte_array_new();
+    GByteArray *payload = g_byte_array_new();
+    gint64 previous_start = 0, start_ms;
+
+    put_song_frame(stream, 1, TRUE);
+    put_varint(raw, BENCH_DOCUMENT_LINES);
+    for (guint i = 0; i < BENCH_DOCUMENT_LINES; i++) {
+        put_bench_line(raw, i, previous_start, &start_ms);
+        previous_start = start_ms;
+    }
+
+    uLongf compressed_len = compressBound(raw->len);
+    guint8 *compressed = g_malloc(compressed_len);
+    g_assert_cmpint(compress2(compressed, &compressed_len, raw->data, raw->len, Z_BEST_COMPRESSION), ==, Z_OK);
+    guint8 flags = 1;
+    put_varint(payload, 1);
+    g_byte_array_append(payload, &flags, 1);
+    put_varint(payload, raw->len);
+    g_byte_array_append(payload, compressed, (guint)compressed_len);
+    put_frame(stream, LYRICS_COMPACT_DOCUMENT, payload);
+
+    g_free(compressed);
+    g_byte_array_free(payload, TRUE);
+    g_byte_array_free(raw, TRUE);
+    return stream;
+}
+
+static gint64 bench_feed_sse(const gchar *data, gsize len, guint rounds, BenchDecodeState *state) {
+    SSEParser parser;
+    sse_parser_init(&parser, bench_json_event, state);
+    gint64 start = g_get_monotonic_time();
+    for (guint round = 0; round < rounds; round++) {
+        for (gsize offset = 0; offset < len; offset += BENCH_CHUNK_SIZE) {
+            sse_parser_feed(&parser, data + offset, MIN(BENCH_CHUNK_SIZE, len - offset));
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+    sse_parser_clear(&parser);
+    return elapsed;
+}
+
+static gint64 bench_feed_compact(const guint8 *data, gsize len, guint rounds, BenchDecodeState *state) {
+    LyricsCompactDecoder decoder;
+    lyrics_compact_decoder_init(&decoder, bench_compact_event, state);
+    gint64 start = g_get_monotonic_time();
+    for (guint round = 0; round < rounds; round++) {
+        for (gsize offset = 0; offset < len; offset += BENCH_CHUNK_SIZE) {
+            g_assert_true(lyrics_compact_decoder_feed(&decoder, (const gchar *)data + offset,
+                                                      MIN(BENCH_CHUNK_SIZE, len - offset)));
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+    lyrics_compact_decoder_clear(&decoder);
+    return elapsed;
+}
+
+// 每行/每首歌词的传输字节数和解码耗时（从网络数据到事件或时间轴）
+static void test_bench_compact_vs_json(void) {
+    if (!bench_enabled()) {
+        return;
+    }
+
+    // 单行歌词
+    GString *sse_lines = build_bench_sse_stream(BENCH_COMPACT_LINES);
+    GByteArray *compact_lines = g_byte_array_new();
+    put_song_frame(compact_lines, 1, TRUE);
+    for (guint i = 0; i < BENCH_COMPACT_LINES; i++) {
+        GByteArray *payload = g_byte_array_new();
+        gint64 start_ms;
+        put_varint(payload, 1);
+        put_bench_line(payload, i, 0, &start_ms);
+        put_frame(compact_lines, LYRICS_COMPACT_LINE, payload);
+        g_byte_array_free(payload, TRUE);
+    }
+
+    guint64 total = (guint64)BENCH_COMPACT_LINES * BENCH_COMPACT_ROUNDS;
+    BenchDecodeState json_state = {0}, compact_state = {0};
+    lyrics_event_decoder_init(&json_state.decoder);
+    gint64 json_us = bench_feed_sse(sse_lines->str, sse_lines->len, BENCH_COMPACT_ROUNDS, &json_state);
+    gint64 compact_us = bench_feed_compact(compact_lines->data, compact_lines->len, BENCH_COMPACT_ROUNDS,
+                                           &compact_state);
+
+    g_test_message("单行歌词: %" G_GUINT64_FORMAT " 行, 每行 %d 个音节", total, BENCH_LINE_SYLLABLES);
+    g_test_message("  SSE+JSON: 每行 %.1f 字节, %.0f ns",
+                   (gdouble)sse_lines->len / BENCH_COMPACT_LINES, json_us * 1000.0 / total);
+    g_test_message("  紧凑编码: 每行 %.1f 字节, %.0f ns",
+                   (gdouble)compact_lines->len / BENCH_COMPACT_LINES, compact_us * 1000.0 / total);
+
+    // 两种编码还原出相同的歌词行
+    g_assert_cmpuint(json_state.events, ==, total);
+    g_assert_cmpuint(compact_state.events, ==, total);
+    g_assert_cmpuint(json_state.text_bytes, ==, compact_state.text_bytes);
+
+    // 整首歌词
+    GString *sse_document = build_bench_document_sse();
+    GByteArray *compact_document = build_bench_document_compact();
+    BenchDecodeState json_doc = {0}, compact_doc = {0};
+    lyrics_event_decoder_init(&json_doc.decoder);
+    gint64 json_doc_us = bench_feed_sse(sse_document->str, sse_document->len, BENCH_DOCUMENT_ROUNDS, &json_doc);
+    gint64 compact_doc_us = bench_feed_compact(compact_document->data, compact_document->len,
+                                               BENCH_DOCUMENT_ROUNDS, &compact_doc);
+
+    g_test_message("整首歌词: %d 行, 解码为时间轴 %d 次", BENCH_DOCUMENT_LINES, BENCH_DOCUMENT_ROUNDS);
+    g_test_message("  SSE+JSON+文本解析: 每首 %u 字节, %.1f us",
+                   (guint)sse_document->len, (gdouble)json_doc_us / BENCH_DOCUMENT_ROUNDS);
+    g_test_message("  紧凑编码(zlib): 每首 %u 字节, %.1f us",
+                   compact_document->len, (gdouble)compact_doc_us / BENCH_DOCUMENT_ROUNDS);
+    g_test_minimized_result(compact_us * 1000.0 / total, "紧凑编码每行 %.0f ns", compact_us * 1000.0 / total);
+
+    g_assert_cmpuint(json_doc.lines, ==, (guint64)BENCH_DOCUMENT_LINES * BENCH_DOCUMENT_ROUNDS);
+    g_assert_cmpuint(compact_doc.lines, ==, json_doc.lines);
+
+    lyrics_event_decoder_clear(&json_doc.decoder);
+    lyrics_event_decoder_clear(&json_state.decoder);
+    g_byte_array_free(compact_document, TRUE);
+    g_string_free(sse_document, TRUE);
+    g_byte_array_free(compact_lines, TRUE);
+    g_string_free(sse_lines, TRUE);
+}
+
+// ---- 性能基准：副歌排版缓存 ----
+
+#define BENCH_LAYOUT_PLAYS 20
+
+// 副歌较多的歌曲结构：主歌1、副歌、主歌2、副歌、桥段、副歌×2
+// 数字为bench_line的行号（文本每17行循环一次），副歌为第10到13行
+static const guint bench_song_lines[] = {
+    0, 1, 2, 3,
+    10, 11, 12, 13,
+    4, 5, 6, 7,
+    10, 11, 12, 13,
+    8, 9,
+    10, 11, 12, 13,
+    10, 11, 12, 13,
+};
+
+// 与擦除控件一致的单行居中布局，取尺寸触发排版
+static PangoLayout* bench_create_layout(PangoContext *context, const gchar *text, gsize text_len) {
+    PangoLayout *layout = pango_layout_new(context);
+    gint width, height;
+    pango_layout_set_single_paragraph_mode(layout, TRUE);
+    pango_layout_set_alignment(layout, PANGO_ALIGN_CENTER);
+    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_START);
+    pango_layout_set_text(layout, text, (int)text_len);
+    pango_layout_get_pixel_size(layout, &width, &height);
+    return layout;
+}
+
+// 每首歌从空缓存开始，统计命中率以及缓存与每行重新排版的耗时
+static void test_bench_layout_cache(void) {
+    if (!bench_enabled()) {
+        return;
+    }
+
+    PangoContext *context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+    PangoFontDescription *font = pango_font_description_from_string("Sans 24");
+    pango_context_set_font_description(context, font);
+    pango_font_description_free(font);
+    const PangoFontDescription *context_font = pango_context_get_font_description(context);
+
+    GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+    LyricsSyllable syllables[BENCH_LINE_SYLLABLES];
+    GString *text = g_string_new(NULL);
+    for (guint i = 0; i < G_N_ELEMENTS(bench_song_lines); i++) {
+        gint64 start_ms;
+        bench_line(bench_song_lines[i], &start_ms, text, syllables);
+        g_ptr_array_add(lines, g_strdup(text->str));
+    }
+    g_string_free(text, TRUE);
+
+    // 先排版一遍，字体加载不计入
+    for (guint i = 0; i < lines->len; i++) {
+        const gchar *line = g_ptr_array_index(lines, i);
+        g_object_unref(bench_create_layout(context, line, strlen(line)));
+    }
+
+    LyricsLayoutCacheStats total = {0};
+    gint64 start = g_get_monotonic_time();
+    for (guint play = 0; play < BENCH_LAYOUT_PLAYS; play++) {
+        LyricsLayoutCache cache;
+        lyrics_layout_cache_init(&cache, KARAOKE_WIPE_LAYOUT_CACHE_SIZE);
+        for (guint i = 0; i < lines->len; i++) {
+            const gchar *line = g_ptr_array_index(lines, i);
+            gsize len = strlen(line);
+            PangoLayout *layout = lyrics_layout_cache_lookup(&cache, line, len, context_font, 1);
+            if (!layout) {
+                layout = bench_create_layout(context, line, len);
+                lyrics_layout_cache_insert(&cache, line, len, context_font, 1, layout);
+                g_object_unref(layout);
+            }
+        }
+        total.lookups += cache.stats.lookups;
+        total.hits += cache.stats.hits;
+        lyrics_layout_cache_clear(&cache);
+    }
+    gint64 cached_us = MAX(g_get_monotonic_time() - start, 1);
+
+    start = g_get_monotonic_time();
+    for (guint play = 0; play < BENCH_LAYOUT_PLAYS; play++) {
+        for (guint i = 0; i < lines->len; i++) {
+            const gchar *line = g_ptr_array_index(lines, i);
+            g_object_unref(bench_create_layout(context, line, strlen(line)));
+        }
+    }
+    gint64 uncached_us = MAX(g_get_monotonic_time() - start, 1);
+
+    g_test_message("副歌排版缓存: 每首 %u 行, 播放 %d 次", lines->len, BENCH_LAYOUT_PLAYS);
+    g_test_message("  命中率 %.1f%% (%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT ")",
+                   100.0 * total.hits / total.lookups, total.hits, total.lookups);
+    g_test_message("  使用缓存: 每首 %.0f us, 每行重新排版: 每首 %.0f us",
+                   (gdouble)cached_us / BENCH_LAYOUT_PLAYS, (gdouble)uncached_us / BENCH_LAYOUT_PLAYS);
+    g_test_maximized_result(100.0 * total.hits / total.lookups, "命中率 %.1f%%", 100.0 * total.hits / total.lookups);
+
+    // 26行中14行不同，其余12行是重复的副歌
+    g_assert_cmpuint(total.hits, ==, (guint64)12 * BENCH_LAYOUT_PLAYS);
+
+    g_ptr_array_free(lines, TRUE);
+    g_object_unref(context);
+}
+
+// ---- 性能基准：传输延迟 ----
+
+#define BENCH_TRANSPORT_WARMUP 20
+#define BENCH_TRANSPORT_EVENTS 1000
+// 整轮测量的超时，连接或事件丢失时测试失败而不是一直等待
+#define BENCH_TRANSPORT_TIMEOUT_S 60
+
+typedef struct {
+    LyricsQueue queue;
+    gint64 sent_us;          // 当前事件写入套接字的时间
+    gint64 latency_us;       // 最近一行从写入到主线程显示的时间
+    guint displayed;         // 主线程显示的行数
+    gboolean timed_out;
+} BenchTransport;
+
+typedef struct {
+    gdouble median_us;
+    gdouble p99_us;
+    gdouble mean_us;
+    gdouble switches;        // 每个事件的上下文切换次数（自愿+非自愿，整个进程）
+} BenchTransportResult;
+
+// 客户端回调：与程序相同，经队列交给主线程显示
+static void bench_transport_lyrics(const gchar *song_name, const gchar *text, gsize text_len,
+                                   const gchar *format, gint64 received_time, gboolean restored,
+                                   gpointer user_data) {
+    BenchTransport *bench = (BenchTransport *)user_data;
+    lyrics_queue_push(&bench->queue, song_name, text, text_len, format, received_time, restored);
+}
+
+static void bench_transport_display(const LyricsUpdate *update, gpointer user_data) {
+    BenchTransport *bench = (BenchTransport *)user_data;
+    (void)update;
+    bench->latency_us = g_get_monotonic_time() - bench->sent_us;
+    bench->displayed++;
+}
+
+static gboolean bench_transport_timeout(gpointer user_data) {
+    ((BenchTransport *)user_data)->timed_out = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+static gint compare_gint64(gconstpointer a, gconstpointer b) {
+    gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static gint64 context_switches(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_nvcsw + usage.ru_nivcsw : 0;
+}
+
+// 客户端每个事件都输出日志，测量期间把标准输出重定向到/dev/null
+static gint bench_quiet_begin(void) {
+    fflush(stdout);
+    gint saved = dup(STDOUT_FILENO);
+    gint null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    return saved;
+}
+
+static void bench_quiet_end(gint saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+// 通过本机的替代服务器逐个发送事件（收到上一个再发下一个），
+// 测量从服务器写入套接字到主线程显示该行的延迟
+static gboolean run_transport_bench(SSEEndpointKind kind, SSETransport transport, BenchTransportResult *result) {
+    TestSSEServer *server = test_sse_server_new(kind);
+    if (!server) {
+        return FALSE;
+    }
+
+    guint total = BENCH_TRANSPORT_WARMUP + BENCH_TRANSPORT_EVENTS;
+    GPtrArray *events = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < total; i++) {
+        GString *event = g_string_new("data: ");
+        append_bench_json(event, i);
+        g_string_append(event, "\n\n");
+        g_ptr_array_add(events, g_string_free(event, FALSE));
+    }
+    gint64 *latencies = g_new(gint64, BENCH_TRANSPORT_EVENTS);
+
+    BenchTransport bench;
+    memset(&bench, 0, sizeof(bench));
+    // 不设置播放状态回调，队列不会收到播放状态
+    g_assert_true(lyrics_queue_init(&bench.queue, 64, bench_transport_display, NULL, &bench));
+    guint timeout_id = g_timeout_add_seconds(BENCH_TRANSPORT_TIMEOUT_S, bench_transport_timeout, &bench);
+
+    gint saved_stdout = bench_quiet_begin();
+    const gchar *urls[] = {test_sse_server_get_url(server), NULL};
+    SSEClient *client = sse_client_new(urls, NULL, transport, bench_transport_lyrics, &bench);
+    sse_client_start(client);
+
+    // 主循环模式的连接由主循环驱动
+    while (!test_sse_server_is_connected(server) && !bench.timed_out) {
+        g_main_context_iteration(NULL, FALSE);
+        g_usleep(1000);
+    }
+
+    gint64 switches_start = 0;
+    for (guint i = 0; i < total && !bench.timed_out; i++) {
+        if (i == BENCH_TRANSPORT_WARMUP) {
+            switches_start = context_switches();
+        }
+        const gchar *event = g_ptr_array_index(events, i);
+        bench.sent_us = g_get_monotonic_time();
+        if (!test_sse_server_send(server, event, strlen(event))) {
+            break;
+        }
+        while (bench.displayed < i + 1 && !bench.timed_out) {
+            g_main_context_iteration(NULL, TRUE);
+        }
+        if (i >= BENCH_TRANSPORT_WARMUP) {
+            latencies[i - BENCH_TRANSPORT_WARMUP] = bench.latency_us;
+        }
+    }
+    gint64 switches = context_switches() - switches_start;
+
+    sse_client_stop(client);
+    bench_quiet_end(saved_stdout);
+    g_assert_false(bench.timed_out);
+    g_assert_cmpuint(bench.displayed, ==, total);
+    g_source_remove(timeout_id);
+    lyrics_queue_clear(&bench.queue);
+    test_sse_server_free(server);
+
+    gint64 sum = 0;
+    for (guint i = 0; i < BENCH_TRANSPORT_EVENTS; i++) {
+        sum += latencies[i];
+    }
+    qsort(latencies, BENCH_TRANSPORT_EVENTS, sizeof(gint64), compare_gint64);
+    result->median_us = (gdouble)latencies[BENCH_TRANSPORT_EVENTS / 2];
+    result->p99_us = (gdouble)latencies[BENCH_TRANSPORT_EVENTS * 99 / 100];
+    result->mean_us = (gdouble)sum / BENCH_TRANSPORT_EVENTS;
+    result->switches = (gdouble)switches / BENCH_TRANSPORT_EVENTS;
+
+    g_free(latencies);
+    g_ptr_array_free(events, TRUE);
+    return TRUE;
+}
+
+static void report_transport_bench(const gchar *name, const BenchTransportResult *result) {
+    g_test_message("  %s: 中位数 %.0f us, p99 %.0f us, 平均 %.0f us, 每事件上下文切换 %.2f 次",
+                   name, result->median_us, result->p99_us, result->mean_us, result->switches);
+}
+
+// TCP回环与Unix域套接字（路径和抽象命名空间）的事件延迟，线程模式
+static void test_bench_transport_sockets(void) {
+    if (!bench_enabled()) {
+        return;
+    }
+
+    static const SSEEndpointKind kinds[] = {SSE_ENDPOINT_TCP, SSE_ENDPOINT_UNIX, SSE_ENDPOINT_UNIX_ABSTRACT};
+    static const gchar *names[] = {"TCP回环", "Unix套接字", "抽象命名空间"};
+
+    g_test_message("套接字延迟: %d 个事件, 从服务器写入到主线程显示", BENCH_TRANSPORT_EVENTS);
+    for (guint i = 0; i < G_N_ELEMENTS(kinds); i++) {
+        BenchTransportResult result;
+        if (!run_transport_bench(kinds[i], SSE_TRANSPORT_THREAD, &result)) {
+            g_test_message("  %s: 无法监听，跳过", names[i]);
+            continue;
+        }
+        report_transport_bench(names[i], &result);
+        if (kinds[i] == SSE_ENDPOINT_TCP) {
+            g_test_minimized_result(result.median_us, "TCP回环中位数 %.0f us", result.median_us);
+        }
+    }
+}
+
+// 线程模式与主循环模式的事件延迟和上下文切换，TCP回环
+static void test_bench_transport_modes(void) {
+    if (!bench_enabled()) {
+        return;
+    }
+
+    BenchTransportResult thread_result, mainloop_result;
+    g_assert_true(run_transport_bench(SSE_ENDPOINT_TCP, SSE_TRANSPORT_THREAD, &thread_result));
+    g_assert_true(run_transport_bench(SSE_ENDPOINT_TCP, SSE_TRANSPORT_MAINLOOP, &mainloop_result));
+
+    g_test_message("传输方式: %d 个事件, TCP回环, 从服务器写入到主线程显示", BENCH_TRANSPORT_EVENTS);
+    report_transport_bench("线程", &thread_result);
+    report_transport_bench("主循环", &mainloop_result);
+    g_test_minimized_result(mainloop_result.median_us, "主循环中位数 %.0f us", mainloop_result.median_us);
+}
+
+// ---- 界面：透明度 ----
+
+#define OPACITY_CHANGES 1000
+#define OPACITY_BATCH 100
+// 最后一批的耗时不超过第一批的倍数（另加固定余量吸收调度抖动）
+#define OPACITY_FLAT_FACTOR 3
+#define OPACITY_FLAT_SLACK_US 20000
+
+static gboolean gtk_available;
+static gchar *test_home;
+
+static void on_style_changed(GtkStyleContext *context, gpointer data) {
+    (void)context;
+    (*(guint *)data)++;
+}
+
+static void process_pending_events(void) {
+    while (gtk_events_pending()) {
+        gtk_main_iteration();
+    }
+}
+
+// 歌词窗口（进程中唯一的顶层窗口）
+static GtkWidget* find_lyrics_window(void) {
+    GList *toplevels = gtk_window_list_toplevels();
+    GtkWidget *window = NULL;
+    for (GList *l = toplevels; l; l = l->next) {
+        if (gtk_window_get_window_type(GTK_WINDOW(l->data)) == GTK_WINDOW_TOPLEVEL) {
+            window = GTK_WIDGET(l->data);
+            break;
+        }
+    }
+    g_list_free(toplevels);
+    return window;
+}
+
+// 连续改变1000次透明度：屏幕上的样式提供者不增不减（增删提供者会让所有样式上下文发出changed），
+// 每批改变连同重新计算样式和重绘的耗时保持平稳
+static void test_opacity_style_flat(void) {
+    if (!gtk_available) {
+        g_test_skip("没有图形界面环境");
+        return;
+    }
+
+    // 不可达的端点：连接在后台失败重试，不影响界面
+    const gchar *urls[] = {"http://127.0.0.1:9/api/osd-lyrics/sse", NULL};
+    g_assert_true(osd_lyrics_init_with_sse_urls(urls));
+    osd_lyrics_set_visible(TRUE);
+    process_pending_events();
+
+    GtkWidget *window = find_lyrics_window();
+    g_assert_nonnull(window);
+    g_assert_true(gtk_widget_get_realized(window));
+
+    guint style_changes = 0;
+    GtkStyleContext *context = gtk_widget_get_style_context(window);
+    gulong handler = g_signal_connect(context, "changed", G_CALLBACK(on_style_changed), &style_changes);
+
+    gint64 batch_us[OPACITY_CHANGES / OPACITY_BATCH];
+    for (guint batch = 0; batch < G_N_ELEMENTS(batch_us); batch++) {
+        gint64 start = g_get_monotonic_time();
+        for (guint i = 0; i < OPACITY_BATCH; i++) {
+            osd_lyrics_set_opacity(0.01 + 0.89 * (gdouble)((batch * OPACITY_BATCH + i) % 90) / 89.0);
+        }
+        process_pending_events();
+        batch_us[batch] = g_get_monotonic_time() - start;
+        g_test_message("第 %u 批: %" G_GINT64_FORMAT "us", batch, batch_us[batch]);
+    }
+
+    g_assert_cmpuint(style_changes, ==, 0);
+    g_assert_cmpint(batch_us[G_N_ELEMENTS(batch_us) - 1], <=,
+                    batch_us[0] * OPACITY_FLAT_FACTOR + OPACITY_FLAT_SLACK_US);
+
+    g_signal_handler_disconnect(context, handler);
+    osd_lyrics_cleanup();
+}
+
+// 删除测试用主目录中生成的配置和缓存
+static void remove_test_home(void) {
+    gchar *config_dir = g_build_filename(test_home, ".config", "gomusic", NULL);
+    gchar *config_file = g_build_filename(config_dir, "osd_lyrics.conf", NULL);
+    gchar *cache_file = g_build_filename(config_dir, LYRICS_TIMELINE_CACHE_FILE, NULL);
+    gchar *parent_dir = g_build_filename(test_home, ".config", NULL);
+
+    g_remove(config_file);
+    g_remove(cache_file);
+    g_rmdir(config_dir);
+    g_rmdir(parent_dir);
+    g_rmdir(test_home);
+
+    g_free(parent_dir);
+    g_free(cache_file);
+    g_free(config_file);
+    g_free(config_dir);
+    g_free(test_home);
+}
+
+int main(int argc, char *argv[]) {
+    // 配置和时间轴缓存写到临时主目录，不影响真实配置（必须在任何GLib路径查询之前设置）
+    test_home = g_dir_make_tmp("osd-lyrics-test-XXXXXX", NULL);
+    if (test_home) {
+        g_setenv("HOME", test_home, TRUE);
+    }
+
+    g_test_init(&argc, &argv, NULL);
+    gtk_available = test_home && gtk_init_check(&argc, &argv);
+
+    g_test_add_func("/sse/cases", test_sse_cases);
+    g_test_add_func("/sse/every-split", test_sse_every_split);
+    g_test_add_func("/sse/retry-and-reset", test_sse_retry_and_reset);
+    g_test_add_func("/event/decode", test_event_decode_cases);
+    g_test_add_func("/timeline/cases", test_timeline_cases);
+    g_test_add_func("/timeline/lookup", test_timeline_lookup);
+    g_test_add_func("/compact/valid", test_compact_valid);
+    g_test_add_func("/compact/overflow", test_compact_overflow);
+    g_test_add_func("/compact/line-times", test_compact_line_times);
+    g_test_add_func("/compact/truncated", test_compact_truncated);
+    g_test_add_func("/clock/slew-monotonic", test_clock_slew_monotonic);
+    g_test_add_func("/clock/repeated-observations", test_clock_repeated_observations);
+    g_test_add_func("/clock/jump-pause-rate", test_clock_jump_pause_rate);
+    g_test_add_func("/karaoke/steady-state", test_karaoke_steady_state);
+    g_test_add_func("/karaoke/markup", test_karaoke_markup);
+    g_test_add_func("/ui/opacity-style-flat", test_opacity_style_flat);
+    g_test_add_func("/bench/sse-parse", test_bench_sse_parse);
+    g_test_add_func("/bench/event-decode", test_bench_event_decode);
+    g_test_add_func("/bench/compact-vs-json", test_bench_compact_vs_json);
+    g_test_add_func("/bench/layout-cache", test_bench_layout_cache);
+    g_test_add_func("/bench/transport-sockets", test_bench_transport_sockets);
+    g_test_add_func("/bench/transport-modes", test_bench_transport_modes);
+
+    int result = g_test_run();
+    if (test_home) {
+        remove_test_home();
+    }
+    return result;
+}
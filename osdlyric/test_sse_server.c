@@ -0,0 +1,232 @@
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <glib/gstdio.h>
+#include "test_sse_server.h"
+
+// 与真实服务相同的SSE响应头，正文持续到连接关闭
+#define TEST_SSE_RESPONSE "HTTP/1.1 200 OK\r\n" \
+                          "Content-Type: text/event-stream\r\n" \
+                          "Cache-Control: no-cache\r\n" \
+                          "Connection: close\r\n\r\n"
+
+// 请求头的长度上限
+#define TEST_SSE_MAX_REQUEST 8192
+
+struct _TestSSEServer {
+    SSEEndpointKind kind;
+    gint listen_fd;
+    gchar *url;
+    gchar *socket_dir;       // Unix套接字所在的临时目录
+    gchar *socket_path;      // Unix套接字路径，其他类型为NULL
+    GThread *thread;         // 接受连接的线程
+    gint closing;            // 原子访问
+
+    GMutex lock;             // 保护 client_fd，写入期间持有
+    gint client_fd;          // 当前客户端，没有时为-1
+};
+
+static gboolean send_all(gint fd, const gchar *data, gsize len) {
+    while (len > 0) {
+        // 客户端已断开时返回EPIPE而不是产生SIGPIPE
+        gssize sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FALSE;
+        }
+        data += sent;
+        len -= (gsize)sent;
+    }
+    return TRUE;
+}
+
+// 读取并丢弃请求头（到空行为止）
+static gboolean read_request(gint fd) {
+    gchar buffer[TEST_SSE_MAX_REQUEST + 1];
+    gsize len = 0;
+
+    while (len < TEST_SSE_MAX_REQUEST) {
+        gssize n = recv(fd, buffer + len, TEST_SSE_MAX_REQUEST - len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return FALSE;
+        }
+        len += (gsize)n;
+        buffer[len] = 0;
+        if (strstr(buffer, "\r\n\r\n")) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// 接受连接：回复响应头后替换当前客户端，直到监听套接字被关闭
+static gpointer server_thread(gpointer data) {
+    TestSSEServer *server = (TestSSEServer *)data;
+
+    while (!g_atomic_int_get(&server->closing)) {
+        gint fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        if (server->kind == SSE_ENDPOINT_TCP) {
+            // 事件很小，不等待Nagle合并
+            gint nodelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        }
+        if (!read_request(fd) || !send_all(fd, TEST_SSE_RESPONSE, strlen(TEST_SSE_RESPONSE))) {
+            close(fd);
+            continue;
+        }
+
+        g_mutex_lock(&server->lock);
+        gint old_fd = server->client_fd;
+        server->client_fd = fd;
+        g_mutex_unlock(&server->lock);
+        if (old_fd >= 0) {
+            close(old_fd);
+        }
+    }
+    return NULL;
+}
+
+static gboolean listen_tcp(TestSSEServer *server) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    gint reuse = 1;
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) {
+        return FALSE;
+    }
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // 回环地址的随机端口
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        return FALSE;
+    }
+
+    server->url = g_strdup_printf("http://127.0.0.1:%u%s", ntohs(addr.sin_port), SSE_ENDPOINT_DEFAULT_PATH);
+    return TRUE;
+}
+
+static gboolean listen_unix(TestSSEServer *server) {
+    static gint abstract_serial = 0;
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    gchar *name;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (server->kind == SSE_ENDPOINT_UNIX) {
+        server->socket_dir = g_dir_make_tmp("osd-lyrics-sse-XXXXXX", NULL);
+        if (!server->socket_dir) {
+            return FALSE;
+        }
+        server->socket_path = g_build_filename(server->socket_dir, "sse.sock", NULL);
+        name = server->socket_path;
+        if (strlen(name) >= sizeof(addr.sun_path)) {
+            return FALSE;
+        }
+        memcpy(addr.sun_path, name, strlen(name));
+        addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(name) + 1);
+        server->url = g_strdup_printf("unix:%s", name);
+    } else {
+        // 抽象命名空间：sun_path以'\0'开头，名称不以'\0'结尾
+        name = g_strdup_printf("osd-lyrics-test-%d-%d", (gint)getpid(), g_atomic_int_add(&abstract_serial, 1));
+        memcpy(addr.sun_path + 1, name, strlen(name));
+        addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + strlen(name));
+        server->url = g_strdup_printf("unix-abstract:%s", name);
+        g_free(name);
+    }
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    return server->listen_fd >= 0 && bind(server->listen_fd, (struct sockaddr *)&addr, addr_len) == 0;
+}
+
+TestSSEServer* test_sse_server_new(SSEEndpointKind kind) {
+    TestSSEServer *server = g_new0(TestSSEServer, 1);
+    server->kind = kind;
+    server->listen_fd = -1;
+    server->client_fd = -1;
+    g_mutex_init(&server->lock);
+
+    gboolean ok = kind == SSE_ENDPOINT_TCP ? listen_tcp(server) : listen_unix(server);
+    if (!ok || listen(server->listen_fd, 4) < 0) {
+        test_sse_server_free(server);
+        return NULL;
+    }
+
+    server->thread = g_thread_new("test-sse-server", server_thread, server);
+    return server;
+}
+
+const gchar* test_sse_server_get_url(TestSSEServer *server) {
+    return server->url;
+}
+
+gboolean test_sse_server_is_connected(TestSSEServer *server) {
+    g_mutex_lock(&server->lock);
+    gboolean connected = server->client_fd >= 0;
+    g_mutex_unlock(&server->lock);
+    return connected;
+}
+
+gboolean test_sse_server_send(TestSSEServer *server, const gchar *data, gsize len) {
+    g_mutex_lock(&server->lock);
+    gboolean ok = server->client_fd >= 0 && send_all(server->client_fd, data, len);
+    g_mutex_unlock(&server->lock);
+    return ok;
+}
+
+void test_sse_server_free(TestSSEServer *server) {
+    if (!server) {
+        return;
+    }
+
+    // shutdown 唤醒阻塞在 accept 中的线程
+    g_atomic_int_set(&server->closing, 1);
+    if (server->listen_fd >= 0) {
+        shutdown(server->listen_fd, SHUT_RDWR);
+    }
+    if (server->thread) {
+        g_thread_join(server->thread);
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->client_fd >= 0) {
+        close(server->client_fd);
+    }
+
+    if (server->socket_path) {
+        g_unlink(server->socket_path);
+    }
+    if (server->socket_dir) {
+        g_rmdir(server->socket_dir);
+    }
+    g_mutex_clear(&server->lock);
+    g_free(server->socket_path);
+    g_free(server->socket_dir);
+    g_free(server->url);
+    g_free(server);
+}
@@ -0,0 +1,41 @@
+#ifndef TEST_SSE_SERVER_H
+#define TEST_SSE_SERVER_H
+
+#include <glib.h>
+#include "osd_lyrics_endpoint.h"
+
+// 测试用的本机SSE服务器（代替真实的歌词服务）
+// 在TCP回环、Unix域套接字或抽象命名空间套接字上监听，接受连接后回复SSE响应头，
+// 之后由测试直接把事件写入连接。同一时间只保留最新的一个客户端连接
+
+typedef struct _TestSSEServer TestSSEServer;
+
+/**
+ * 创建服务器并开始监听
+ * @param kind 监听的套接字类型
+ * @return 服务器，监听失败返回NULL
+ */
+TestSSEServer* test_sse_server_new(SSEEndpointKind kind);
+
+/**
+ * 客户端使用的连接地址（http://、unix: 或 unix-abstract:）
+ */
+const gchar* test_sse_server_get_url(TestSSEServer *server);
+
+/**
+ * 是否已有客户端连接并收到响应头
+ */
+gboolean test_sse_server_is_connected(TestSSEServer *server);
+
+/**
+ * 向当前客户端写入数据（完整的SSE事件）
+ * @return 没有客户端或写入失败返回FALSE
+ */
+gboolean test_sse_server_send(TestSSEServer *server, const gchar *data, gsize len);
+
+/**
+ * 停止监听，关闭所有连接并删除套接字文件
+ */
+void test_sse_server_free(TestSSEServer *server);
+
+#endif // TEST_SSE_SERVER_H